@@ -0,0 +1,757 @@
+#include "deribit_trader.hpp"
+#include "trading_agent.hpp"
+#include "spsc_queue.hpp"
+#include "market_board.hpp"
+#include "huge_page_pool.hpp"
+#include "order_book.hpp"
+#include "book_features.hpp"
+#include "trade_tape.hpp"
+#include "message_parser.hpp"
+#include "instrument_cache.hpp"
+#include "options_chain.hpp"
+#include "portfolio_risk.hpp"
+#include "monte_carlo_var.hpp"
+#include "ws_session.hpp"
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Count global allocations so the hot-path benchmarks can report
+// allocations per iteration alongside their timings
+static std::atomic<uint64_t> g_allocations{0};
+
+void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+// Captured testnet notifications used for the parsing benchmarks
+static const char* kBookFrame = R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"book.BTC-PERPETUAL.100ms","data":{"type":"change","timestamp":1718200000123,"prev_change_id":68250001234,"instrument_name":"BTC-PERPETUAL","change_id":68250001240,"bids":[["change",67012.5,12340.0],["new",67010.0,2500.0],["delete",67008.5,0.0],["change",67005.0,80000.0]],"asks":[["change",67013.0,4410.0],["new",67015.5,10.0],["change",67020.0,153000.0]]}}})";
+
+static const char* kTradesFrame = R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"trades.BTC-PERPETUAL.100ms","data":[{"trade_seq":201554221,"trade_id":"312220187","timestamp":1718200000456,"tick_direction":0,"price":67013.0,"mark_price":67011.84,"instrument_name":"BTC-PERPETUAL","index_price":67005.31,"direction":"buy","amount":1200.0},{"trade_seq":201554222,"trade_id":"312220188","timestamp":1718200000457,"tick_direction":1,"price":67013.0,"mark_price":67011.84,"instrument_name":"BTC-PERPETUAL","index_price":67005.31,"direction":"buy","amount":40.0}]}})";
+
+struct TradingAgentBenchAccess {
+    static double rsi(const TradingAgent& agent, const std::vector<double>& prices, int period) {
+        return agent.calculateRSI(prices, period);
+    }
+    static double sma(const TradingAgent& agent, const std::vector<double>& prices, int period) {
+        return agent.calculateSMA(prices, period);
+    }
+    static double volatility(const TradingAgent& agent, const std::vector<double>& prices, int period) {
+        return agent.calculateVolatility(prices, period);
+    }
+    static bool breakout(const TradingAgent& agent, const std::vector<double>& prices, double price) {
+        return agent.detectBreakout(prices, price);
+    }
+    static void openPositions(TradingAgent& agent, size_t count, double entry_price) {
+        agent.open_positions.clear();
+        for (size_t i = 0; i < count; ++i) {
+            agent.open_positions.push_back({
+                .order_id = "bench-" + std::to_string(i),
+                .direction = (i % 2 == 0) ? "buy" : "sell",
+                .entry_price = entry_price,
+                .amount = 10.0,
+                .current_pnl = 0.0,
+                .highest_pnl = 0.0,
+                .lowest_pnl = 0.0,
+                .entry_time = std::chrono::system_clock::now()
+            });
+        }
+    }
+    static void setQuote(TradingAgent& agent, double bid, double ask) {
+        agent.current_bid = bid;
+        agent.current_ask = ask;
+    }
+    static void updatePositionPnL(TradingAgent& agent) {
+        agent.updatePositionPnL();
+    }
+};
+
+namespace {
+
+void report_allocations(benchmark::State& state, uint64_t before) {
+    state.counters["allocs_per_iter"] = benchmark::Counter(
+        static_cast<double>(g_allocations.load() - before), benchmark::Counter::kAvgIterations);
+}
+
+// Data TLB load misses on the calling thread. Unavailable without a PMU or
+// when perf_event_paranoid forbids user-space counting.
+class TlbMissCounter {
+public:
+    TlbMissCounter() {
+        perf_event_attr attr{};
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd_ = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+    ~TlbMissCounter() {
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+    }
+
+    bool available() const { return fd_ >= 0; }
+    void start() {
+        ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    uint64_t stop() {
+        uint64_t count = 0;
+        ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd_, &count, sizeof(count)) != sizeof(count)) {
+            return 0;
+        }
+        return count;
+    }
+
+private:
+    int fd_ = -1;
+};
+
+// Transparent huge pages backing this process, in KB, or -1 when the
+// kernel does not report them. THP in madvise mode may still hand out
+// 4 KB pages, so this is what shows whether a pool really got huge pages.
+long anon_huge_kb() {
+    FILE* smaps = std::fopen("/proc/self/smaps_rollup", "r");
+    if (!smaps) {
+        return -1;
+    }
+    long kb = -1;
+    char line[256];
+    while (std::fgets(line, sizeof(line), smaps)) {
+        if (std::sscanf(line, "AnonHugePages: %ld kB", &kb) == 1) {
+            break;
+        }
+    }
+    std::fclose(smaps);
+    return kb;
+}
+
+DeribitTrader& offline_trader() {
+    static DeribitTrader trader("bench", "bench", false);
+    return trader;
+}
+
+TradingAgent& bench_agent() {
+    static TradingAgent agent(offline_trader());
+    static bool quiet = [] {
+        spdlog::set_level(spdlog::level::off);
+        return true;
+    }();
+    (void)quiet;
+    return agent;
+}
+
+std::vector<double> random_walk(size_t count) {
+    std::mt19937_64 rng(42);
+    std::normal_distribution<double> step(0.0, 5.0);
+    std::vector<double> prices(count);
+    double price = 67000.0;
+    for (auto& p : prices) {
+        price += step(rng);
+        p = price;
+    }
+    return prices;
+}
+
+void BM_CalculateRSI(benchmark::State& state) {
+    auto& agent = bench_agent();
+    int period = static_cast<int>(state.range(0));
+    auto prices = random_walk(static_cast<size_t>(period) + 1);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(TradingAgentBenchAccess::rsi(agent, prices, period));
+    }
+}
+BENCHMARK(BM_CalculateRSI)->Arg(10)->Arg(20)->Arg(200);
+
+void BM_CalculateSMA(benchmark::State& state) {
+    auto& agent = bench_agent();
+    int period = static_cast<int>(state.range(0));
+    auto prices = random_walk(static_cast<size_t>(period));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(TradingAgentBenchAccess::sma(agent, prices, period));
+    }
+}
+BENCHMARK(BM_CalculateSMA)->Arg(10)->Arg(20)->Arg(200);
+
+void BM_CalculateVolatility(benchmark::State& state) {
+    auto& agent = bench_agent();
+    int period = static_cast<int>(state.range(0));
+    auto prices = random_walk(static_cast<size_t>(period));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(TradingAgentBenchAccess::volatility(agent, prices, period));
+    }
+}
+BENCHMARK(BM_CalculateVolatility)->Arg(10)->Arg(20)->Arg(200);
+
+void BM_DetectBreakout(benchmark::State& state) {
+    auto& agent = bench_agent();
+    auto prices = random_walk(static_cast<size_t>(state.range(0)));
+    double price = prices.back();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(TradingAgentBenchAccess::breakout(agent, prices, price));
+    }
+}
+BENCHMARK(BM_DetectBreakout)->Arg(10)->Arg(20)->Arg(200);
+
+void run_frame_benchmark(benchmark::State& state, const char* frame, const std::string& channel) {
+    auto& trader = offline_trader();
+    double sink = 0.0;
+    trader.set_channel_handler(channel, [&sink](const message_json& data) {
+        // Mirror what a consumer does: pull the first price level out
+        if (data.is_array()) {
+            sink += data[0]["price"].get<double>();
+        } else if (!data["bids"].empty()) {
+            sink += data["bids"][0][1].get<double>();
+        }
+    });
+
+    std::string message(frame);
+    trader.on_ws_message(message);  // Warm the arena
+    uint64_t before = g_allocations.load();
+    for (auto _ : state) {
+        trader.on_ws_message(message);
+    }
+    uint64_t allocations = g_allocations.load() - before;
+    report_allocations(state, before);
+    trader.set_channel_handler(channel, nullptr);
+    // Past warm-up a market data frame must not touch the global heap
+    if (allocations > 0) {
+        state.SkipWithError("market data frame allocated on the global heap");
+    }
+    benchmark::DoNotOptimize(sink);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * message.size()));
+}
+
+void BM_OnWsMessageBook(benchmark::State& state) {
+    run_frame_benchmark(state, kBookFrame, "book.BTC-PERPETUAL.100ms");
+}
+BENCHMARK(BM_OnWsMessageBook);
+
+void BM_OnWsMessageTrades(benchmark::State& state) {
+    run_frame_benchmark(state, kTradesFrame, "trades.BTC-PERPETUAL.100ms");
+}
+BENCHMARK(BM_OnWsMessageTrades);
+
+// The arena parser alone on the captured frames; fails if its document
+// differs from nlohmann's
+void BM_ParseMessage(benchmark::State& state) {
+    const std::string message(state.range(0) == 0 ? kBookFrame : kTradesFrame);
+    {
+        MessageArena::Scope scope;
+        if (parse_message(message) != message_json::parse(message)) {
+            state.SkipWithError("arena parser disagrees with nlohmann");
+            return;
+        }
+    }
+    uint64_t before = g_allocations.load();
+    for (auto _ : state) {
+        MessageArena::Scope scope;
+        benchmark::DoNotOptimize(&parse_message(message));
+    }
+    report_allocations(state, before);
+    state.SetLabel(state.range(0) == 0 ? "book" : "trades");
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * message.size()));
+}
+BENCHMARK(BM_ParseMessage)->Arg(0)->Arg(1);
+
+// A deep book snapshot several times the session's 4 KB rx buffer, fed in
+// rx-buffer pieces through the session's reassembly into the tracked book,
+// as lws delivers it. Fails unless the whole snapshot lands in the book.
+void BM_FragmentedBookSnapshot(benchmark::State& state) {
+    constexpr size_t kRxBuffer = 4096;
+    const std::string instrument = "BENCH-SNAPSHOT";
+    auto& trader = offline_trader();
+    trader.subscribe_orderbook(instrument);
+
+    json bids = json::array();
+    json asks = json::array();
+    for (int level = 0; level < static_cast<int>(state.range(0)); ++level) {
+        bids.push_back({"new", 67000.0 - 0.5 * (level + 1), 1000.0 + level});
+        asks.push_back({"new", 67000.0 + 0.5 * (level + 1), 1000.0 + level});
+    }
+    const std::string message = json{
+        {"jsonrpc", "2.0"}, {"method", "subscription"},
+        {"params", {{"channel", "book." + instrument + ".100ms"},
+                    {"data", {{"type", "snapshot"}, {"timestamp", 1718200000000},
+                              {"instrument_name", instrument}, {"change_id", 1},
+                              {"bids", bids}, {"asks", asks}}}}}
+    }.dump();
+
+    MessageAssembler inbox;
+    for (auto _ : state) {
+        for (size_t offset = 0; offset < message.size(); offset += kRxBuffer) {
+            std::string_view piece(message.data() + offset, std::min(kRxBuffer, message.size() - offset));
+            if (auto whole = inbox.add(piece, offset + kRxBuffer >= message.size())) {
+                trader.on_ws_message(*whole);
+            }
+        }
+    }
+
+    auto quote = trader.market_board().quote(instrument);
+    if (!quote || !quote->book_valid || quote->best_bid != 66999.5 || quote->best_ask != 67000.5) {
+        state.SkipWithError("snapshot did not reach the book");
+    }
+    state.SetLabel(std::to_string(message.size() / 1024) + " KB in " +
+                   std::to_string((message.size() + kRxBuffer - 1) / kRxBuffer) + " pieces");
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * message.size()));
+}
+BENCHMARK(BM_FragmentedBookSnapshot)->Arg(100)->Arg(1000);
+
+void BM_OrderPayloadSerialize(benchmark::State& state) {
+    DeribitTrader::OrderRequest order{
+        .instrument_name = "BTC-PERPETUAL",
+        .direction = "buy",
+        .amount = 100,
+        .price = 67013.5,
+        .type = "limit"
+    };
+    uint64_t before = g_allocations.load();
+    for (auto _ : state) {
+        MessageArena::Scope arena_scope;
+        auto body = DeribitTrader::build_order_payload(order, order.amount).dump();
+        benchmark::DoNotOptimize(body.data());
+    }
+    report_allocations(state, before);
+}
+BENCHMARK(BM_OrderPayloadSerialize);
+
+void BM_OrderTemplateEncode(benchmark::State& state) {
+    OrderFields order{"BTC-PERPETUAL", "buy", "limit", "good_til_cancelled", false, false, 100, 67013.5};
+    OrderEncoder encoder;
+    OrderEncoder::Encoded encoded;
+    uint64_t id = 1;
+    encoder.encode(order, id, encoded);  // Builds the template outside the timed loop
+    uint64_t before = g_allocations.load();
+    for (auto _ : state) {
+        order.price += 0.5;
+        encoder.encode(order, ++id, encoded);
+        benchmark::DoNotOptimize(encoded.body.data());
+    }
+    report_allocations(state, before);
+}
+BENCHMARK(BM_OrderTemplateEncode);
+
+void BM_UpdatePositionPnL(benchmark::State& state) {
+    auto& agent = bench_agent();
+    // Quotes stay inside the stop-loss/take-profit band so no exits fire
+    TradingAgentBenchAccess::openPositions(agent, static_cast<size_t>(state.range(0)), 67000.0);
+    TradingAgentBenchAccess::setQuote(agent, 67000.5, 67001.0);
+    for (auto _ : state) {
+        TradingAgentBenchAccess::updatePositionPnL(agent);
+    }
+    TradingAgentBenchAccess::openPositions(agent, 0, 0.0);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_UpdatePositionPnL)->Arg(1)->Arg(8)->Arg(64);
+
+// Dashboard read of the published agent state with Arg(0) open positions;
+// costs the same regardless of how many positions the snapshot holds
+void BM_AgentSnapshotRead(benchmark::State& state) {
+    auto& agent = bench_agent();
+    TradingAgentBenchAccess::openPositions(agent, static_cast<size_t>(state.range(0)), 67000.0);
+    agent.publishSnapshot(true);
+    uint64_t before = g_allocations.load();
+    for (auto _ : state) {
+        auto snapshot = agent.snapshot();
+        benchmark::DoNotOptimize(snapshot->unrealized_pnl);
+    }
+    report_allocations(state, before);
+    TradingAgentBenchAccess::openPositions(agent, 0, 0.0);
+    agent.publishSnapshot(true);
+}
+BENCHMARK(BM_AgentSnapshotRead)->Arg(0)->Arg(64);
+
+// Cross-thread handoff through the ring the pipeline uses between stages;
+// the producer keeps it as full as it can
+void BM_SpscQueueHandoff(benchmark::State& state) {
+    struct Tick {
+        double bid;
+        double ask;
+    };
+    SpscQueue<Tick> queue(static_cast<size_t>(state.range(0)));
+    std::atomic<bool> done{false};
+    std::thread producer([&] {
+        Tick tick{67000.0, 67000.5};
+        while (!done.load(std::memory_order_relaxed)) {
+            queue.try_push(tick);
+        }
+    });
+
+    Tick tick{};
+    uint64_t before = g_allocations.load();
+    for (auto _ : state) {
+        while (!queue.try_pop(tick)) {
+        }
+        benchmark::DoNotOptimize(tick);
+    }
+    report_allocations(state, before);
+    done.store(true);
+    producer.join();
+    state.counters["producer_rejects"] = static_cast<double>(queue.rejected());
+}
+BENCHMARK(BM_SpscQueueHandoff)->Arg(64)->Arg(1024)->UseRealTime();
+
+// Reader cost with a writer updating the same instrument continuously;
+// Arg(0) runs without the writer
+void BM_MarketBoardQuote(benchmark::State& state) {
+    MarketBoard board;
+    board.update_book("BTC-PERPETUAL", 67000.0, 67000.5, 1, 0);
+    std::atomic<bool> done{false};
+    std::thread writer;
+    if (state.range(0)) {
+        writer = std::thread([&] {
+            for (int64_t change_id = 2; !done.load(std::memory_order_relaxed); ++change_id) {
+                board.update_book("BTC-PERPETUAL", 67000.0, 67000.5, change_id, 0);
+            }
+        });
+    }
+
+    uint64_t before = g_allocations.load();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(board.quote("BTC-PERPETUAL"));
+    }
+    report_allocations(state, before);
+    done.store(true);
+    if (writer.joinable()) {
+        writer.join();
+    }
+}
+BENCHMARK(BM_MarketBoardQuote)->Arg(0)->Arg(1)->UseRealTime();
+
+// Feature refresh after a change to a 20-level book, plus one trade, then
+// the publish and a strategy's read through the board
+void BM_BookFeaturesUpdate(benchmark::State& state) {
+    OrderBook book(true);
+    message_json snapshot = {{"change_id", 1}, {"bids", message_json::array()}, {"asks", message_json::array()}};
+    for (int level = 0; level < 20; ++level) {
+        snapshot["bids"].push_back({67000.0 - level * 0.5, 1000.0 + level});
+        snapshot["asks"].push_back({67000.5 + level * 0.5, 1500.0 - level});
+    }
+    book.apply(snapshot);
+
+    BookFeatures features;
+    MarketBoard board;
+    int64_t timestamp_ms = 1718200000000;
+    uint64_t before = g_allocations.load();
+    for (auto _ : state) {
+        ++timestamp_ms;
+        features.on_book(book, timestamp_ms);
+        features.on_trade(timestamp_ms % 3 != 0, 10.0, timestamp_ms);
+        board.update_features("BTC-PERPETUAL", features.values());
+        benchmark::DoNotOptimize(board.features("BTC-PERPETUAL"));
+    }
+    report_allocations(state, before);
+}
+BENCHMARK(BM_BookFeaturesUpdate);
+
+// One trade onto a full tape with tick and volume bars on, published as
+// its own batch; the window and bars stay current without rescanning
+void BM_TradeTapeAppend(benchmark::State& state) {
+    TradeTape::Settings settings;
+    settings.capacity = 4096;
+    settings.tick_bar = 100.0;
+    settings.volume_bar = 50000.0;
+    TradeTape tape(settings);
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> price(66990.0, 67010.0);
+    std::uniform_real_distribution<double> amount(10.0, 1000.0);
+    std::vector<TradeTape::Trade> trades(1024);
+    for (size_t i = 0; i < trades.size(); ++i) {
+        trades[i] = {0, price(rng), amount(rng), i % 3 != 0};
+    }
+
+    int64_t timestamp_ms = 1718200000000;
+    size_t i = 0;
+    uint64_t before = g_allocations.load();
+    for (auto _ : state) {
+        TradeTape::Trade trade = trades[i++ % trades.size()];
+        trade.timestamp_ms = ++timestamp_ms;
+        tape.on_trade(trade);
+        tape.publish();
+    }
+    report_allocations(state, before);
+    auto stats = tape.stats();
+    state.SetLabel(std::to_string(stats.window_trades) + " in window, VWAP " + std::to_string(stats.vwap));
+}
+BENCHMARK(BM_TradeTapeAppend);
+
+// Level updates spread over many instruments' books, with the levels on the
+// heap (Arg 0), in a pool over huge pages (Arg 1) or in the same pool over
+// 4 KB pages (Arg 2). The heap books are built with unrelated allocations
+// in between, as in a long-running process, so their nodes scatter over
+// many more pages. Arg 0 against 2 is the gain from packing the nodes;
+// only 1 against 2 is the page size, and only the dTLB counter, where the
+// PMU exposes it, shows misses. huge_kb says whether THP really backed
+// the pool: at 0 the two pool runs measure the same thing.
+void BM_MultiInstrumentBookUpdate(benchmark::State& state) {
+    constexpr size_t kInstruments = 256;
+    constexpr size_t kLevels = 500;
+
+    std::unique_ptr<HugePagePool> pool;
+    std::pmr::memory_resource* resource = std::pmr::new_delete_resource();
+    if (state.range(0)) {
+        pool = std::make_unique<HugePagePool>(HugePagePool::Sharing::SINGLE_THREAD,
+                                              16 * HugePageResource::kHugePageSize, state.range(0) == 1);
+        resource = pool->resource();
+    }
+
+    std::vector<OrderBook::AskLevels> books;
+    books.reserve(kInstruments);
+    for (size_t i = 0; i < kInstruments; ++i) {
+        books.emplace_back(resource);
+    }
+    std::vector<std::unique_ptr<char[]>> noise;
+    for (size_t level = 0; level < kLevels; ++level) {
+        for (auto& book : books) {
+            book.emplace(67000.0 + level * 0.5, 1.0);
+            noise.emplace_back(new char[96]);
+        }
+    }
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<size_t> pick_book(0, kInstruments - 1);
+    std::uniform_int_distribution<size_t> pick_level(0, kLevels - 1);
+    TlbMissCounter tlb;
+    if (tlb.available()) {
+        tlb.start();
+    }
+    for (auto _ : state) {
+        auto& book = books[pick_book(rng)];
+        auto it = book.find(67000.0 + pick_level(rng) * 0.5);
+        it->second += 1.0;
+        benchmark::DoNotOptimize(it->second);
+    }
+    std::string label = pool ? HugePageResource::backing_name(pool->pages().backing()) : "heap";
+    if (tlb.available()) {
+        state.counters["dtlb_misses_per_iter"] = benchmark::Counter(
+            static_cast<double>(tlb.stop()), benchmark::Counter::kAvgIterations);
+    } else {
+        label += ", no dTLB counter";
+    }
+    state.counters["huge_kb"] = static_cast<double>(anon_huge_kb());
+    state.SetLabel(label);
+}
+BENCHMARK(BM_MultiInstrumentBookUpdate)->Arg(0)->Arg(1)->Arg(2);
+
+// Cold start cost of an option-heavy universe: parsing a get_instruments
+// response (Arg 0) against mapping the universe file written from it
+// (Arg 1). Both end with one lookup, as the first order would make.
+void BM_InstrumentUniverseLoad(benchmark::State& state) {
+    json instruments = json::array();
+    std::vector<InstrumentCache::Entry> entries;
+    for (int expiry = 0; expiry < 12; ++expiry) {
+        for (int strike = 0; strike < 200; ++strike) {
+            for (char type : {'C', 'P'}) {
+                std::string name = "BTC-" + std::to_string(expiry + 1) + "JAN27-" +
+                                   std::to_string(40000 + strike * 500) + "-" + type;
+                instruments.push_back({
+                    {"instrument_name", name}, {"kind", "option"}, {"contract_size", 1.0},
+                    {"min_trade_amount", 0.1}, {"tick_size", 0.0005}, {"strike", 40000.0 + strike * 500},
+                    {"option_type", type == 'C' ? "call" : "put"},
+                    {"expiration_timestamp", 1800000000000 + expiry * 86400000LL},
+                    {"base_currency", "BTC"}, {"quote_currency", "BTC"}, {"settlement_period", "month"},
+                    {"is_active", true}, {"creation_timestamp", 1700000000000}
+                });
+                InstrumentSpec spec;
+                spec.kind = InstrumentKind::OPTION;
+                spec.strike = 40000.0 + strike * 500;
+                spec.option_type = type;
+                entries.emplace_back(name, spec);
+            }
+        }
+    }
+    const std::string body = json{{"jsonrpc", "2.0"}, {"id", 1}, {"result", instruments}}.dump();
+    const std::string path = "deribit_bench_instruments.bin";
+    InstrumentCache::write(path, entries, 0);
+    const std::string wanted = entries[entries.size() / 2].first;
+
+    for (auto _ : state) {
+        if (state.range(0) == 0) {
+            json response = json::parse(body);
+            std::unordered_map<std::string, InstrumentSpec> universe;
+            for (const auto& instrument : response["result"]) {
+                InstrumentSpec spec;
+                spec.contract_size = instrument.value("contract_size", 1.0);
+                spec.tick_size = instrument.value("tick_size", 0.0);
+                spec.strike = instrument.value("strike", 0.0);
+                universe[instrument["instrument_name"].get<std::string>()] = spec;
+            }
+            benchmark::DoNotOptimize(universe.find(wanted));
+        } else {
+            auto file = InstrumentCache::open(path);
+            benchmark::DoNotOptimize(file->find(wanted));
+        }
+    }
+    std::remove(path.c_str());
+    state.SetLabel(std::to_string(entries.size()) + " instruments");
+}
+BENCHMARK(BM_InstrumentUniverseLoad)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+
+// Arg 0: every option repriced, as on the periodic full refresh. Arg 1: the
+// forward of one expiry moves. Arg 2: a handful of quotes change.
+void BM_OptionsChainRefresh(benchmark::State& state) {
+    constexpr int64_t kNow = 1800000000000;
+    constexpr int64_t kDayMs = 86400000;
+    constexpr double kForward = 60000.0;
+    OptionsChain chain;
+    struct Quote { size_t index; double bid; double ask; };
+    std::vector<Quote> quotes;
+    std::vector<std::vector<size_t>> expiries(12);
+    for (int expiry = 0; expiry < 12; ++expiry) {
+        for (int strike = 0; strike < 200; ++strike) {
+            for (char type : {'C', 'P'}) {
+                InstrumentSpec spec;
+                spec.kind = InstrumentKind::OPTION;
+                spec.strike = 30000.0 + strike * 300;
+                spec.option_type = type;
+                spec.expiration_ms = kNow + (expiry + 1) * 7 * kDayMs;
+                size_t index = chain.add_option(
+                    "BTC-" + std::to_string(expiry) + "-" + std::to_string(strike) + "-" + type, spec);
+                double years = (expiry + 1) * 7.0 / 365.0;
+                double skew = std::log(spec.strike / kForward);
+                double vol = 0.55 - 0.2 * skew + 0.6 * skew * skew;
+                double mid = OptionsChain::black76_price(kForward, spec.strike, years, vol, type == 'C') / kForward;
+                quotes.push_back({index, mid * 0.99, mid * 1.01 + 0.0001});
+                expiries[expiry].push_back(index);
+            }
+        }
+    }
+    for (const auto& quote : quotes) {
+        chain.update_quote(quote.index, quote.bid, quote.ask, kForward);
+    }
+    // The first refresh is the full one; the rest stay inside its interval
+    chain.refresh(kNow);
+
+    size_t tick = 0;
+    size_t recomputed = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        ++tick;
+        if (state.range(0) == 0) {
+            for (const auto& quote : quotes) {
+                chain.update_quote(quote.index, quote.bid, quote.ask, kForward + (tick % 1001) * 0.001);
+            }
+        } else if (state.range(0) == 1) {
+            const auto& members = expiries[tick % expiries.size()];
+            chain.update_quote(members.front(), quotes[members.front()].bid, quotes[members.front()].ask,
+                               kForward + (tick % 1001) * 0.001);
+        } else {
+            for (size_t k = 0; k < 8; ++k) {
+                const auto& quote = quotes[(tick * 8 + k) * 37 % quotes.size()];
+                chain.update_quote(quote.index, quote.bid * (1.0 + 1e-6 * (tick % 1001)), quote.ask, 0.0);
+            }
+        }
+        state.ResumeTiming();
+        recomputed = chain.refresh(kNow);
+        benchmark::DoNotOptimize(recomputed);
+    }
+    state.SetLabel(std::to_string(recomputed) + " of " + std::to_string(chain.size()) + " repriced, " +
+                   std::to_string(chain.valid_count()) + " valid");
+}
+BENCHMARK(BM_OptionsChainRefresh)->Arg(0)->Arg(1)->Arg(2)->Unit(benchmark::kMicrosecond);
+
+// Pre-trade check against the whole book with Arg instruments held; the
+// cost should not grow with the book
+void BM_PortfolioRiskCheck(benchmark::State& state) {
+    PortfolioRisk risk;
+    PortfolioRisk::Limits limits;
+    limits.max_delta = 1e7;
+    limits.max_gross_notional = 1e8;
+    risk.set_limits(limits);
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        InstrumentSpec spec;
+        spec.inverse = i % 2 == 0;
+        size_t slot = risk.add_instrument("BTC-" + std::to_string(i), spec);
+        risk.update_price(slot, 60000.0 + i);
+        risk.on_fill(slot, i % 3 == 0 ? -10.0 : 10.0);
+    }
+
+    size_t slot = static_cast<size_t>(state.range(0) / 2);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(risk.check_order(slot, 10.0));
+    }
+    state.SetLabel(std::to_string(risk.exposure().positions) + " positions");
+}
+BENCHMARK(BM_PortfolioRiskCheck)->Arg(1)->Arg(16)->Arg(256);
+
+// One VaR run of 1M paths over two correlated underlyings on Arg workers
+void BM_MonteCarloVar(benchmark::State& state) {
+    MonteCarloVar::Settings settings;
+    settings.threads = static_cast<size_t>(state.range(0));
+    MonteCarloVar var(settings);
+    std::mt19937_64 rng(42);
+    std::normal_distribution<double> shock(0.0, 1e-4);
+    double btc = 60000.0, eth = 3000.0;
+    for (size_t i = 0; i < MonteCarloVar::kMaxSamples; ++i) {
+        double common = shock(rng);
+        btc *= std::exp(common + shock(rng));
+        eth *= std::exp(common + shock(rng));
+        var.record_prices({{"BTC", btc}, {"ETH", eth}});
+    }
+    std::vector<MonteCarloVar::Exposure> exposures{{"BTC", 250000.0, -4000.0}, {"ETH", -100000.0, 1500.0}};
+
+    std::shared_ptr<const MonteCarloVar::Result> result;
+    for (auto _ : state) {
+        result = var.run(exposures);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(settings.paths));
+    state.SetLabel("VaR " + std::to_string(static_cast<int64_t>(result->var)) + " USD");
+}
+BENCHMARK(BM_MonteCarloVar)->Arg(1)->Arg(4)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+}  // namespace
+
+// Writes JSON results to deribit_bench.json unless --benchmark_out is given,
+// so runs from different builds can be compared with compare.py
+int main(int argc, char** argv) {
+    std::vector<char*> args(argv, argv + argc);
+    bool has_out = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strncmp(argv[i], "--benchmark_out=", 16) == 0) {
+            has_out = true;
+        }
+    }
+
+    std::string out_arg = "--benchmark_out=deribit_bench.json";
+    std::string format_arg = "--benchmark_out_format=json";
+    if (!has_out) {
+        args.push_back(out_arg.data());
+        args.push_back(format_arg.data());
+    }
+
+    int new_argc = static_cast<int>(args.size());
+    benchmark::Initialize(&new_argc, args.data());
+    if (benchmark::ReportUnrecognizedArguments(new_argc, args.data())) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
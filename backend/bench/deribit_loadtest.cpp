@@ -0,0 +1,412 @@
+// Drives synthetic book and trade notifications through DeribitTrader's
+// receive path (local books, book features, trade tapes and the market
+// board, as in production) into TradingAgent at a configured rate and
+// checks the results against a stored baseline. Exits non-zero when
+// throughput, latency or drop rate regress past the tolerance.
+//
+//   deribit_loadtest --rate 100000 --duration 10 --profile bursty
+//                    --baseline loadtest_baseline.json
+//
+// Baselines are per profile and rate and machine specific; record them on
+// the reference host with --write-baseline before using them as a gate.
+
+#include "deribit_trader.hpp"
+#include "trading_agent.hpp"
+#include <cmath>
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    double rate = 100000.0;        // Average messages per second
+    int duration = 10;             // Seconds of generated feed
+    std::string profile = "steady";// "steady" or "bursty"
+    size_t queue_capacity = 65536; // Frames buffered before the feed drops
+    int instruments = 4;
+    std::string baseline_path;
+    bool write_baseline = false;
+    double tolerance = 0.2;        // Allowed relative regression
+};
+
+struct Frame {
+    const std::string* payload;
+    Clock::time_point sent;
+};
+
+struct Results {
+    uint64_t generated = 0;
+    uint64_t processed = 0;
+    uint64_t dropped = 0;
+    uint64_t conflated = 0;
+    bool books_valid = false;
+    double elapsed_seconds = 0.0;
+    HistogramSnapshot receive_latency;
+    HistogramSnapshot end_to_end_latency;
+
+    double throughput() const { return elapsed_seconds > 0 ? processed / elapsed_seconds : 0.0; }
+    double drop_ratio() const { return generated ? static_cast<double>(dropped) / generated : 0.0; }
+};
+
+// Bounded hand-off between the feed and receive threads. The feed drops
+// frames when the receiver falls behind by more than the capacity.
+class FrameQueue {
+public:
+    explicit FrameQueue(size_t capacity) : capacity_(capacity) {
+        pending_.reserve(capacity);
+    }
+
+    size_t push(const std::vector<Frame>& frames) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t room = capacity_ - pending_.size();
+        size_t accepted = std::min(room, frames.size());
+        pending_.insert(pending_.end(), frames.begin(), frames.begin() + accepted);
+        cv_.notify_one();
+        return frames.size() - accepted;
+    }
+
+    bool pop_all(std::vector<Frame>& out) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait_for(lock, std::chrono::milliseconds(10), [this] { return !pending_.empty() || closed_; });
+        out.clear();
+        out.swap(pending_);
+        pending_.reserve(capacity_);
+        return !(closed_ && out.empty());
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        cv_.notify_one();
+    }
+
+private:
+    size_t capacity_;
+    std::vector<Frame> pending_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool closed_ = false;
+};
+
+std::string instrument_name(int index) {
+    return index == 0 ? "BTC-PERPETUAL" : "SYN" + std::to_string(index) + "-PERPETUAL";
+}
+
+constexpr double kCenter = 67000.0;
+constexpr double kTick = 0.5;
+constexpr int kDepth = 20;     // Levels per side in each snapshot
+constexpr int kMaxShift = 4;   // Ticks the touch may wander from the center
+
+json notification(const std::string& channel, json data) {
+    return {
+        {"jsonrpc", "2.0"},
+        {"method", "subscription"},
+        {"params", {{"channel", channel}, {"data", std::move(data)}}}
+    };
+}
+
+// Pre-rendered frames so generation cost does not cap the offered rate. The
+// cycle opens with a snapshot per instrument, so replaying it from the top
+// restarts every book, followed by changes chained by prev_change_id and a
+// trade every eighth frame. The touch moves a tick at a time within
+// kMaxShift of the center: levels it leaves are deleted and levels it
+// reaches are added, so the books stay uncrossed and bounded.
+std::vector<std::string> build_frames(int instruments) {
+    std::mt19937_64 rng(7);
+    std::uniform_int_distribution<int> move(-1, 1);
+    std::uniform_real_distribution<double> size(100.0, 5000.0);
+    std::vector<std::string> frames;
+
+    struct Book {
+        int shift = 0;
+        int64_t change_id = 68250000000;
+    };
+    std::vector<Book> books(instruments);
+    auto best_bid = [](const Book& book) { return kCenter + (book.shift - 1) * kTick; };
+    auto best_ask = [](const Book& book) { return kCenter + (book.shift + 1) * kTick; };
+
+    for (int index = 0; index < instruments; ++index) {
+        json bids = json::array();
+        json asks = json::array();
+        for (int level = 0; level < kDepth; ++level) {
+            bids.push_back({"new", kCenter - (level + 1) * kTick, size(rng)});
+            asks.push_back({"new", kCenter + (level + 1) * kTick, size(rng)});
+        }
+        std::string instrument = instrument_name(index);
+        frames.push_back(notification("book." + instrument + ".100ms", {
+            {"type", "snapshot"},
+            {"timestamp", 1718200000000},
+            {"instrument_name", instrument},
+            {"change_id", books[index].change_id},
+            {"bids", bids},
+            {"asks", asks}
+        }).dump());
+    }
+
+    for (int i = 0; i < 4096; ++i) {
+        int index = i % instruments;
+        Book& book = books[index];
+        std::string instrument = instrument_name(index);
+        int64_t timestamp = 1718200000000 + i;
+
+        json bids = json::array();
+        json asks = json::array();
+        int step = move(rng);
+        if (book.shift + step > kMaxShift || book.shift + step < -kMaxShift) {
+            step = 0;
+        }
+        if (step > 0) {
+            bids.push_back({"new", best_bid(book) + kTick, size(rng)});
+            asks.push_back({"delete", best_ask(book), 0.0});
+        } else if (step < 0) {
+            bids.push_back({"delete", best_bid(book), 0.0});
+            asks.push_back({"new", best_ask(book) - kTick, size(rng)});
+        }
+        book.shift += step;
+        bids.push_back({"change", best_bid(book), size(rng)});
+        asks.push_back({"change", best_ask(book), size(rng)});
+
+        frames.push_back(notification("book." + instrument + ".100ms", {
+            {"type", "change"},
+            {"timestamp", timestamp},
+            {"instrument_name", instrument},
+            {"prev_change_id", book.change_id},
+            {"change_id", book.change_id + 1},
+            {"bids", bids},
+            {"asks", asks}
+        }).dump());
+        ++book.change_id;
+
+        if (i % 8 == 7) {
+            bool buy = step >= 0;
+            frames.push_back(notification("trades." + instrument + ".100ms", json::array({{
+                {"timestamp", timestamp},
+                {"price", buy ? best_ask(book) : best_bid(book)},
+                {"amount", 10.0 * (1 + i % 50)},
+                {"direction", buy ? "buy" : "sell"},
+                {"instrument_name", instrument}
+            }})).dump());
+        }
+    }
+    return frames;
+}
+
+// Offered rate at time t: bursty alternates 100 ms at 5x with 400 ms at 0x
+// so the average stays at the configured rate
+double offered_rate(const Options& options, double t) {
+    if (options.profile != "bursty") {
+        return options.rate;
+    }
+    double phase = std::fmod(t, 0.5);
+    return phase < 0.1 ? options.rate * 5.0 : 0.0;
+}
+
+Results run(const Options& options) {
+    spdlog::set_level(spdlog::level::off);
+
+    DeribitTrader trader("loadtest", "loadtest", false);
+    TradingAgent agent(trader);
+    spdlog::set_level(spdlog::level::off);
+
+    // Tracked books and tapes, so frames take the production path rather
+    // than falling through to raw channel handlers
+    for (int i = 0; i < options.instruments; ++i) {
+        trader.subscribe_orderbook(instrument_name(i));
+        trader.subscribe_trades(instrument_name(i));
+    }
+
+    auto frames = build_frames(options.instruments);
+    FrameQueue queue(options.queue_capacity);
+    LatencyHistogram receive_latency;
+    LatencyHistogram end_to_end_latency;
+
+    Results results;
+
+    std::thread feed([&] {
+        auto start = Clock::now();
+        auto end = start + std::chrono::seconds(options.duration);
+        std::vector<Frame> batch;
+        double owed = 0.0;
+        size_t next = 0;
+        auto last = start;
+
+        while (Clock::now() < end) {
+            auto now = Clock::now();
+            double t = std::chrono::duration<double>(now - start).count();
+            owed += offered_rate(options, t) * std::chrono::duration<double>(now - last).count();
+            last = now;
+
+            batch.clear();
+            while (owed >= 1.0) {
+                batch.push_back({&frames[next], now});
+                next = (next + 1) % frames.size();
+                owed -= 1.0;
+            }
+            if (!batch.empty()) {
+                results.generated += batch.size();
+                results.dropped += queue.push(batch);
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        queue.close();
+    });
+
+    auto start = Clock::now();
+    std::vector<Frame> received;
+    while (queue.pop_all(received)) {
+        if (received.empty()) continue;
+
+        for (const auto& frame : received) {
+            trader.on_ws_message(*frame.payload);
+            receive_latency.record(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - frame.sent).count()));
+        }
+
+        // The agent only sees the latest book of each batch, read from the
+        // board as the feed thread does
+        results.processed += received.size();
+        results.conflated += received.size() - 1;
+        if (auto quote = trader.market_board().quote(instrument_name(0)); quote && quote->book_valid) {
+            agent.updatePrice((quote->best_bid + quote->best_ask) / 2, quote->best_bid, quote->best_ask);
+        }
+        end_to_end_latency.record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - received.back().sent).count()));
+    }
+    feed.join();
+
+    results.elapsed_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    // A gap would mean the generator broke a chain and the run measured
+    // resyncs instead of updates
+    auto features = trader.market_board().features(instrument_name(0));
+    results.books_valid = features && features->valid;
+    results.receive_latency = receive_latency.snapshot();
+    results.end_to_end_latency = end_to_end_latency.snapshot();
+    return results;
+}
+
+std::string baseline_key(const Options& options) {
+    return options.profile + "_" + std::to_string(static_cast<long long>(options.rate));
+}
+
+json to_json(const Options& options, const Results& results) {
+    return {
+        {"profile", options.profile},
+        {"rate", options.rate},
+        {"duration_s", options.duration},
+        {"generated", results.generated},
+        {"processed", results.processed},
+        {"dropped", results.dropped},
+        {"conflated", results.conflated},
+        {"books_valid", results.books_valid},
+        {"throughput_msgs_per_s", results.throughput()},
+        {"drop_ratio", results.drop_ratio()},
+        {"receive_p50_us", results.receive_latency.percentile(50.0) / 1000.0},
+        {"receive_p99_us", results.receive_latency.percentile(99.0) / 1000.0},
+        {"receive_p999_us", results.receive_latency.percentile(99.9) / 1000.0},
+        {"end_to_end_p50_us", results.end_to_end_latency.percentile(50.0) / 1000.0},
+        {"end_to_end_p99_us", results.end_to_end_latency.percentile(99.0) / 1000.0},
+        {"end_to_end_p999_us", results.end_to_end_latency.percentile(99.9) / 1000.0}
+    };
+}
+
+bool check_baseline(const Options& options, const json& current) {
+    std::ifstream file(options.baseline_path);
+    if (!file.is_open()) {
+        std::cerr << "Baseline file not found: " << options.baseline_path << std::endl;
+        return false;
+    }
+
+    json baselines = json::parse(file);
+    std::string key = baseline_key(options);
+    if (!baselines.contains(key)) {
+        std::cerr << "No baseline stored for " << key << std::endl;
+        return false;
+    }
+
+    const auto& baseline = baselines[key];
+    bool ok = true;
+    if (!current["books_valid"].get<bool>()) {
+        std::cerr << "FAILED: the synthetic books went out of sequence" << std::endl;
+        ok = false;
+    }
+    double min_throughput = baseline["throughput_msgs_per_s"].get<double>() * (1.0 - options.tolerance);
+    double max_p99 = baseline["end_to_end_p99_us"].get<double>() * (1.0 + options.tolerance);
+    // Allow a 0.1% absolute slack so a zero-drop baseline is not flaky
+    double max_drop_ratio = baseline["drop_ratio"].get<double>() * (1.0 + options.tolerance) + 0.001;
+
+    if (current["throughput_msgs_per_s"].get<double>() < min_throughput) {
+        std::cerr << "REGRESSION: throughput " << current["throughput_msgs_per_s"]
+                  << " < " << min_throughput << std::endl;
+        ok = false;
+    }
+    if (current["end_to_end_p99_us"].get<double>() > max_p99) {
+        std::cerr << "REGRESSION: end-to-end p99 " << current["end_to_end_p99_us"]
+                  << "us > " << max_p99 << "us" << std::endl;
+        ok = false;
+    }
+    if (current["drop_ratio"].get<double>() > max_drop_ratio) {
+        std::cerr << "REGRESSION: drop ratio " << current["drop_ratio"]
+                  << " > " << max_drop_ratio << std::endl;
+        ok = false;
+    }
+    return ok;
+}
+
+void write_baseline(const Options& options, const json& current) {
+    json baselines = json::object();
+    std::ifstream existing(options.baseline_path);
+    if (existing.is_open()) {
+        baselines = json::parse(existing);
+    }
+    baselines[baseline_key(options)] = current;
+    std::ofstream out(options.baseline_path);
+    out << baselines.dump(4) << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::invalid_argument("Missing value for " + arg);
+            return argv[++i];
+        };
+
+        try {
+            if (arg == "--rate") options.rate = std::stod(next());
+            else if (arg == "--duration") options.duration = std::stoi(next());
+            else if (arg == "--profile") options.profile = next();
+            else if (arg == "--queue") options.queue_capacity = std::stoul(next());
+            else if (arg == "--instruments") options.instruments = std::max(1, std::stoi(next()));
+            else if (arg == "--baseline") options.baseline_path = next();
+            else if (arg == "--write-baseline") options.write_baseline = true;
+            else if (arg == "--tolerance") options.tolerance = std::stod(next());
+            else {
+                std::cerr << "Unknown argument: " << arg << std::endl;
+                return 2;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Invalid arguments: " << e.what() << std::endl;
+            return 2;
+        }
+    }
+
+    Results results = run(options);
+    json current = to_json(options, results);
+    std::cout << current.dump(4) << std::endl;
+
+    if (options.baseline_path.empty()) {
+        return 0;
+    }
+    if (options.write_baseline) {
+        write_baseline(options, current);
+        return 0;
+    }
+    return check_baseline(options, current) ? 0 : 1;
+}
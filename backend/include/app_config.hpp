@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "deribit_trader.hpp"
+#include "monte_carlo_var.hpp"
+#include "trading_agent.hpp"
+
+// Startup settings for the terminal and the headless engine, read from a
+// JSON file. Every key is optional; for example
+//
+//   {
+//     "endpoints": {"rest_url": "https://www.deribit.com/api/v2",
+//                   "ws_host": "www.deribit.com"},
+//     "ws_sessions": 2,
+//     "instrument_cache": "/var/cache/deribit/instruments.bin",
+//     "instrument": "BTC-PERPETUAL",
+//     "watch_instruments": ["ETH-PERPETUAL"],
+//     "options_underlying": "BTC",
+//     "strategy": "mean_reversion",
+//     "risk_level": "moderate",
+//     "risk_limits": {"max_delta_usd": 50000, "max_gamma_usd": 5000,
+//                     "max_vega_usd": 2000, "max_notional_usd": 250000,
+//                     "max_var_usd": 20000},
+//     "var": {"paths": 1000000, "confidence": 0.99, "horizon_s": 86400,
+//             "sample_interval_s": 1, "interval_s": 30, "threads": 4},
+//     "trade_tape": {"capacity": 4096, "window_s": 60, "tick_bar": 100,
+//                    "volume_bar": 500000, "dollar_bar": 0},
+//     "start_trading": true,
+//     "thread_layout": "md=2,strategy=3,gateway=4",
+//     "control_socket": "/run/deribit/control.sock",
+//     "metrics_port": 9188,
+//     "frontend_origin": "http://localhost:3000"
+//   }
+//
+// API keys may sit in the file as api_key/api_secret, but the environment
+// (DERIBIT_API_KEY, DERIBIT_API_SECRET) takes precedence so they need not.
+struct AppConfig {
+    std::string api_key;
+    std::string api_secret;
+    DeribitTrader::Endpoints endpoints;
+    size_t ws_sessions = DeribitTrader::kDefaultWsSessions;
+    std::string instrument_cache = "instruments.bin";  // Empty: fetch the universe every start
+
+    std::string instrument = "BTC-PERPETUAL";     // Traded by the agent
+    std::vector<std::string> watch_instruments;   // Streamed to the market board only
+    std::string options_underlying;               // e.g. "BTC": price that whole chain; empty for none
+    TradingAgent::Strategy strategy = TradingAgent::Strategy::MOMENTUM;
+    TradingAgent::RiskLevel risk_level = TradingAgent::RiskLevel::CONSERVATIVE;
+    PortfolioRisk::Limits risk_limits;  // Whole book; unlimited unless set
+    MonteCarloVar::Settings var;
+    TradeTape::Settings trade_tape;  // Every instrument whose trades are streamed
+    std::string backfill_file;
+    bool start_trading = false;  // Headless only: start the agent at launch
+
+    std::string thread_layout;   // DERIBIT_THREAD_LAYOUT syntax; the variable wins
+    std::string control_socket = "deribit_trader.sock";
+    int metrics_port = 9188;
+    std::string frontend_origin = "http://localhost:3000";  // May read /risk; empty for no browser access
+
+    // Throws std::runtime_error naming the file and the offending key
+    static AppConfig load(const std::string& path);
+    void apply_environment();
+
+    // Names as used in the file and on the control socket, e.g.
+    // "mean_reversion" and "aggressive"; throw std::invalid_argument
+    static TradingAgent::Strategy parse_strategy(std::string_view name);
+    static TradingAgent::RiskLevel parse_risk_level(std::string_view name);
+    static const char* strategy_name(TradingAgent::Strategy strategy);
+    static const char* risk_level_name(TradingAgent::RiskLevel risk);
+};
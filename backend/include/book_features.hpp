@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+class OrderBook;
+
+// Microstructure features of one instrument, kept current from its local
+// book and trade stream by the session thread carrying both channels. Each
+// book change costs a walk of the best kDepthLevels per side and each
+// trade a few multiplies; MarketBoard publishes the values for readers.
+//
+// Order flow imbalance follows Cont, Kukanov and Stoikov: every book
+// update adds the size arriving at the best bid minus the size arriving
+// at the best ask, counting a price improvement as all new size and a
+// retreat as all size removed. Flow and traded volume decay exponentially
+// with the half-life, in exchange time.
+class BookFeatures {
+public:
+    static constexpr size_t kDepthLevels = 5;
+    static constexpr std::chrono::milliseconds kDefaultHalfLife{5000};
+
+    struct Values {
+        bool valid;               // A two-sided book since the last reset
+        double microprice;        // Mid pulled toward the side with less size
+        double top_imbalance;     // (bid size - ask size) / total at the best level, in [-1, 1]
+        double depth_imbalance;   // The same over the best kDepthLevels per side
+        double bid_depth;         // Size over the best kDepthLevels bids
+        double ask_depth;
+        double ofi;               // Decayed order flow imbalance, in order units
+        double ofi_ratio;         // ofi over the decayed sum of |flow|, in [-1, 1]
+        double signed_volume;     // Decayed taker buys minus sells
+        double volume_ratio;      // signed_volume over decayed traded volume, in [-1, 1]
+        int64_t timestamp_ms;     // Exchange time of the latest input
+    };
+
+    explicit BookFeatures(std::chrono::milliseconds half_life = kDefaultHalfLife);
+
+    // After every snapshot or change applied to the book
+    void on_book(const OrderBook& book, int64_t timestamp_ms);
+    void on_trade(bool buy, double amount, int64_t timestamp_ms);
+    // The book was cleared; flow restarts from the next two-sided book
+    void reset();
+
+    const Values& values() const { return values_; }
+
+private:
+    // Brings the decayed sums forward to timestamp_ms
+    void decay_to(int64_t timestamp_ms);
+    void publish_ratios();
+
+    double decay_per_ms_;  // ln 2 / half-life
+
+    // Best level seen at the previous book update
+    bool has_top_ = false;
+    double bid_price_ = 0.0;
+    double bid_size_ = 0.0;
+    double ask_price_ = 0.0;
+    double ask_size_ = 0.0;
+
+    double flow_abs_ = 0.0;    // Decayed sum of |flow|, the ofi_ratio scale
+    double volume_ = 0.0;      // Decayed traded volume
+    int64_t decayed_at_ms_ = 0;
+
+    Values values_{};
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+
+// Line-oriented command socket for headless runs. It listens on a Unix
+// domain socket, so only local users with access to the socket file can
+// reach it. Clients share the server's own thread through one poll set,
+// so an idle client cannot lock the others out, and every request line gets
+// exactly one reply line from the handler. That makes this thread the
+// single control thread that TradingPipeline expects. Clients idle for a
+// minute are disconnected.
+class ControlServer {
+public:
+    using Handler = std::function<std::string(const std::string& command)>;
+
+    ControlServer(std::string path, Handler handler);
+    ~ControlServer();
+
+    ControlServer(const ControlServer&) = delete;
+    ControlServer& operator=(const ControlServer&) = delete;
+
+    // Replaces a stale socket left by a previous run; throws if the path is
+    // taken by anything else or cannot be bound owner-only. Briefly narrows
+    // the process umask, so files other threads create meanwhile are
+    // owner-only too
+    void start();
+    void stop();
+
+    const std::string& path() const { return path_; }
+
+private:
+    struct Client {
+        int fd;
+        std::string pending;  // Received bytes short of a full line
+        std::chrono::steady_clock::time_point last_active;
+    };
+
+    void serve_loop();
+    // Reads what the client sent and answers every complete line; false
+    // once the client should be closed
+    bool serve_client(Client& client);
+
+    std::string path_;
+    Handler handler_;
+    int listen_fd_{-1};
+    std::atomic<bool> running_{false};
+    std::thread server_thread_;
+};
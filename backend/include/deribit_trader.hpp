@@ -1,16 +1,34 @@
 #pragma once
 
+#include <atomic>
 #include <string>
+#include <string_view>
 #include <map>
+#include <unordered_map>
+#include <set>
+#include <deque>
+#include <optional>
 #include <vector>
 #include <functional>
+#include <future>
 #include <memory>
 #include <chrono>
 #include <thread>
 #include <mutex>
-#include <libwebsockets.h>
+#include <condition_variable>
 #include <nlohmann/json.hpp>
 #include <spdlog/spdlog.h>
+#include "latency_tracker.hpp"
+#include "metrics_server.hpp"
+#include "message_arena.hpp"
+#include "order_encoder.hpp"
+#include "order_book.hpp"
+#include "book_features.hpp"
+#include "trade_tape.hpp"
+#include "ws_session.hpp"
+#include "market_board.hpp"
+#include "huge_page_pool.hpp"
+#include "instrument_cache.hpp"
 
 using json = nlohmann::json;
 
@@ -27,6 +45,29 @@ public:
         std::string time_in_force{"good_til_cancelled"};
     };
 
+    // Notification batching: raw needs an authenticated session, 100ms and
+    // agg2 aggregate changes over the interval
+    enum class FeedInterval {
+        RAW,
+        MS_100,
+        AGG2
+    };
+
+    // depth 0 subscribes to the full incremental book; depth 1, 10 or 20
+    // to a grouped book capped at that many levels, optionally with prices
+    // grouped into buckets ("none" or a tick multiple such as "5")
+    struct BookSubscription {
+        FeedInterval interval;
+        int depth;
+        std::string group;
+    };
+
+    struct TopOfBook {
+        double best_bid;
+        double best_ask;
+        int64_t change_id;
+    };
+
     struct OpenOrder {
         std::string order_id;
         std::string instrument_name;
@@ -38,62 +79,325 @@ public:
         std::string time_in_force;
     };
 
-    DeribitTrader(const std::string& api_key, const std::string& api_secret);
+    using InstrumentSpec = ::InstrumentSpec;
+
+    // Seconds from construction until each startup phase finished. The
+    // phases run concurrently, so they overlap rather than add up.
+    struct StartupReport {
+        double tls_init = 0.0;
+        double rest_auth = 0.0;
+        double instruments = 0.0;  // 0 when the universe could not be loaded
+        double ws_ready = 0.0;
+        double total = 0.0;
+        size_t instrument_count = 0;
+        bool instruments_from_file = false;  // Mapped from disk; refreshed in the background
+    };
+
+    static constexpr size_t kDefaultWsSessions = 2;
+
+    // Testnet unless configured otherwise; production is www.deribit.com
+    struct Endpoints {
+        std::string rest_url = "https://test.deribit.com/api/v2";
+        std::string ws_host = "test.deribit.com";
+        int ws_port = 443;
+        std::string ws_path = "/ws/api/v2";
+    };
+
+    // With connect = false no network I/O happens (benchmarks, offline tools).
+    // Market data is spread over ws_sessions WebSocket connections by
+    // instrument; orders go over a separate persistent HTTP session.
+    // Construction does not wait for the network: the sessions connect on
+    // their own threads while REST auth and the instrument universe load run
+    // in the background, and ready() reports when all of them are done.
+    DeribitTrader(const std::string& api_key, const std::string& api_secret, bool connect = true,
+                  size_t ws_sessions = kDefaultWsSessions);
+    // With an instrument_cache path the universe is mapped from that file
+    // at construction, so readiness does not wait for get_instruments; the
+    // file is then revalidated in the background and replaced atomically.
+    DeribitTrader(const std::string& api_key, const std::string& api_secret, const Endpoints& endpoints,
+                  bool connect = true, size_t ws_sessions = kDefaultWsSessions,
+                  const std::string& instrument_cache = "");
     ~DeribitTrader();
 
+    // Completes once REST auth, the instrument universe and the auth of every
+    // WebSocket session are in; get() rethrows the first fatal failure.
+    // Subscriptions made before then are sent as each session authenticates.
+    std::shared_future<StartupReport> ready() const { return ready_; }
+    // Seconds from construction to the first acknowledged order; 0 until then
+    double time_to_first_order() const { return first_order_seconds_.load(); }
+    double seconds_since_construction() const;
+
     // Public methods
-    struct lws_context* get_ws_context() { return ws_context_; }
     json get_instrument_details(const std::string& instrument_name);
+    // From the universe loaded at startup; instruments missing from it are
+    // fetched once and cached
+    std::optional<InstrumentSpec> instrument_spec(const std::string& instrument_name);
+    // Loaded instruments of one kind whose names start with prefix, e.g.
+    // OPTION and "BTC-"; empty until the universe is in
+    std::vector<InstrumentCache::Entry> list_instruments(InstrumentKind kind, std::string_view prefix);
     double round_to_contract_size(const std::string& instrument_name, double amount);
     double get_minimum_order_amount(const std::string& instrument_name);
     std::string place_order(const OrderRequest& request);
+    // Allocates from the calling thread's MessageArena when a scope is open
+    static message_json build_order_payload(const OrderRequest& request, double amount);
     bool cancel_order(const std::string& order_id);
     std::vector<OpenOrder> get_open_orders(const std::string& instrument_name = "");
     bool modify_order(const std::string& order_id, double new_amount, double new_price, 
                      const std::string& advanced = "");
     json get_orderbook(const std::string& instrument_name, int depth = 20);
+    json get_tradingview_chart_data(const std::string& instrument_name, int64_t start_timestamp,
+                                    int64_t end_timestamp, const std::string& resolution = "1");
+    json get_last_trades(const std::string& instrument_name, int count = 100);
+    // Subscriptions are remembered and restored after every reconnect. One
+    // local book is kept per instrument; subscribing with other options
+    // replaces the previous book channel.
     void subscribe_orderbook(const std::string& instrument_name);
-    void subscribe_trades(const std::string& instrument_name);
-    void on_ws_connect();
-    void on_ws_message(const std::string& message);
-    void on_ws_close();
+    void subscribe_orderbook(const std::string& instrument_name, const BookSubscription& options);
+    // Also starts the instrument's trade tape, with the settings current at
+    // its first subscription
+    void subscribe_trades(const std::string& instrument_name,
+                          FeedInterval interval = FeedInterval::MS_100);
+    void set_trade_tape_settings(const TradeTape::Settings& settings) { tape_settings_ = settings; }
+    // Null until trades are subscribed; the tape lives as long as the trader,
+    // so callers resolve it once rather than per use
+    const TradeTape* trade_tape(std::string_view instrument) const;
+    // Ticker channels for many instruments at once, e.g. a whole options
+    // chain; sent as a few batched subscribe requests per session. Every
+    // ticker notification goes to the ticker handler, which must be set
+    // before the first subscription.
+    void subscribe_tickers(const std::vector<std::string>& instrument_names,
+                           FeedInterval interval = FeedInterval::MS_100);
+    using TickerHandler = std::function<void(std::string_view instrument, const message_json& data)>;
+    void set_ticker_handler(TickerHandler handler) { ticker_handler_ = std::move(handler); }
+    void unsubscribe(const std::string& channel);
+    static std::string book_channel(const std::string& instrument_name, const BookSubscription& options);
+    static std::string trades_channel(const std::string& instrument_name, FeedInterval interval);
+    static std::string ticker_channel(const std::string& instrument_name, FeedInterval interval);
+    static const char* interval_name(FeedInterval interval);
+    // Local book maintained from the book channel; empty while resyncing
+    std::optional<TopOfBook> top_of_book(const std::string& instrument_name) const;
+    // Top of book and last trade per instrument, updated by the session
+    // threads and readable from any thread without locks
+    MarketBoard& market_board() { return market_board_; }
+    const MarketBoard& market_board() const { return market_board_; }
+    // True from a disconnect or sequence gap until every book is resynced
+    bool market_data_stale() const { return market_data_stale_.load(std::memory_order_acquire); }
+    // Safe while sessions run, but register before subscribing or the first
+    // notifications go unrouted. Handlers run on the service thread of the
+    // session carrying the channel, so handlers for instruments on different
+    // sessions can run concurrently; they must not keep references to the
+    // notification past the call.
+    void set_channel_handler(const std::string& channel,
+                             std::function<void(const message_json&)> handler);
+    LatencyTracker& latency() { return latency_; }
+    void register_metrics(MetricsServer& server);
+    // Round trip of public/test probes and exchange-to-local notification
+    // latency, both in nanoseconds
+    const LatencyHistogram& ws_rtt() const { return ws_rtt_; }
+    const LatencyHistogram& feed_latency() const { return feed_latency_; }
+    // Exchange clock minus local wall clock, from the lowest-RTT get_time sample
+    double clock_offset_ms() const { return clock_offset_ms_.load(); }
+    size_t ws_session_count() const { return sessions_.size(); }
+    // Session index a channel is routed to; all channels of one instrument
+    // share a session so their relative order is preserved
+    size_t shard_for(std::string_view channel) const;
+    // Feeds a frame through the market data path as if received on a session
+    void on_ws_message(std::string_view message);
 
 private:
+    // Immutable once published; readers take a snapshot with std::atomic_load
+    // and the refresher swaps in a new one with std::atomic_store
+    struct AuthToken {
+        std::string access_token;
+        std::string refresh_token;
+        std::string auth_header;  // "Authorization: Bearer <access_token>"
+        std::chrono::steady_clock::time_point expires_at;
+        std::chrono::steady_clock::time_point refresh_at;
+    };
+
     // API credentials and connection details
-    std::string ws_access_token_;
-    std::string refresh_token_;
     std::string api_key_;
     std::string api_secret_;
-    std::string base_url_{"https://test.deribit.com/api/v2"};
-    std::string ws_url_{"wss://test.deribit.com/ws/api/v2"};
-    
-    // WebSocket connection
-    struct lws_context* ws_context_{nullptr};
-    struct lws* ws_connection_{nullptr};
+    Endpoints endpoints_;
     
-    // Callback handlers
-    std::map<std::string, std::function<void(const json&)>> message_handlers_;
+    // Persistent keep-alive handle for authenticated requests, so order
+    // entry reuses one warm TLS connection instead of dialing per call
+    void* order_curl_{nullptr};
+    std::mutex order_http_mutex_;
+
+    // Local book of one instrument, with the features derived from it and
+    // the instrument's trades. Books live in the session carrying the
+    // instrument's channels.
+    struct BookState {
+        std::string channel;
+        OrderBook book;
+        bool resyncing{false};
+        BookFeatures features{};
+    };
+    // Books resyncing over all sessions; moved under the owning session's
+    // books_mutex
+    std::atomic<size_t> books_resyncing_{0};
+    std::atomic<bool> market_data_stale_{false};
+    std::chrono::steady_clock::time_point stale_since_;  // Guarded by stale_mutex_
+    std::mutex stale_mutex_;  // Serializes the stale and recovered transitions
+    MarketBoard market_board_;
+    TradeTape::Settings tape_settings_;
+
+    // Heartbeat and latency probes
+    enum class ProbeKind { RTT, TIME_SYNC, SILENT };
+    struct PendingProbe {
+        ProbeKind kind;
+        std::chrono::steady_clock::time_point sent;
+        double sent_wall_ms;
+    };
+    struct TimeSample {
+        uint64_t rtt_ns;
+        double offset_ms;
+    };
+    std::deque<TimeSample> time_samples_;  // Session 0's thread only
+    LatencyHistogram ws_rtt_;
+    LatencyHistogram feed_latency_;
+    MetricGauge clock_offset_ms_;
+    std::atomic<bool> clock_synced_{false};
     
-    // Authentication token
-    std::string access_token_;
-    int64_t token_expiry_{0};
+    // Callback handlers, keyed by subscription channel. The table is never
+    // changed once published: registration copies it, swaps the copy in
+    // with atomic_store, and session threads read it with atomic_load, so
+    // handlers may be set while sessions are running.
+    struct ChannelRoute {
+        std::function<void(const message_json&)> handler;
+        MetricCounter messages;
+    };
+    using RouteTable = std::map<std::string, std::shared_ptr<ChannelRoute>, std::less<>>;
+    std::shared_ptr<const RouteTable> message_handlers_{std::make_shared<const RouteTable>()};
+    TickerHandler ticker_handler_;
+    std::mutex handlers_mutex_;  // Serializes registrations
+
+    // Tick-to-order stage timings
+    LatencyTracker latency_;
+
+    // Counters written by the WebSocket thread and the order path
+    MetricCounter ws_messages_;
+    MetricCounter parse_errors_;
+    MetricCounter unrouted_notifications_;
+    MetricCounter orders_placed_;
+    MetricCounter order_errors_;
+    MetricCounter token_refreshes_;
+    MetricCounter auth_failures_;
+    MetricCounter book_gaps_;
+    MetricGauge last_recovery_seconds_;
+    MetricCounter heartbeat_requests_;
+
+    // One market data connection. Each session authenticates on its own;
+    // the probe state is touched only by that session's service thread.
+    struct SessionState {
+        size_t index;
+        std::unique_ptr<WsSession> ws;  // Null when not connecting
+        std::shared_ptr<const AuthToken> token;
+        std::atomic<uint64_t> auth_request_id{0};
+        std::atomic<bool> refresh_pending{false};
+        std::set<std::string> channels;  // Guarded by subscriptions_mutex_
+        std::map<uint64_t, PendingProbe> pending_probes;
+        std::chrono::steady_clock::time_point next_rtt_probe;
+        std::chrono::steady_clock::time_point next_time_sync;
+
+        // Books and trade tapes of the instruments this session carries, so
+        // sessions do their book work in parallel. books_mutex guards both
+        // maps against subscriptions and readers on other threads. Tapes are
+        // never removed and this session's thread is each one's only
+        // writer, filling it after the lock is released. The level pool is
+        // declared first so it outlives the books.
+        std::unique_ptr<HugePagePool> book_pool;
+        std::map<std::string, BookState, std::less<>> books;
+        std::map<std::string, std::unique_ptr<TradeTape>, std::less<>> tapes;
+        mutable std::mutex books_mutex;
+    };
+    std::vector<std::unique_ptr<SessionState>> sessions_;
+    std::mutex subscriptions_mutex_;
+
+    // Tokens for the REST and WebSocket sessions, renewed in the background
+    std::shared_ptr<const AuthToken> rest_token_;
+    std::thread token_refresher_;
+    std::mutex refresh_mutex_;
+    std::condition_variable refresh_cv_;
+    bool stop_refresher_{false};
+    bool refresh_requested_{false};
+
+    // JSON-RPC ids for requests built by this client
+    std::atomic<uint64_t> next_request_id_{1};
+
+    // Contract sizes and minimum amounts, so order validation stays local.
+    // The universe lives in the mapped file when there is one, swapped with
+    // std::atomic_store; instruments_ holds it otherwise, plus any looked
+    // up singly.
+    std::unordered_map<std::string, InstrumentSpec> instruments_;
+    std::mutex instruments_mutex_;
+    std::string instrument_cache_path_;
+    std::shared_ptr<const InstrumentCache> instrument_file_;
+
+    // Startup sequence; startup_mutex_ pairs with startup_cv_, which session
+    // threads notify on their first authentication
+    std::chrono::steady_clock::time_point constructed_at_;
+    std::shared_future<StartupReport> ready_;
+    // Instrument count and completion time of the get_instruments load
+    std::shared_future<std::pair<size_t, double>> universe_;
+    std::mutex startup_mutex_;
+    std::condition_variable startup_cv_;
+    bool startup_cancelled_{false};
+    MetricGauge startup_seconds_;
+    MetricGauge first_order_seconds_;
+    std::atomic<bool> first_order_seen_{false};
 
     // Private methods
-    static struct lws_protocols* get_protocols();
-    void connect_websocket();
+    StartupReport run_startup(StartupReport report);
+    void cancel_startup();
+    size_t load_instruments();
+    static InstrumentSpec parse_instrument_spec(const json& instrument);
+    void start_sessions();
+    bool sessions_ready() const;
+    std::string track_book(const std::string& instrument_name, const std::string& channel, bool grouped);
+    void track_channel(const std::string& channel);
+    void subscribe_channel(const std::string& channel);
+    void subscribe_channels(const std::vector<std::string>& channels);
+    void resubscribe_all(SessionState& session);
+    size_t shard_for_instrument(std::string_view instrument) const;
+    // The two helpers below expect the owning session's books_mutex to be held
+    void begin_resync(std::string_view instrument, BookState& state);
+    void request_book_resync(std::string_view instrument, BookState& state);
+    void mark_market_data_stale();
+    void check_recovered();
+    void mark_stale(SessionState& session);
+    void send_probe(SessionState& session, ProbeKind kind, const std::string& method,
+                    const json& params = json::object());
+    void run_probes(SessionState& session);
+    void handle_heartbeat(SessionState& session, const message_json& notification);
+    void handle_probe_response(const PendingProbe& probe, const message_json& response);
+    void record_feed_latency(const message_json& data);
     void init_ssl();
-    void init_websocket();
     void authenticate();
+    void refresh_rest_token();
+    void refresh_ws_token(SessionState& session);
+    void start_token_refresher();
+    void stop_token_refresher();
+    void request_token_refresh();
+    void run_token_refresher();
+    static std::shared_ptr<const AuthToken> parse_auth_result(const json& result);
     json send_public_request(const std::string& endpoint, const json& params);
     json send_authenticated_request(const std::string& endpoint, const json& params);
-    static int ws_callback(struct lws* wsi, enum lws_callback_reasons reason,
-                          void* user, void* in, size_t len);
+    json send_authenticated_payload(std::string_view endpoint, std::string_view post_data);
+    void handle_subscription(const message_json& notification);
+    bool update_book(std::string_view channel, const message_json& data);
+    bool record_trade(std::string_view channel, const message_json& data);
+    bool route_ticker(std::string_view channel, const message_json& data);
+    void on_ws_connect(SessionState& session);
+    void on_ws_disconnect(SessionState& session);
+    void handle_ws_frame(SessionState* session, std::string_view message);
     void log_message_structure(const json& message);
-    void handle_ws_authentication(const json& auth_response);
+    void handle_ws_authentication(SessionState& session, const json& auth_response);
     void handle_ws_result(const json& result_response);
     void handle_ws_error(const json& error_response);
     void subscribe_default_channels();
-    void send_ws_message(const std::string& message);
+    void send_ws_message(SessionState& session, std::string message);
     static size_t write_callback(void* contents, size_t size, size_t nmemb, void* userp);
     void cleanup();
 };
\ No newline at end of file
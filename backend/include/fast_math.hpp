@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// Branch-free scalar math for loops the compiler should vectorize. Every
+// function is arithmetic, selects and bit operations only, so a loop that
+// calls them vectorizes under -O3 -fno-math-errno -fno-trapping-math
+// without -ffast-math or a vector math library.
+namespace fast_math {
+
+constexpr double kInvSqrt2Pi = 0.3989422804014327;
+constexpr double kInvSqrt2 = 0.7071067811865476;
+
+inline uint64_t to_bits(double x) {
+    uint64_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    return bits;
+}
+
+inline double from_bits(uint64_t bits) {
+    double x;
+    std::memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+// exp and log are good to about 1e-14 relative; erfc is the Numerical
+// Recipes Chebyshev fit, within 1.2e-7 relative everywhere
+inline double fast_exp(double x) {
+    x = std::min(std::max(x, -700.0), 700.0);
+    // Adding 1.5 * 2^52 rounds to an integer that lands in the low mantissa bits
+    constexpr double kShift = 0x1.8p52;
+    double t = x * 1.4426950408889634 + kShift;
+    double n = t - kShift;
+    double r = x - n * 6.93147180369123816490e-01 - n * 1.90821492927058770002e-10;
+    double p = 1.0 + r * (1.0 + r * (1.0 / 2 + r * (1.0 / 6 + r * (1.0 / 24 + r * (1.0 / 120 +
+               r * (1.0 / 720 + r * (1.0 / 5040 + r * (1.0 / 40320 + r * (1.0 / 362880 +
+               r * (1.0 / 3628800 + r * (1.0 / 39916800)))))))))));
+    return p * from_bits((to_bits(t) + 1023) << 52);
+}
+
+// x must be positive and normal
+inline double fast_log(double x) {
+    // Split x into 2^k * m with m in [sqrt(1/2), sqrt(2))
+    constexpr uint64_t kSqrtHalf = 0x3fe6a09e667f3bcdULL;
+    uint64_t bits = to_bits(x);
+    uint64_t offset = bits - kSqrtHalf;
+    // Integer to double through the same 1.5 * 2^52 trick; SSE2 and AVX2
+    // have no vector int64 conversion
+    double k = from_bits(0x4338000000000000ULL + static_cast<uint64_t>(static_cast<int64_t>(offset) >> 52)) -
+               0x1.8p52;
+    double m = from_bits(bits - (offset & 0xfff0000000000000ULL));
+    double s = (m - 1.0) / (m + 1.0);
+    double s2 = s * s;
+    double series = 1.0 + s2 * (1.0 / 3 + s2 * (1.0 / 5 + s2 * (1.0 / 7 + s2 * (1.0 / 9 +
+                    s2 * (1.0 / 11 + s2 * (1.0 / 13 + s2 * (1.0 / 15)))))));
+    return k * 0.6931471805599453 + 2.0 * s * series;
+}
+
+inline double fast_erfc(double x) {
+    double z = std::fabs(x);
+    double t = 1.0 / (1.0 + 0.5 * z);
+    double r = t * fast_exp(-z * z - 1.26551223 + t * (1.00002368 + t * (0.37409196 + t * (0.09678418 +
+               t * (-0.18628806 + t * (0.27886807 + t * (-1.13520398 + t * (1.48851587 +
+               t * (-0.82215223 + t * 0.17087277)))))))));
+    return x >= 0.0 ? r : 2.0 - r;
+}
+
+inline double norm_cdf(double x) {
+    return 0.5 * fast_erfc(-x * kInvSqrt2);
+}
+
+inline double norm_pdf(double x) {
+    return kInvSqrt2Pi * fast_exp(-0.5 * x * x);
+}
+
+
+// [0, 1) doubles without an integer conversion, which SSE2 and AVX2 lack
+// for 64-bit lanes: the top 52 bits become the mantissa of a number in
+// [1, 2). Offset by half a step, so never 0 or 1.
+inline double uniform_from_bits(uint64_t random) {
+    return from_bits(0x3ff0000000000000ULL | (random >> 12)) - (1.0 - 0x1p-53);
+}
+
+// Inverse standard normal CDF, Acklam's rational fit, within 1.2e-9
+// relative; p must be in (0, 1). Both the central and the tail fits are
+// evaluated and the right one selected.
+inline double norm_inv(double p) {
+    constexpr double kLow = 0.02425;
+    double q = p - 0.5;
+    double r = q * q;
+    double central = (((((-3.969683028665376e+01 * r + 2.209460984245205e+02) * r - 2.759285104469687e+02) * r +
+                        1.383577518672690e+02) * r - 3.066479806614716e+01) * r + 2.506628277459239e+00) * q /
+                     (((((-5.447609879822406e+01 * r + 1.615858368580409e+02) * r - 1.556989798598866e+02) * r +
+                        6.680131188771972e+01) * r - 1.328068155288572e+01) * r + 1.0);
+
+    double t = std::sqrt(-2.0 * fast_log(std::min(p, 1.0 - p)));
+    double tail = (((((-7.784894002430293e-03 * t - 3.223964580411365e-01) * t - 2.400758277161838e+00) * t -
+                     2.549732539343734e+00) * t + 4.374664141464968e+00) * t + 2.938163982698783e+00) /
+                  ((((7.784695709041462e-03 * t + 3.224671290700398e-01) * t + 2.445134137142996e+00) * t +
+                    3.754408661907416e+00) * t + 1.0);
+    tail = p < 0.5 ? tail : -tail;
+    return std::fabs(q) <= 0.5 - kLow ? central : tail;
+}
+
+}  // namespace fast_math
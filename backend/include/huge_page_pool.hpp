@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <vector>
+
+// Memory resource that carves allocations out of 2 MB-aligned regions.
+// Each region is tried as hugetlbfs pages first, then as transparent huge
+// pages (madvise), then as normal pages. Regions are mapped lazily by the
+// first allocation that needs one and pre-faulted by that thread, so with
+// the kernel's first-touch policy they live on the NUMA node of whichever
+// thread allocated first, not necessarily the thread that later uses the
+// container; allocate from the using thread where placement matters. Freed
+// memory is only reclaimed when the resource is destroyed; use
+// HugePagePool for containers that churn.
+class HugePageResource : public std::pmr::memory_resource {
+public:
+    enum class Backing {
+        NONE,         // Nothing mapped yet
+        HUGETLB,      // Reserved 2 MB pages (vm.nr_hugepages)
+        TRANSPARENT,  // Normal mapping advised for transparent huge pages
+        NORMAL        // 4 KB pages
+    };
+
+    static constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+    // try_huge_pages = false maps normal pages only, for comparisons
+    explicit HugePageResource(size_t region_size = 2 * kHugePageSize, bool try_huge_pages = true);
+    ~HugePageResource() override;
+
+    HugePageResource(const HugePageResource&) = delete;
+    HugePageResource& operator=(const HugePageResource&) = delete;
+
+    Backing backing() const { return backing_.load(); }  // Of the latest region
+    size_t mapped_bytes() const { return mapped_bytes_.load(); }
+    static const char* backing_name(Backing backing);
+
+private:
+    struct Region {
+        char* data;
+        size_t size;
+    };
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+    void map_region(size_t min_bytes);
+
+    size_t region_size_;
+    bool try_huge_pages_;
+    std::vector<Region> regions_;  // Guarded by mutex_
+    size_t offset_{0};             // Into regions_.back()
+    std::mutex mutex_;             // Upstream calls are rare; pools batch them
+    std::atomic<Backing> backing_{Backing::NONE};
+    std::atomic<size_t> mapped_bytes_{0};
+};
+
+// Size-class pool over a HugePageResource, for node-based containers
+// (std::pmr::map, deque) that allocate and free on every update. Freed
+// blocks are reused by later allocations of the same size.
+class HugePagePool {
+public:
+    enum class Sharing {
+        SINGLE_THREAD,  // Caller serializes every allocation and free
+        SHARED
+    };
+
+    explicit HugePagePool(Sharing sharing = Sharing::SINGLE_THREAD,
+                          size_t region_size = 2 * HugePageResource::kHugePageSize,
+                          bool try_huge_pages = true);
+
+    HugePagePool(const HugePagePool&) = delete;
+    HugePagePool& operator=(const HugePagePool&) = delete;
+
+    std::pmr::memory_resource* resource() { return pool_.get(); }
+    const HugePageResource& pages() const { return pages_; }
+
+private:
+    HugePageResource pages_;
+    std::unique_ptr<std::pmr::memory_resource> pool_;
+};
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Point-in-time copy of a LatencyHistogram. Percentiles are computed from
+// snapshots so readers never scan buckets that are still being written.
+struct HistogramSnapshot {
+    std::vector<uint64_t> counts;
+    uint64_t total_count{0};
+    uint64_t sum{0};
+    uint64_t max{0};
+
+    uint64_t percentile(double p) const;
+    double mean() const { return total_count ? static_cast<double>(sum) / total_count : 0.0; }
+    HistogramSnapshot since(const HistogramSnapshot& earlier) const;
+};
+
+// Log-linear histogram in the style of HdrHistogram: values below 64 are
+// exact, larger values land in one of 32 linear sub-buckets per power of
+// two (about 3% worst-case relative error). Recording is a handful of
+// relaxed atomic adds, so any number of threads can record concurrently.
+class LatencyHistogram {
+public:
+    static constexpr int kSubBucketBits = 6;
+    static constexpr size_t kSubBucketCount = size_t{1} << kSubBucketBits;
+    static constexpr size_t kHalfSubBucketCount = kSubBucketCount / 2;
+    static constexpr size_t kBucketCount =
+        kSubBucketCount + (64 - kSubBucketBits) * kHalfSubBucketCount;
+
+    LatencyHistogram();
+
+    void record(uint64_t value);
+    void reset();
+    uint64_t count() const { return total_count_.load(std::memory_order_relaxed); }
+    HistogramSnapshot snapshot() const;
+
+    static size_t bucket_index(uint64_t value);
+    static uint64_t bucket_upper_bound(size_t index);
+
+private:
+    std::array<std::atomic<uint64_t>, kBucketCount> counts_;
+    std::atomic<uint64_t> total_count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+// Stages of the tick-to-order path, in the order a tick flows through them.
+enum class LatencyStage {
+    WS_RECEIVE,     // Whole frame handling inside ws_callback
+    WS_PARSE,       // json::parse of a frame
+    BOOK_UPDATE,    // Channel handler dispatch for a subscription notification
+    TICK_QUEUE,     // Feed publish to strategy pickup in TradingPipeline
+    PRICE_UPDATE,   // TradingAgent::updatePrice
+    SIGNAL,         // TradingAgent::processSignal
+    RISK_CHECK,     // TradingAgent::checkRiskLimits
+    ORDER_VALIDATE, // Instrument lookups and amount rounding in place_order
+    SERIALIZE,      // Building and dumping an order payload
+    SEND,           // HTTP round trip until the exchange response arrives
+    ACK,            // Parsing and validating the exchange response
+    TICK_TO_ORDER,  // updatePrice entry to acknowledged order
+    COUNT
+};
+
+class LatencyTracker {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    class ScopedTimer {
+    public:
+        ScopedTimer(LatencyTracker& tracker, LatencyStage stage)
+            : tracker_(tracker), stage_(stage), start_(Clock::now()) {}
+        ~ScopedTimer() { tracker_.record(stage_, start_, Clock::now()); }
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    private:
+        LatencyTracker& tracker_;
+        LatencyStage stage_;
+        Clock::time_point start_;
+    };
+
+    LatencyTracker() = default;
+    ~LatencyTracker();
+
+    LatencyTracker(const LatencyTracker&) = delete;
+    LatencyTracker& operator=(const LatencyTracker&) = delete;
+
+    static Clock::time_point now() { return Clock::now(); }
+    static const char* stage_name(LatencyStage stage);
+
+    void record(LatencyStage stage, Clock::time_point start, Clock::time_point end);
+    void record(LatencyStage stage, uint64_t nanoseconds);
+    const LatencyHistogram& histogram(LatencyStage stage) const;
+
+    // Percentile table in microseconds, one line per stage with samples
+    std::string report() const;
+
+    // Periodically log percentiles for the samples recorded in each interval
+    void start_reporting(std::chrono::seconds interval);
+    void stop_reporting();
+
+private:
+    static constexpr size_t kStageCount = static_cast<size_t>(LatencyStage::COUNT);
+
+    std::string format_report(const std::array<HistogramSnapshot, kStageCount>& snapshots) const;
+    void reporting_loop(std::chrono::seconds interval);
+
+    std::array<LatencyHistogram, kStageCount> histograms_;
+
+    std::thread reporter_thread_;
+    std::mutex reporter_mutex_;
+    std::condition_variable reporter_cv_;
+    bool reporter_stop_{false};
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include "book_features.hpp"
+#include "seqlock.hpp"
+
+// Latest top of book, last trade and book features per instrument, each
+// published through its own SeqLock. Readers (UI, risk, metrics,
+// strategies) get a consistent copy without locks and never slow the
+// writer, which is the session thread carrying that instrument's channels.
+class MarketBoard {
+public:
+    static constexpr size_t kMaxInstruments = 256;
+
+    struct Quote {
+        double best_bid;
+        double best_ask;
+        int64_t change_id;
+        int64_t book_timestamp_ms;   // Exchange time of the book update
+        bool book_valid;             // False while the book is resyncing
+        double last_price;
+        double last_amount;
+        int64_t trade_timestamp_ms;  // Exchange time of the last trade
+        int64_t updated_ns;          // Local steady clock of the last book write
+        int64_t trade_updated_ns;    // And of the last trade
+    };
+
+    MarketBoard();
+
+    MarketBoard(const MarketBoard&) = delete;
+    MarketBoard& operator=(const MarketBoard&) = delete;
+
+    // Empty until the instrument's first update
+    std::optional<Quote> quote(std::string_view instrument) const;
+    // Empty until the instrument's first book or trade; invalid while the
+    // book is resyncing
+    std::optional<BookFeatures::Values> features(std::string_view instrument) const;
+
+    // Updates older than the stored change_id are ignored, so a REST
+    // snapshot never overwrites a fresher streamed book
+    void update_book(std::string_view instrument, double best_bid, double best_ask,
+                     int64_t change_id, int64_t timestamp_ms);
+    void invalidate_book(std::string_view instrument);
+    void update_trade(std::string_view instrument, double price, double amount, int64_t timestamp_ms);
+    void update_features(std::string_view instrument, const BookFeatures::Values& values);
+
+private:
+    struct Slot {
+        std::string instrument;  // Immutable once the slot is published
+        SeqLock<Quote> quote;
+        SeqLock<BookFeatures::Values> features;
+    };
+
+    Slot* find(std::string_view instrument) const;
+    Slot& find_or_add(std::string_view instrument);
+
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<size_t> count_{0};
+    std::mutex add_mutex_;  // New instruments only
+};
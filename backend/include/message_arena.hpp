@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+// Bump allocator for objects that live only while one message is handled.
+// Each thread owns one arena (MessageArena::local()). While a Scope is open
+// allocations are carved out of retained blocks; closing the outermost
+// Scope rewinds the arena, so after warm-up the market data and order
+// paths stop touching the global allocator. Objects allocated inside a
+// Scope must not outlive it or be handed to another thread.
+class MessageArena {
+public:
+    class Scope {
+    public:
+        Scope() : arena_(local()) { ++arena_.depth_; }
+        ~Scope() {
+            if (--arena_.depth_ == 0) {
+                arena_.rewind();
+            }
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        MessageArena& arena_;
+    };
+
+    explicit MessageArena(size_t block_size = 256 * 1024);
+    ~MessageArena();
+
+    MessageArena(const MessageArena&) = delete;
+    MessageArena& operator=(const MessageArena&) = delete;
+
+    static MessageArena& local();
+
+    bool active() const { return depth_ > 0; }
+    void* allocate(size_t bytes, size_t alignment);
+    bool owns(const void* p) const;
+
+    size_t bytes_in_use() const;
+    size_t capacity() const;
+
+private:
+    struct Block {
+        char* data;
+        size_t size;
+    };
+
+    void rewind();
+    void add_block(size_t min_size);
+
+    size_t block_size_;
+    std::vector<Block> blocks_;
+    size_t current_block_{0};
+    size_t offset_{0};
+    int depth_{0};
+};
+
+// Stateless allocator that draws from the thread's MessageArena while a
+// Scope is open and from the global heap otherwise. Deallocation checks
+// ownership, so values created outside a Scope can still be freed safely.
+template <typename T>
+struct ArenaAllocator {
+    using value_type = T;
+
+    ArenaAllocator() noexcept = default;
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        MessageArena& arena = MessageArena::local();
+        if (arena.active()) {
+            return static_cast<T*>(arena.allocate(n * sizeof(T), alignof(T)));
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t) noexcept {
+        if (MessageArena::local().owns(p)) {
+            return;
+        }
+        ::operator delete(p);
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>&) const noexcept { return true; }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>&) const noexcept { return false; }
+};
+
+using arena_string = std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
+
+// JSON document type for per-message parsing and order encoding
+using message_json = nlohmann::basic_json<std::map, std::vector, arena_string, bool,
+                                          std::int64_t, std::uint64_t, double, ArenaAllocator>;
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string_view>
+#include "message_arena.hpp"
+
+// Parses one frame into a message_json document placed in the thread's
+// MessageArena; call it inside a MessageArena::Scope. nlohmann's parser
+// keeps its token buffer and parse stacks on the global heap and frees the
+// document through a heap stack too, so every frame cost allocations even
+// with an arena-backed document. Here the scratch is the call stack and
+// the document is never destroyed, only rewound with the scope, so it must
+// not hold anything the arena does not own.
+//
+// Only plain ASCII frames take this path. Anything else (non-ASCII or
+// \u-escaped strings, nesting past 64 levels, malformed input) goes to
+// message_json::parse, which also throws the parse_error for bad frames.
+const message_json& parse_message(std::string_view text);
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "latency_tracker.hpp"
+
+// Monotonic counter owned by a single writer thread. Writers use relaxed
+// increments and scrapers relaxed loads, so scraping never blocks trading.
+struct alignas(64) MetricCounter {
+    std::atomic<uint64_t> value{0};
+
+    void increment(uint64_t n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t load() const { return value.load(std::memory_order_relaxed); }
+};
+
+// Last-written value published by a single writer thread.
+struct alignas(64) MetricGauge {
+    std::atomic<double> value{0.0};
+
+    void set(double v) { value.store(v, std::memory_order_relaxed); }
+    double load() const { return value.load(std::memory_order_relaxed); }
+};
+
+// Minimal HTTP server exposing registered metrics in the Prometheus text
+// format on GET /metrics, plus any documents registered as routes. It runs
+// on its own thread and only ever reads atomics through the registered
+// samplers and collectors.
+class MetricsServer {
+public:
+    using Sampler = std::function<double()>;
+    using Collector = std::function<void(std::ostream&)>;
+    using HistogramSampler = std::function<HistogramSnapshot()>;
+    using RouteHandler = std::function<std::string()>;
+    using Labels = std::vector<std::pair<std::string, std::string>>;
+
+    explicit MetricsServer(int port, const std::string& bind_address = "127.0.0.1");
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    // Register before start(); registration is not synchronized with scrapes.
+    // Series registered under one name with different labels are exported
+    // as one family, described by the first registration's help.
+    void add_counter(const std::string& name, const std::string& help, Sampler sampler,
+                     Labels labels = {});
+    void add_gauge(const std::string& name, const std::string& help, Sampler sampler,
+                   Labels labels = {});
+    // Cumulative buckets at the given upper bounds; scale converts recorded
+    // values to the exported unit (nanoseconds to seconds by default)
+    void add_histogram(const std::string& name, const std::string& help, HistogramSampler sampler,
+                       std::vector<double> bounds, double scale = 1e-9);
+    // For labelled families; the collector writes complete exposition lines
+    void add_collector(Collector collector);
+    // GET path answers with the handler's body, e.g. JSON for a dashboard
+    void add_route(const std::string& path, const std::string& content_type, RouteHandler handler);
+    // The one browser origin allowed to read routes cross-origin, e.g.
+    // "http://localhost:3000"; empty, the default, allows none
+    void set_route_origin(const std::string& origin);
+
+    void start();
+    void stop();
+    int port() const { return port_; }
+
+    std::string render() const;
+
+private:
+    struct Metric {
+        std::string name;
+        std::string help;
+        std::string type;
+        Sampler sampler;
+        Labels labels;
+    };
+
+    struct Histogram {
+        std::string name;
+        std::string help;
+        HistogramSampler sampler;
+        std::vector<double> bounds;
+        double scale;
+    };
+
+    struct Route {
+        std::string path;
+        std::string content_type;
+        RouteHandler handler;
+    };
+
+    void serve_loop();
+    void handle_client(int client_fd);
+
+    int port_;
+    std::string bind_address_;
+    int listen_fd_{-1};
+    std::atomic<bool> running_{false};
+    std::thread server_thread_;
+
+    std::vector<Metric> metrics_;
+    std::vector<Histogram> histograms_;
+    std::vector<Collector> collectors_;
+    std::vector<Route> routes_;
+    std::string route_origin_;
+};
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "metrics_server.hpp"
+
+// Value at risk and expected shortfall of the book by Monte Carlo. Prices
+// of each underlying are sampled at a fixed interval. A run estimates the
+// covariance of the sampled log returns, scales it to the horizon by the
+// square root of time, and draws correlated returns through its Cholesky
+// factor. Each path is priced delta-gamma from the book's exposure per
+// underlying, so vol moves and higher-order option terms are not modelled.
+//
+// Paths are split across a persistent worker pool. Each worker runs several
+// independent xoshiro256++ streams side by side and turns them into
+// normals by the inverse CDF, all branch-free, so the compiler vectorizes
+// the draw and the pricing loops.
+class MonteCarloVar {
+public:
+    static constexpr size_t kMaxSamples = 3600;  // Return history per underlying
+    static constexpr size_t kMinSamples = 30;    // Fewer and a run reports an error
+
+    struct Settings {
+        size_t paths = 1'000'000;
+        double confidence = 0.99;
+        std::chrono::seconds horizon{86400};
+        std::chrono::seconds sample_interval{1};  // Between record_prices() calls
+        std::chrono::seconds interval{30};        // Between periodic runs
+        size_t threads = 0;                       // 0: one per core, at most 8
+        uint64_t seed = 0x9e3779b97f4a7c15ULL;
+    };
+
+    // The book's sensitivity to one underlying, in USD: dollar delta, and
+    // gamma as the change in dollar delta for a 1% move
+    struct Exposure {
+        std::string underlying;
+        double delta = 0.0;
+        double gamma = 0.0;
+    };
+
+    struct FactorResult {
+        std::string underlying;
+        double delta;
+        double gamma;
+        double horizon_vol;  // Standard deviation of the log return over the horizon
+    };
+
+    struct Result {
+        bool valid = false;
+        std::string error;            // Why a run produced no figures
+        double var = 0.0;             // Loss not exceeded at the confidence level, USD
+        double expected_shortfall = 0.0;  // Mean loss beyond the VaR, USD
+        double mean_pnl = 0.0;
+        double stdev_pnl = 0.0;
+        double confidence = 0.0;
+        double horizon_seconds = 0.0;
+        size_t paths = 0;
+        size_t samples = 0;           // Returns per underlying used for the covariance
+        std::vector<FactorResult> factors;
+        double seconds = 0.0;         // Wall time of the run
+        int64_t computed_at_ms = 0;
+    };
+
+    using ExposureSource = std::function<std::vector<Exposure>()>;
+    using ResultHandler = std::function<void(const Result&)>;
+
+    MonteCarloVar();
+    explicit MonteCarloVar(const Settings& settings);
+    ~MonteCarloVar();
+
+    MonteCarloVar(const MonteCarloVar&) = delete;
+    MonteCarloVar& operator=(const MonteCarloVar&) = delete;
+
+    // One thread, at the sample interval: the latest price of each
+    // underlying. An underlying missing from a sample repeats its last price.
+    void record_prices(const std::vector<std::pair<std::string, double>>& prices);
+
+    // Any thread; runs serialize. Publishes the result and returns it.
+    std::shared_ptr<const Result> run(const std::vector<Exposure>& exposures);
+    // Null until the first run
+    std::shared_ptr<const Result> latest() const { return std::atomic_load(&latest_); }
+
+    // Periodic runs on their own thread, each over the exposure the source
+    // returns at that moment; the handler sees every result
+    void start(ExposureSource source, ResultHandler handler = nullptr);
+    void stop();
+
+    const Settings& settings() const { return settings_; }
+    void register_metrics(MetricsServer& server);
+
+    // "BTC" for BTC-PERPETUAL, BTC-27DEC24-60000-C and BTC_USDC-PERPETUAL
+    static std::string_view underlying_of(std::string_view instrument);
+
+private:
+    // Workers run one job at a time, each over its own share of the paths
+    void worker_loop(size_t worker);
+    void run_on_workers(const std::function<void(size_t)>& job);
+    void periodic_loop(ExposureSource source, ResultHandler handler);
+    Result simulate(const std::vector<Exposure>& exposures);
+
+    Settings settings_;
+
+    std::mutex history_mutex_;
+    std::map<std::string, std::deque<double>, std::less<>> returns_;
+    std::map<std::string, double, std::less<>> last_price_;
+
+    std::mutex run_mutex_;         // One run at a time
+    std::vector<double> pnl_;      // Per path, reused between runs
+    std::shared_ptr<const Result> latest_;
+
+    std::vector<std::thread> workers_;
+    std::mutex job_mutex_;
+    std::condition_variable job_cv_;
+    std::condition_variable done_cv_;
+    const std::function<void(size_t)>* job_ = nullptr;
+    uint64_t job_generation_ = 0;
+    size_t jobs_pending_ = 0;
+    bool workers_stopping_ = false;
+
+    std::thread periodic_thread_;
+    std::mutex periodic_mutex_;
+    std::condition_variable periodic_cv_;
+    bool periodic_running_ = false;
+
+    MetricGauge var_gauge_;
+    MetricGauge shortfall_gauge_;
+    MetricGauge run_seconds_gauge_;
+    MetricCounter runs_;
+};
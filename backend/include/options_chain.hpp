@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "instrument_cache.hpp"
+#include "metrics_server.hpp"
+
+// Implied volatility and Black-76 Greeks for an options chain, kept in
+// structure-of-arrays form so the pricing kernel runs over contiguous
+// doubles and the compiler can vectorize it. Quotes arrive from the
+// session threads and only mark options dirty; refresh() recomputes the
+// dirty ones on the caller's thread, and a forward move on an expiry
+// dirties that expiry only. Every option is recomputed at least every
+// kFullRefreshInterval so time to expiry stays current.
+//
+// Prices are in units of the underlying, as Deribit quotes options; the
+// Greeks are in USD: delta per unit of underlying, gamma per USD, vega per
+// vol point and theta per day. Rates are taken as zero, since the forward
+// in each ticker already carries the carry.
+class OptionsChain {
+public:
+    static constexpr int64_t kFullRefreshInterval = 5000;  // ms
+    static constexpr int kNewtonIterations = 12;
+
+    struct Option {
+        std::string_view instrument;
+        int64_t expiration_ms;
+        double strike;
+        bool call;
+        double bid;
+        double ask;
+        double forward;
+        bool valid;  // Two-sided quote inside the no-arbitrage bounds, solved
+        double iv;
+        double price_usd;
+        double delta;
+        double gamma;
+        double vega;
+        double theta;
+    };
+
+    OptionsChain() = default;
+    OptionsChain(const OptionsChain&) = delete;
+    OptionsChain& operator=(const OptionsChain&) = delete;
+
+    // Add every option before subscribing to its ticker; lookups from the
+    // session threads are not synchronized with additions
+    size_t add_option(const std::string& instrument, const InstrumentSpec& spec);
+    std::optional<size_t> find(std::string_view instrument) const;
+    size_t size() const { return strike_.size(); }
+
+    // Any thread. A zero or missing side leaves the option without a price
+    void update_quote(size_t index, double bid, double ask, double forward);
+    // One thread at a time; returns the number of options recomputed
+    size_t refresh(int64_t now_ms);
+    // Any thread; the state as of the last refresh
+    Option option(size_t index) const;
+    size_t valid_count() const;
+
+    void register_metrics(MetricsServer& server);
+
+    // Single option, scalar, for checks and one-off quotes
+    static double black76_price(double forward, double strike, double years, double vol, bool call);
+
+private:
+    // Batch of dirty options gathered for the kernel; refresh thread only
+    struct Batch {
+        std::vector<uint32_t> index;
+        std::vector<double> forward, strike, years, sign, target, vol;
+        std::vector<double> log_moneyness, moneyness, sqrt_years;
+        std::vector<double> price, delta, gamma, vega, theta, valid;
+        void resize(size_t n);
+    };
+
+    static void solve(Batch& batch, size_t n);
+
+    // Static per option
+    std::deque<std::string> instrument_;  // Stable addresses for the index keys
+    std::unordered_map<std::string_view, uint32_t> index_;
+    std::vector<double> strike_;
+    std::vector<int64_t> expiration_ms_;
+    std::vector<double> sign_;  // +1 call, -1 put
+    std::vector<uint32_t> expiry_of_;
+    std::vector<int64_t> expiries_;
+    std::vector<std::vector<uint32_t>> expiry_members_;
+
+    // Inputs, written by the session threads
+    mutable std::mutex input_mutex_;
+    std::vector<double> bid_;
+    std::vector<double> ask_;
+    std::vector<double> forward_;         // Per expiry
+    std::vector<uint8_t> dirty_;
+    int64_t last_full_refresh_ms_{0};
+
+    // Outputs, written by refresh()
+    mutable std::mutex output_mutex_;
+    std::vector<double> iv_;
+    std::vector<double> price_usd_;
+    std::vector<double> delta_;
+    std::vector<double> gamma_;
+    std::vector<double> vega_;
+    std::vector<double> theta_;
+    std::vector<uint8_t> valid_;
+
+    Batch batch_;
+    MetricCounter recomputed_;
+    MetricGauge last_refresh_seconds_;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory_resource>
+#include "message_arena.hpp"
+
+// Local copy of one book channel. On book.{instrument}.{interval} Deribit
+// sends a snapshot after each subscribe and then changes chained by
+// prev_change_id; a broken chain invalidates the book until the next
+// snapshot arrives. Grouped book.{instrument}.{group}.{depth}.{interval}
+// channels send the whole capped book every time, so each notification
+// replaces it.
+class OrderBook {
+public:
+    enum class Update {
+        SNAPSHOT,  // Book replaced from a snapshot
+        APPLIED,   // Change applied in sequence
+        GAP,       // Change out of sequence; the book is now invalid
+        IGNORED    // Change received while waiting for a snapshot
+    };
+
+    using BidLevels = std::pmr::map<double, double, std::greater<double>>;
+    using AskLevels = std::pmr::map<double, double>;
+
+    // Level nodes come from resource, which must outlive the book
+    explicit OrderBook(bool grouped = false,
+                       std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : bids_(resource), asks_(resource), grouped_(grouped) {}
+
+    // Throws on a malformed notification (missing key, short level, wrong
+    // type), possibly half-applied; the caller resyncs the book
+    Update apply(const message_json& data);
+    void invalidate();
+    void clear();
+
+    bool valid() const { return valid_; }
+    bool grouped() const { return grouped_; }
+    int64_t change_id() const { return change_id_; }
+    double best_bid() const { return bids_.empty() ? 0.0 : bids_.begin()->first; }
+    double best_ask() const { return asks_.empty() ? 0.0 : asks_.begin()->first; }
+    const BidLevels& bids() const { return bids_; }
+    const AskLevels& asks() const { return asks_; }
+
+private:
+    template <typename Levels>
+    static void apply_levels(Levels& levels, const message_json& updates);
+    template <typename Levels>
+    static void replace_levels(Levels& levels, const message_json& snapshot);
+
+    BidLevels bids_;
+    AskLevels asks_;
+    int64_t change_id_{0};
+    bool valid_{false};
+    bool grouped_;
+};
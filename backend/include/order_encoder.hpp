@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Order fields as seen by the encoder; views into the caller's request
+struct OrderFields {
+    std::string_view instrument_name;
+    std::string_view direction;      // "buy" or "sell"
+    std::string_view type;           // "limit" or "market"; empty means limit
+    std::string_view time_in_force;  // empty means good_til_cancelled
+    bool post_only{false};
+    bool reduce_only{false};
+    double amount{0.0};
+    double price{0.0};
+};
+
+// JSON-RPC order body with everything but id, amount and price written
+// ahead of time. Encoding appends the fixed fragments and formats the
+// three numbers with std::to_chars.
+class OrderTemplate {
+public:
+    OrderTemplate(std::string_view instrument_name, std::string_view direction,
+                  std::string_view type, std::string_view time_in_force,
+                  bool post_only, bool reduce_only);
+
+    // Writes the body into out, reusing its capacity
+    void encode(std::string& out, uint64_t id, double amount, double price) const;
+    const std::string& endpoint() const { return endpoint_; }
+    bool has_price() const { return has_price_; }
+
+private:
+    std::string endpoint_;
+    std::string head_;         // {"jsonrpc":"2.0","id":
+    std::string before_amount_;// ,"method":...,"params":{...,"amount":
+    std::string before_price_; // ,"price":
+    std::string tail_;         // flags, time_in_force and closing braces
+    bool has_price_;
+};
+
+// Caches OrderTemplates per instrument for the common order shapes and
+// encodes orders into a reusable buffer. Not thread-safe; keep one per
+// sending thread. Shapes outside the cache (other order types or
+// time-in-force values) return false so the caller can fall back to a
+// generic JSON build.
+class OrderEncoder {
+public:
+    struct Encoded {
+        std::string_view endpoint;
+        std::string_view body;
+    };
+
+    OrderEncoder();
+
+    bool encode(const OrderFields& order, uint64_t id, Encoded& out);
+    size_t template_count() const;
+
+    static void append_number(std::string& out, double value);
+    static void append_number(std::string& out, uint64_t value);
+
+private:
+    // direction x {limit, market} x post_only x reduce_only x time_in_force
+    static constexpr size_t kVariants = 2 * 2 * 2 * 2 * 3;
+    using InstrumentTemplates = std::array<std::optional<OrderTemplate>, kVariants>;
+
+    static std::optional<size_t> variant_index(const OrderFields& order);
+
+    std::map<std::string, InstrumentTemplates, std::less<>> templates_;
+    std::string buffer_;
+};
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include "instrument_cache.hpp"
+#include "metrics_server.hpp"
+#include "seqlock.hpp"
+
+// Exposure of the whole book, across every agent and instrument, kept
+// current by fills and marks. Each update adjusts the totals by the one
+// instrument's change instead of summing positions, and the totals, the
+// per-instrument state and the limits each sit behind a SeqLock, so a
+// pre-trade check is a few loads and compares without taking a lock.
+//
+// Sensitivities are in USD and summed across underlyings, i.e. as if
+// they all moved together: delta is the dollar delta, gamma the change in
+// dollar delta for a 1% move and vega the change in value per vol point.
+class PortfolioRisk {
+public:
+    static constexpr size_t kMaxInstruments = 256;
+    static constexpr double kUnlimited = std::numeric_limits<double>::infinity();
+
+    struct Exposure {
+        double delta;
+        double gamma;
+        double vega;
+        double gross_notional;  // Sum of |position| times the underlying's price
+        uint32_t positions;     // Instruments with a non-zero position
+    };
+
+    // Bounds on the absolute value of each total
+    struct Limits {
+        double max_delta = kUnlimited;
+        double max_gamma = kUnlimited;
+        double max_vega = kUnlimited;
+        double max_gross_notional = kUnlimited;
+        double max_var = kUnlimited;  // Against the latest set_value_at_risk()
+    };
+
+    enum class Breach : uint8_t {
+        NONE,
+        DELTA,
+        GAMMA,
+        VEGA,
+        NOTIONAL,
+        VAR,      // Over the VaR limit: only orders that shrink |delta| pass
+        UNPRICED  // No mark for the instrument yet, so its risk is unknown
+    };
+
+    PortfolioRisk();
+    PortfolioRisk(const PortfolioRisk&) = delete;
+    PortfolioRisk& operator=(const PortfolioRisk&) = delete;
+
+    // Any thread. Returns the instrument's slot, adding it on first use;
+    // throws std::length_error past kMaxInstruments
+    size_t add_instrument(std::string_view instrument, const InstrumentSpec& spec);
+    std::optional<size_t> find(std::string_view instrument) const;
+    size_t size() const { return count_.load(std::memory_order_acquire); }
+    const std::string& instrument(size_t slot) const { return slots_[slot].instrument; }
+    const InstrumentSpec& spec(size_t slot) const { return slots_[slot].spec; }
+
+    // Any thread; updates serialize among themselves. Amounts are in the
+    // instrument's order units, positive for buys.
+    void on_fill(size_t slot, double signed_amount);
+    // Futures and spot: the instrument's price. Options take their Greeks
+    // from the chain instead, as delta per unit of underlying, gamma per
+    // USD and vega in USD per vol point.
+    void update_price(size_t slot, double mark);
+    void update_option(size_t slot, double forward, double delta, double gamma, double vega);
+
+    // Any thread, lock-free. Orders that leave a measure over its limit are
+    // refused unless they shrink that measure.
+    Breach check_order(size_t slot, double signed_amount) const;
+    bool within_limits() const;
+    Exposure exposure() const { return totals_.load(); }
+    // One instrument's share of the totals
+    Exposure instrument_exposure(size_t slot) const;
+    double position(size_t slot) const { return slots_[slot].state.load().position; }
+
+    void set_limits(const Limits& limits) { limits_.store(limits); }
+    Limits limits() const { return limits_.load(); }
+    // From the VaR engine, in USD; checked against Limits::max_var
+    void set_value_at_risk(double var) { value_at_risk_.store(var, std::memory_order_relaxed); }
+    double value_at_risk() const { return value_at_risk_.load(std::memory_order_relaxed); }
+
+    void register_metrics(MetricsServer& server);
+    static const char* breach_name(Breach breach);
+
+private:
+    // Sensitivities of one unit of order amount
+    struct UnitRisk {
+        double delta;
+        double gamma;
+        double vega;
+        double notional;  // Zero until the first mark
+    };
+
+    struct State {
+        double position;
+        UnitRisk unit;
+    };
+
+    struct Slot {
+        std::string instrument;  // Immutable once the slot is published
+        InstrumentSpec spec;
+        SeqLock<State> state;
+    };
+
+    // Replaces the slot's state and moves the totals by the difference
+    void apply(Slot& slot, double position_change, const UnitRisk* unit);
+    static Breach first_breach(const Exposure& before, const Exposure& after, const Limits& limits, double var);
+
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<size_t> count_{0};
+    std::mutex update_mutex_;  // Writers: new slots, fills and marks
+    SeqLock<Exposure> totals_;
+    SeqLock<Limits> limits_;
+    std::atomic<double> value_at_risk_{0.0};
+    mutable MetricCounter rejected_;
+};
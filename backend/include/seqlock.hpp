@@ -0,0 +1,92 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+// Sequence lock for small trivially copyable values. Readers never block a
+// writer: they copy the value and retry only if a write overlapped the copy.
+// The payload is held in relaxed atomic words, so the racing copy is well
+// defined. Writers serialize among themselves on the sequence word, which
+// makes several writers safe, but each slot is meant to have one hot writer.
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable_v<T>, "SeqLock payload must be trivially copyable");
+
+public:
+    // Until the first store, load() returns a value of all-zero bytes
+    T load() const {
+        Words words;
+        for (;;) {
+            uint64_t begin = seq_.load(std::memory_order_acquire);
+            if (begin & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+            for (size_t i = 0; i < kWords; ++i) {
+                words[i] = data_[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq_.load(std::memory_order_relaxed) == begin) {
+                return from_words(words);
+            }
+        }
+    }
+
+    void store(const T& value) {
+        update([&value](T& current) { current = value; });
+    }
+
+    // Read-modify-write under the write side of the lock
+    template <typename Fn>
+    void update(Fn&& fn) {
+        uint64_t seq = lock();
+        Words words;
+        for (size_t i = 0; i < kWords; ++i) {
+            words[i] = data_[i].load(std::memory_order_relaxed);
+        }
+        T value = from_words(words);
+        fn(value);
+        std::memcpy(words.data(), &value, sizeof(T));
+        for (size_t i = 0; i < kWords; ++i) {
+            data_[i].store(words[i], std::memory_order_relaxed);
+        }
+        seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    // Completed writes so far; 0 means never written
+    uint64_t version() const { return seq_.load(std::memory_order_acquire) / 2; }
+
+private:
+    static constexpr size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    using Words = std::array<uint64_t, kWords>;
+
+    // Moves the sequence to odd; returns the even value it started from
+    uint64_t lock() {
+        uint64_t seq = seq_.load(std::memory_order_relaxed);
+        for (;;) {
+            if (!(seq & 1) &&
+                seq_.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire,
+                                           std::memory_order_relaxed)) {
+                std::atomic_thread_fence(std::memory_order_release);
+                return seq;
+            }
+            if (seq & 1) {
+                std::this_thread::yield();
+                seq = seq_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    static T from_words(const Words& words) {
+        T value;
+        std::memcpy(static_cast<void*>(&value), words.data(), sizeof(T));
+        return value;
+    }
+
+    alignas(64) std::atomic<uint64_t> seq_{0};
+    std::array<std::atomic<uint64_t>, kWords> data_{};
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+#include "metrics_server.hpp"
+
+// Bounded single-producer/single-consumer ring. One thread may push and one
+// other thread may pop; neither side ever blocks or takes a lock. Each side
+// caches the other's index so the shared cache line is only re-read when
+// the ring looks full (producer) or empty (consumer).
+template <typename T>
+class SpscQueue {
+public:
+    // Capacity is rounded up to a power of two
+    // Slots come from resource, which must outlive the queue
+    explicit SpscQueue(size_t capacity,
+                       std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : capacity_(round_up(capacity)), mask_(capacity_ - 1), slots_(capacity_, resource) {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer side. Returns false and counts a rejection when full.
+    bool try_push(T&& value) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cached_head_ == capacity_) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail - cached_head_ == capacity_) {
+                rejected_.increment();
+                return false;
+            }
+        }
+        slots_[tail & mask_] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_push(const T& value) {
+        T copy(value);
+        return try_push(std::move(copy));
+    }
+
+    // Consumer side
+    bool try_pop(T& out) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cached_tail_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head == cached_tail_) {
+                return false;
+            }
+        }
+        out = std::move(slots_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when read from a third thread, e.g. a metrics scrape.
+    // Head is read first: it never passes the tail read after it, so the
+    // difference cannot wrap; both may move between the loads, hence the cap.
+    size_t size() const {
+        size_t head = head_.load(std::memory_order_acquire);
+        size_t tail = tail_.load(std::memory_order_acquire);
+        return std::min(tail - head, capacity_);
+    }
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return capacity_; }
+    // Pushes refused because the ring was full
+    uint64_t rejected() const { return rejected_.load(); }
+
+private:
+    static size_t round_up(size_t n) {
+        size_t capacity = 2;
+        while (capacity < n) {
+            capacity <<= 1;
+        }
+        return capacity;
+    }
+
+    const size_t capacity_;
+    const size_t mask_;
+    std::pmr::vector<T> slots_;
+
+    // Consumer-owned line
+    alignas(64) std::atomic<size_t> head_{0};
+    size_t cached_tail_{0};
+
+    // Producer-owned line
+    alignas(64) std::atomic<size_t> tail_{0};
+    size_t cached_head_{0};
+
+    MetricCounter rejected_;  // Written by the producer only
+};
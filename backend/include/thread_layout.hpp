@@ -0,0 +1,54 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <string_view>
+
+// How hot-path threads wait when their input rings are empty
+enum class WaitMode {
+    BACKOFF,  // Spin briefly, then sleep; leaves the core to others
+    SPIN      // Never sleep; meant for threads pinned to isolated cores
+};
+
+struct ThreadPlacement {
+    int cpu = -1;          // -1 leaves the thread unpinned
+    int fifo_priority = 0; // 1-99 runs the thread under SCHED_FIFO
+};
+
+// Where each named thread runs, read once from DERIBIT_THREAD_LAYOUT, e.g.
+//
+//   DERIBIT_THREAD_LAYOUT="md=2,md-1=3,strategy=4/80,gateway=5/70,feed=6,wait=spin,mlock=1"
+//
+// Thread names are md-<n> (WebSocket sessions), feed, strategy, gateway and
+// risk-<n> (VaR workers).
+// A role written without its -<n> suffix covers every thread of that role.
+// cpu/priority pins the thread and, with a priority, runs it SCHED_FIFO.
+class ThreadLayout {
+public:
+    // Throws std::invalid_argument on a malformed spec
+    static ThreadLayout parse(std::string_view spec);
+    // Parsed once per process; a malformed variable is logged and ignored
+    static const ThreadLayout& process();
+    // Replaces the process layout, e.g. from a config file. Call before any
+    // thread reads process(); throws std::invalid_argument like parse().
+    static void configure(std::string_view spec);
+
+    ThreadPlacement placement(std::string_view thread_name) const;
+    WaitMode wait_mode() const { return wait_mode_; }
+    bool lock_memory() const { return lock_memory_; }
+    std::string describe() const;
+
+    // Names the calling thread and applies its placement. Failures (no such
+    // CPU, no CAP_SYS_NICE for SCHED_FIFO) are logged and the thread runs on
+    // with default scheduling.
+    void apply(std::string_view thread_name) const;
+    // mlockall(MCL_CURRENT | MCL_FUTURE) when requested; call once at startup
+    void lock_memory_if_requested() const;
+
+private:
+    static ThreadLayout& instance();
+
+    std::map<std::string, ThreadPlacement, std::less<>> placements_;
+    WaitMode wait_mode_ = WaitMode::BACKOFF;
+    bool lock_memory_ = false;
+};
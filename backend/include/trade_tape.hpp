@@ -0,0 +1,122 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "seqlock.hpp"
+
+// Recent trades of one instrument and what is derived from them, kept
+// current trade by trade. The ring holds the rolling window, cut short at
+// capacity, and the window's sums move by each trade entering or leaving,
+// so VWAP and volume never rescan history. Tick, volume and dollar bars
+// are built alongside.
+//
+// The session thread carrying the instrument's trades channel is the only
+// writer. Readers get the window summary through a SeqLock and completed
+// bars from per-kind rings of SeqLocks, so the writer never allocates or
+// waits on them.
+class TradeTape {
+public:
+    enum class BarKind : uint8_t {
+        TICK,    // Closes after a number of trades
+        VOLUME,  // After an amount traded, in the instrument's order units
+        DOLLAR   // After a traded value, price times amount
+    };
+    static constexpr size_t kBarKinds = 3;
+
+    struct Settings {
+        size_t capacity = 4096;                     // Trades kept in the window at most
+        std::chrono::milliseconds window{60000};    // For VWAP and volume
+        double tick_bar = 100.0;                    // Bar sizes; 0 turns the kind off
+        double volume_bar = 0.0;
+        double dollar_bar = 0.0;
+        size_t max_bars = 256;                      // Completed bars kept per kind
+    };
+
+    struct Trade {
+        int64_t timestamp_ms;
+        double price;
+        double amount;
+        bool buy;  // Taker side
+    };
+
+    // A bar closes on the trade that reaches its size, so it may run over
+    struct Bar {
+        int64_t open_ms;
+        int64_t close_ms;
+        double open;
+        double high;
+        double low;
+        double close;
+        double volume;
+        double buy_volume;
+        double notional;  // Sum of price times amount
+        uint32_t trades;
+
+        double vwap() const { return volume > 0.0 ? notional / volume : close; }
+    };
+
+    // The window is aged by trade timestamps, so in a quiet market the
+    // figures stand as of the last trade
+    struct Stats {
+        uint64_t trades;            // Since the tape was created
+        double last_price;
+        int64_t last_timestamp_ms;
+        uint32_t window_trades;
+        double window_volume;
+        double window_buy_volume;
+        double window_notional;
+        double vwap;                // Over the window; 0 while it is empty
+    };
+
+    TradeTape();
+    explicit TradeTape(const Settings& settings);
+
+    TradeTape(const TradeTape&) = delete;
+    TradeTape& operator=(const TradeTape&) = delete;
+
+    // Writer thread only. Trades arrive oldest first; publish() makes a
+    // batch visible to stats()
+    void on_trade(const Trade& trade);
+    void publish();
+
+    // Any thread
+    Stats stats() const { return stats_.load(); }
+    // Up to count of the latest completed bars, oldest first. A reader
+    // lapped by the writer may see a newer bar in an older bar's place.
+    std::vector<Bar> bars(BarKind kind, size_t count) const;
+    uint64_t bars_completed(BarKind kind) const;
+
+    const Settings& settings() const { return settings_; }
+    static const char* bar_kind_name(BarKind kind);
+
+private:
+    struct Builder {
+        double size = 0.0;  // Zero: kind is off
+        Bar current{};
+        std::unique_ptr<SeqLock<Bar>[]> completed;
+        std::atomic<uint64_t> count{0};
+    };
+
+    // Drops trades that left the window, and the oldest when the ring is full
+    void evict(int64_t now_ms);
+    void add_to_bar(Builder& builder, BarKind kind, const Trade& trade);
+
+    Settings settings_;
+
+    // Window ring; writer only
+    std::vector<Trade> ring_;
+    size_t oldest_ = 0;
+    size_t size_ = 0;
+    double volume_ = 0.0;
+    double buy_volume_ = 0.0;
+    double notional_ = 0.0;
+    uint64_t trades_ = 0;
+    Trade last_{};
+
+    std::array<Builder, kBarKinds> builders_;
+    SeqLock<Stats> stats_;
+};
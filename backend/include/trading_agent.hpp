@@ -1,12 +1,17 @@
 #pragma once
 
 #include <deque>
+#include <memory_resource>
 #include <vector>
 #include <string>
 #include <map>
 #include <chrono>
+#include <functional>
+#include <memory>
 #include <sstream>
 #include "deribit_trader.hpp"
+#include "huge_page_pool.hpp"
+#include "portfolio_risk.hpp"
 
 class TradingAgent {
 public:
@@ -19,7 +24,9 @@ public:
     enum class Strategy {
         MOMENTUM,
         MEAN_REVERSION,
-        BREAKOUT
+        BREAKOUT,
+        ORDER_FLOW,      // Book flow and taker flow pushing the same way
+        BOOK_IMBALANCE   // Size at the touch and in depth leaning the same way
     };
 
     enum class MarketValueCondition {
@@ -39,8 +46,33 @@ public:
         double highest_pnl;    // Highest profit reached
         double lowest_pnl;     // Lowest profit (max loss) reached
         std::chrono::system_clock::time_point entry_time;
+        bool exit_pending = false;  // Exit order sent, waiting for its ack
     };
 
+    // Orders leave the agent as intents and come back as acks, so the agent
+    // never blocks on the exchange and its state has a single owner thread
+    enum class OrderKind {
+        ENTRY,
+        EXIT
+    };
+
+    struct OrderIntent {
+        OrderKind kind = OrderKind::ENTRY;
+        DeribitTrader::OrderRequest request{};
+        std::string position_id;  // Position being closed, for exits
+        LatencyTracker::Clock::time_point tick_time;
+    };
+
+    struct OrderAck {
+        OrderIntent intent;
+        std::string order_id;  // Empty when placement failed
+        std::string error;
+    };
+
+    // Takes the intent (moving from it) and returns true, or returns false
+    // and leaves it untouched when the order cannot be queued
+    using OrderSink = std::function<bool(OrderIntent&)>;
+
     struct TradingParams {
         double position_size;           // Size of each position
         double stop_loss;              // Stop loss percentage
@@ -55,6 +87,39 @@ public:
         double max_loss_daily;         // Maximum daily loss limit
     };
 
+    // Immutable copy of the agent state, published by the owner thread and
+    // shared by every reader until the next publish
+    struct AgentSnapshot {
+        bool running = false;
+        Strategy strategy = Strategy::MOMENTUM;
+        RiskLevel risk_level = RiskLevel::CONSERVATIVE;
+        double current_price = 0.0;
+        double unrealized_pnl = 0.0;
+        double daily_pnl = 0.0;
+        double total_profit = 0.0;
+        int total_trades = 0;
+        int winning_trades = 0;
+        double highest_profit = 0.0;
+        double biggest_loss = 0.0;
+        int entries_in_flight = 0;
+        std::vector<Position> positions;
+        uint64_t sequence = 0;  // Increments with every publish
+        std::chrono::system_clock::time_point published_at;
+
+        double winRate() const;
+    };
+
+    // Upper bound on how often price updates republish the snapshot
+    static constexpr std::chrono::milliseconds kSnapshotInterval{100};
+
+    // Entry thresholds of the book strategies, on BookFeatures ratios in [-1, 1]
+    static constexpr double kFlowEntryRatio = 0.5;     // ofi_ratio
+    static constexpr double kVolumeConfirmRatio = 0.2; // volume_ratio, same sign
+    static constexpr double kImbalanceEntry = 0.6;     // top_imbalance
+    static constexpr double kDepthConfirm = 0.3;       // depth_imbalance, same sign
+    // Largest entry as a share of the trade tape's rolling volume
+    static constexpr double kMaxVolumeShare = 0.05;
+
     struct MandatoryOrderParams {
         double target_value;           // The market value to trigger the order
         MarketValueCondition condition; // Condition for order execution
@@ -74,10 +139,13 @@ public:
     // Core trading functions
     void start();
     void stop();
+    void backfillPriceHistory();
+    void setBackfillFile(const std::string& path) { backfill_file = path; }
     void updatePrice(double current_price, double bid_price, double ask_price);
     void processSignal();
     
-    // Position management
+    // Position management; the getters below read live state and belong to
+    // the owner thread, other threads read snapshot()
     void checkPositions();
     std::vector<Position> getOpenPositions() const;
     double getCurrentPnL() const;
@@ -87,6 +155,9 @@ public:
     void setRiskLevel(RiskLevel risk);
     void setStrategy(Strategy strategy);
     void setTradingParams(const TradingParams& params);
+    // Shared by every agent; once attached, entries are checked against the
+    // whole book's exposure and fills are reported to it. Call before start.
+    void setPortfolioRisk(PortfolioRisk* risk);
     
     // Status and metrics
     bool isRunning() const { return running; }
@@ -94,6 +165,15 @@ public:
     int getTotalTrades() const { return total_trades; }
     double getWinRate() const;
     std::string getStrategyStatus() const;
+    void registerMetrics(MetricsServer& server);
+
+    // Any thread: the latest published snapshot, never null. Readers share
+    // it without copying and never touch live agent state.
+    std::shared_ptr<const AgentSnapshot> snapshot() const { return std::atomic_load(&published_snapshot); }
+    static std::string formatStatus(const AgentSnapshot& snapshot);
+    // Owner thread only. Publishes if state changed and kSnapshotInterval
+    // has passed since the last publish, or immediately when forced.
+    void publishSnapshot(bool force = false);
 
     // Market analysis
     bool isVolatilityHigh() const;
@@ -104,7 +184,15 @@ public:
     void setMandatoryOrder(const MandatoryOrderParams& params);
     void clearMandatoryOrder();
 
+    // Without a sink orders are placed inline on the calling thread
+    void setOrderSink(OrderSink sink) { order_sink = std::move(sink); }
+    void onOrderAck(const OrderAck& ack);
+    // Places the order on the calling thread; entries are retried
+    static OrderAck executeOrder(DeribitTrader& trader, OrderIntent&& intent);
+
 private:
+    // Benchmarks drive the private indicator and PnL paths directly
+    friend struct TradingAgentBenchAccess;
 
     MandatoryOrderParams mandatory_order_params;
     bool mandatory_order_configured = false;
@@ -125,12 +213,25 @@ private:
     TradingParams params;
     bool running;
 
-    // Market data
-    std::deque<double> price_history;
+    // Market data; the indicator window draws from its own page-backed pool,
+    // placed on the NUMA node of the thread that first fills it (backfill)
+    HugePagePool history_pool{HugePagePool::Sharing::SINGLE_THREAD, HugePageResource::kHugePageSize};
+    std::pmr::deque<double> price_history{history_pool.resource()};
+    std::string backfill_file;         // Locally recorded prices, one per line
     double current_price;
     double current_bid;
     double current_ask;
     std::chrono::system_clock::time_point last_trade_time;
+    LatencyTracker::Clock::time_point last_tick_time;
+    bool market_data_stale = false;    // As last seen by processSignal
+    const TradeTape* trade_tape = nullptr;  // current_instrument's, once start() subscribes
+
+    // Order routing
+    OrderSink order_sink;
+    int entries_in_flight = 0;
+
+    PortfolioRisk* portfolio_risk = nullptr;
+    size_t risk_slot = 0;  // This agent's instrument in portfolio_risk
 
     // Position tracking
     std::vector<Position> open_positions;
@@ -146,6 +247,18 @@ private:
     std::chrono::system_clock::time_point trading_start_time;
     std::chrono::system_clock::time_point daily_reset_time;
 
+    // Published copies of the metrics above, readable from the metrics thread
+    MetricGauge open_positions_gauge;
+    MetricGauge unrealized_pnl_gauge;
+    MetricGauge daily_pnl_gauge;
+    MetricGauge total_profit_gauge;
+    MetricCounter signals_counter;
+    MetricCounter trades_counter;
+
+    std::shared_ptr<const AgentSnapshot> published_snapshot;
+    bool snapshot_dirty = false;
+    LatencyTracker::Clock::time_point last_snapshot_time;
+
     // Risk parameters
     const std::map<RiskLevel, TradingParams> risk_params = {
         {RiskLevel::CONSERVATIVE, {
@@ -197,12 +310,15 @@ private:
     // Position management
     void enterPosition(const std::string& direction);
     void exitPosition(const std::string& order_id);
+    bool submitOrder(OrderIntent&& intent);
+    void setInFlight(const OrderIntent& intent, bool in_flight);
     void updatePositionPnL();
     void manageStopLoss();
     void manageTrailingStop();
     void manageTakeProfit();
     bool checkTradeTimeRestrictions();
     bool checkRiskLimits();
+    void reportFill(const std::string& direction, double amount);
     void updateDailyMetrics();
     
     // Technical indicators
@@ -212,6 +328,9 @@ private:
     bool detectBreakout(const std::vector<double>& prices, double current_price) const;
 
     // Utilities
+    std::vector<double> loadRecordedPrices() const;
+    void publishMetrics();
+    AgentSnapshot makeSnapshot() const;
     void resetDailyMetrics();
     void logTrade(const std::string& order_id, const std::string& action, double price);
 };
\ No newline at end of file
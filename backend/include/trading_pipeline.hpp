@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include "deribit_trader.hpp"
+#include "huge_page_pool.hpp"
+#include "metrics_server.hpp"
+#include "spsc_queue.hpp"
+#include "thread_layout.hpp"
+#include "trading_agent.hpp"
+
+// Staged pipeline: feed -> strategy -> order gateway, with acks flowing back
+// from the gateway to the strategy. Every stage boundary is an SPSC ring,
+// so the hot path takes no locks. The strategy thread is the only thread
+// that touches the TradingAgent once the pipeline runs; other threads
+// reach it through the control ring and read it through its snapshot.
+class TradingPipeline {
+public:
+    TradingPipeline(DeribitTrader& trader, TradingAgent& agent, size_t queue_capacity = 1024);
+    ~TradingPipeline();
+
+    TradingPipeline(const TradingPipeline&) = delete;
+    TradingPipeline& operator=(const TradingPipeline&) = delete;
+
+    void start();
+    // Joins both threads and applies any acks still queued
+    void stop();
+
+    // Feed thread only. Returns false when the strategy is behind and the
+    // tick was dropped.
+    bool publish_tick(double bid, double ask);
+
+    // Control thread only (one thread, e.g. the menu). Commands return false
+    // when the control ring is full.
+    bool start_trading();
+    bool stop_trading();
+    bool set_strategy(TradingAgent::Strategy strategy);
+    bool set_risk_level(TradingAgent::RiskLevel risk);
+    bool set_trading_params(const TradingAgent::TradingParams& params);
+    // Any thread; at most TradingAgent::kSnapshotInterval old while the
+    // agent is changing
+    std::shared_ptr<const TradingAgent::AgentSnapshot> status() const { return agent_.snapshot(); }
+
+    void register_metrics(MetricsServer& server);
+
+private:
+    struct MarketTick {
+        double bid = 0.0;
+        double ask = 0.0;
+        LatencyTracker::Clock::time_point received;
+    };
+
+    struct ControlCommand {
+        enum class Type {
+            START,
+            STOP,
+            SET_STRATEGY,
+            SET_RISK_LEVEL,
+            SET_PARAMS
+        };
+        Type type = Type::START;
+        TradingAgent::Strategy strategy = TradingAgent::Strategy::MOMENTUM;
+        TradingAgent::RiskLevel risk = TradingAgent::RiskLevel::CONSERVATIVE;
+        TradingAgent::TradingParams params{};
+    };
+
+    void run_strategy();
+    void run_gateway();
+    void apply_control(ControlCommand& command);
+    bool send_control(ControlCommand&& command);
+
+    DeribitTrader& trader_;
+    TradingAgent& agent_;
+
+    // All four rings share one page-backed region; declared first so it
+    // outlives them. It is faulted in by the constructing thread, so it sits
+    // on that thread's NUMA node rather than the strategy's or gateway's.
+    HugePageResource ring_pages_;
+    SpscQueue<MarketTick> ticks_;                   // Feed -> strategy
+    SpscQueue<ControlCommand> control_;             // Control -> strategy
+    SpscQueue<TradingAgent::OrderIntent> orders_;   // Strategy -> gateway
+    SpscQueue<TradingAgent::OrderAck> acks_;        // Gateway -> strategy
+
+    const WaitMode wait_mode_;
+    std::atomic<bool> stopping_{false};
+    std::atomic<bool> strategy_done_{false};
+    std::thread strategy_thread_;
+    std::thread gateway_thread_;
+
+    MetricCounter acks_dropped_;  // Gateway only, at shutdown
+};
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <libwebsockets.h>
+#include "metrics_server.hpp"
+
+// Joins what lws delivers back into whole messages. A message arrives in
+// pieces when it spans several WebSocket fragments or outgrows the rx
+// buffer, e.g. a deep book snapshot. Single-threaded.
+class MessageAssembler {
+public:
+    static constexpr size_t kMaxMessage = 16 * 1024 * 1024;
+
+    explicit MessageAssembler(size_t max_message = kMaxMessage) : max_message_(max_message) {}
+
+    // The whole message once last is set, else nothing. A message that
+    // arrives in one piece is returned as is, without a copy; otherwise the
+    // view is valid until the next call. A message over max_message is
+    // dropped whole.
+    std::optional<std::string_view> add(std::string_view piece, bool last);
+    // Drops a partial message, e.g. when its connection closes
+    void reset();
+
+private:
+    size_t max_message_;
+    std::string pending_;  // Keeps its capacity between messages
+    bool oversized_{false};
+    bool complete_{false};  // pending_ was returned; cleared on the next add
+};
+
+// One WebSocket connection with its own lws context and service thread.
+// The session connects, reconnects with jittered backoff and queues
+// outbound frames; protocol handling is left to the owner through
+// callbacks, which all run on this session's service thread.
+class WsSession {
+public:
+    // Cadence of reconnect checks and on_service while the socket is quiet
+    static constexpr std::chrono::milliseconds kSupervisionTick{100};
+
+    struct Callbacks {
+        std::function<void()> on_connect;
+        std::function<void(std::string_view)> on_message;
+        std::function<void()> on_disconnect;  // Closed, or a connect attempt failed
+        std::function<void()> on_service;     // After every service pass while connected, at
+                                              // least every kSupervisionTick
+    };
+
+    WsSession(std::string name, std::string host, int port, std::string path, Callbacks callbacks);
+    ~WsSession();
+
+    WsSession(const WsSession&) = delete;
+    WsSession& operator=(const WsSession&) = delete;
+
+    // Throws if the context cannot be created or the first connect fails
+    void start();
+    void stop();
+
+    // Thread-safe. Frames sent while disconnected are dropped; the owner
+    // replays auth and subscriptions from on_connect.
+    void send(std::string message);
+    // Called by the owner once a connection is fully usable again
+    void reset_backoff();
+
+    bool connected() const { return state_.load() == State::CONNECTED; }
+    const std::string& name() const { return name_; }
+    size_t queued() const;
+    uint64_t reconnects() const { return reconnects_.load(); }
+    uint64_t disconnects() const { return disconnects_.load(); }
+
+private:
+    enum class State { DISCONNECTED, CONNECTING, CONNECTED };
+
+    static struct lws_protocols* protocols();
+    static int callback(struct lws* wsi, enum lws_callback_reasons reason,
+                        void* user, void* in, size_t len);
+    void connect();
+    void run();
+    void schedule_reconnect();
+    void handle_closed();
+    void write_next();
+    // Service thread only; the timer lives on the context's sorted list
+    void arm_tick();
+    static void on_tick(lws_sorted_usec_list_t* sul);
+
+    std::string name_;
+    std::string host_;
+    int port_;
+    std::string path_;
+    Callbacks callbacks_;
+
+    // Touched only by the service thread once it runs
+    struct lws_context* context_{nullptr};
+    struct lws* connection_{nullptr};
+    std::chrono::steady_clock::time_point reconnect_at_;
+    std::chrono::milliseconds backoff_{500};
+    // lws hands the callback the list node only, so the session rides along
+    struct Tick {
+        lws_sorted_usec_list_t sul;  // First member: on_tick casts back from it
+        WsSession* session;
+    };
+    Tick tick_{};
+    MessageAssembler inbox_;
+
+    std::atomic<State> state_{State::DISCONNECTED};
+    std::atomic<bool> stopping_{false};
+    std::thread thread_;
+
+    std::deque<std::string> outbox_;
+    mutable std::mutex outbox_mutex_;
+
+    MetricCounter reconnects_;
+    MetricCounter disconnects_;
+};
@@ -0,0 +1,152 @@
+#include "app_config.hpp"
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+template <typename T>
+void read_key(const json& root, const char* key, T& out) {
+    auto it = root.find(key);
+    if (it != root.end() && !it->is_null()) {
+        out = it->get<T>();
+    }
+}
+
+void read_key(const json& root, const char* key, std::chrono::seconds& out) {
+    auto it = root.find(key);
+    if (it != root.end() && !it->is_null()) {
+        out = std::chrono::seconds(it->get<int64_t>());
+    }
+}
+
+}  // namespace
+
+AppConfig AppConfig::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Cannot open config file " + path);
+    }
+
+    AppConfig config;
+    try {
+        json root = json::parse(file);
+        if (!root.is_object()) {
+            throw std::invalid_argument("top level must be an object");
+        }
+
+        read_key(root, "api_key", config.api_key);
+        read_key(root, "api_secret", config.api_secret);
+        if (auto it = root.find("endpoints"); it != root.end()) {
+            read_key(*it, "rest_url", config.endpoints.rest_url);
+            read_key(*it, "ws_host", config.endpoints.ws_host);
+            read_key(*it, "ws_port", config.endpoints.ws_port);
+            read_key(*it, "ws_path", config.endpoints.ws_path);
+        }
+        read_key(root, "ws_sessions", config.ws_sessions);
+        read_key(root, "instrument_cache", config.instrument_cache);
+
+        read_key(root, "instrument", config.instrument);
+        read_key(root, "watch_instruments", config.watch_instruments);
+        read_key(root, "options_underlying", config.options_underlying);
+        if (auto it = root.find("strategy"); it != root.end()) {
+            config.strategy = parse_strategy(it->get<std::string>());
+        }
+        if (auto it = root.find("risk_level"); it != root.end()) {
+            config.risk_level = parse_risk_level(it->get<std::string>());
+        }
+        if (auto it = root.find("risk_limits"); it != root.end()) {
+            read_key(*it, "max_delta_usd", config.risk_limits.max_delta);
+            read_key(*it, "max_gamma_usd", config.risk_limits.max_gamma);
+            read_key(*it, "max_vega_usd", config.risk_limits.max_vega);
+            read_key(*it, "max_notional_usd", config.risk_limits.max_gross_notional);
+            read_key(*it, "max_var_usd", config.risk_limits.max_var);
+        }
+        if (auto it = root.find("var"); it != root.end()) {
+            read_key(*it, "paths", config.var.paths);
+            read_key(*it, "confidence", config.var.confidence);
+            read_key(*it, "horizon_s", config.var.horizon);
+            read_key(*it, "sample_interval_s", config.var.sample_interval);
+            read_key(*it, "interval_s", config.var.interval);
+            read_key(*it, "threads", config.var.threads);
+        }
+        if (auto it = root.find("trade_tape"); it != root.end()) {
+            auto window = std::chrono::duration_cast<std::chrono::seconds>(config.trade_tape.window);
+            read_key(*it, "capacity", config.trade_tape.capacity);
+            read_key(*it, "window_s", window);
+            read_key(*it, "tick_bar", config.trade_tape.tick_bar);
+            read_key(*it, "volume_bar", config.trade_tape.volume_bar);
+            read_key(*it, "dollar_bar", config.trade_tape.dollar_bar);
+            config.trade_tape.window = window;
+        }
+        read_key(root, "backfill_file", config.backfill_file);
+        read_key(root, "start_trading", config.start_trading);
+
+        read_key(root, "thread_layout", config.thread_layout);
+        read_key(root, "control_socket", config.control_socket);
+        read_key(root, "metrics_port", config.metrics_port);
+        read_key(root, "frontend_origin", config.frontend_origin);
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Invalid config file " + path + ": " + e.what());
+    }
+
+    if (config.instrument.empty() || config.ws_sessions == 0) {
+        throw std::runtime_error("Invalid config file " + path +
+                                 ": instrument and ws_sessions must not be empty");
+    }
+    if (config.var.confidence <= 0.0 || config.var.confidence >= 1.0 || config.var.paths == 0 ||
+        config.var.sample_interval.count() <= 0 || config.var.interval.count() <= 0) {
+        throw std::runtime_error("Invalid config file " + path +
+                                 ": var needs paths, a confidence in (0, 1) and positive intervals");
+    }
+    if (config.trade_tape.capacity == 0 || config.trade_tape.window.count() <= 0) {
+        throw std::runtime_error("Invalid config file " + path +
+                                 ": trade_tape needs a capacity and a positive window");
+    }
+    return config;
+}
+
+void AppConfig::apply_environment() {
+    if (const char* key = std::getenv("DERIBIT_API_KEY")) {
+        api_key = key;
+    }
+    if (const char* secret = std::getenv("DERIBIT_API_SECRET")) {
+        api_secret = secret;
+    }
+}
+
+TradingAgent::Strategy AppConfig::parse_strategy(std::string_view name) {
+    if (name == "momentum") return TradingAgent::Strategy::MOMENTUM;
+    if (name == "mean_reversion") return TradingAgent::Strategy::MEAN_REVERSION;
+    if (name == "breakout") return TradingAgent::Strategy::BREAKOUT;
+    if (name == "order_flow") return TradingAgent::Strategy::ORDER_FLOW;
+    if (name == "book_imbalance") return TradingAgent::Strategy::BOOK_IMBALANCE;
+    throw std::invalid_argument("Unknown strategy '" + std::string(name) + "'");
+}
+
+TradingAgent::RiskLevel AppConfig::parse_risk_level(std::string_view name) {
+    if (name == "conservative") return TradingAgent::RiskLevel::CONSERVATIVE;
+    if (name == "moderate") return TradingAgent::RiskLevel::MODERATE;
+    if (name == "aggressive") return TradingAgent::RiskLevel::AGGRESSIVE;
+    throw std::invalid_argument("Unknown risk level '" + std::string(name) + "'");
+}
+
+const char* AppConfig::strategy_name(TradingAgent::Strategy strategy) {
+    switch (strategy) {
+        case TradingAgent::Strategy::MOMENTUM: return "momentum";
+        case TradingAgent::Strategy::MEAN_REVERSION: return "mean_reversion";
+        case TradingAgent::Strategy::BREAKOUT: return "breakout";
+        case TradingAgent::Strategy::ORDER_FLOW: return "order_flow";
+        case TradingAgent::Strategy::BOOK_IMBALANCE: return "book_imbalance";
+    }
+    return "unknown";
+}
+
+const char* AppConfig::risk_level_name(TradingAgent::RiskLevel risk) {
+    switch (risk) {
+        case TradingAgent::RiskLevel::CONSERVATIVE: return "conservative";
+        case TradingAgent::RiskLevel::MODERATE: return "moderate";
+        case TradingAgent::RiskLevel::AGGRESSIVE: return "aggressive";
+    }
+    return "unknown";
+}
@@ -0,0 +1,97 @@
+#include "book_features.hpp"
+#include <algorithm>
+#include <cmath>
+#include "order_book.hpp"
+
+BookFeatures::BookFeatures(std::chrono::milliseconds half_life)
+    : decay_per_ms_(std::log(2.0) / static_cast<double>(std::max<int64_t>(half_life.count(), 1))) {}
+
+void BookFeatures::decay_to(int64_t timestamp_ms) {
+    // Book and trade timestamps interleave slightly out of order; never
+    // decay backwards
+    if (timestamp_ms <= decayed_at_ms_) {
+        return;
+    }
+    if (decayed_at_ms_ != 0) {
+        double factor = std::exp(-static_cast<double>(timestamp_ms - decayed_at_ms_) * decay_per_ms_);
+        values_.ofi *= factor;
+        flow_abs_ *= factor;
+        values_.signed_volume *= factor;
+        volume_ *= factor;
+    }
+    decayed_at_ms_ = timestamp_ms;
+}
+
+void BookFeatures::on_book(const OrderBook& book, int64_t timestamp_ms) {
+    const auto& bids = book.bids();
+    const auto& asks = book.asks();
+    if (bids.empty() || asks.empty()) {
+        // One-sided: nothing to compare the next update against
+        has_top_ = false;
+        values_.valid = false;
+        return;
+    }
+
+    decay_to(timestamp_ms);
+    auto [bid_price, bid_size] = *bids.begin();
+    auto [ask_price, ask_size] = *asks.begin();
+    if (has_top_) {
+        double flow = 0.0;
+        flow += bid_price >= bid_price_ ? bid_size : 0.0;
+        flow -= bid_price <= bid_price_ ? bid_size_ : 0.0;
+        flow -= ask_price <= ask_price_ ? ask_size : 0.0;
+        flow += ask_price >= ask_price_ ? ask_size_ : 0.0;
+        values_.ofi += flow;
+        flow_abs_ += std::fabs(flow);
+    }
+    has_top_ = true;
+    bid_price_ = bid_price;
+    bid_size_ = bid_size;
+    ask_price_ = ask_price;
+    ask_size_ = ask_size;
+
+    double top = bid_size + ask_size;
+    values_.microprice = top > 0.0 ? (bid_price * ask_size + ask_price * bid_size) / top
+                                   : 0.5 * (bid_price + ask_price);
+    values_.top_imbalance = top > 0.0 ? (bid_size - ask_size) / top : 0.0;
+
+    double bid_depth = 0.0;
+    size_t levels = 0;
+    for (auto it = bids.begin(); it != bids.end() && levels < kDepthLevels; ++it, ++levels) {
+        bid_depth += it->second;
+    }
+    double ask_depth = 0.0;
+    levels = 0;
+    for (auto it = asks.begin(); it != asks.end() && levels < kDepthLevels; ++it, ++levels) {
+        ask_depth += it->second;
+    }
+    double depth = bid_depth + ask_depth;
+    values_.bid_depth = bid_depth;
+    values_.ask_depth = ask_depth;
+    values_.depth_imbalance = depth > 0.0 ? (bid_depth - ask_depth) / depth : 0.0;
+
+    values_.valid = true;
+    values_.timestamp_ms = std::max(values_.timestamp_ms, timestamp_ms);
+    publish_ratios();
+}
+
+void BookFeatures::on_trade(bool buy, double amount, int64_t timestamp_ms) {
+    decay_to(timestamp_ms);
+    values_.signed_volume += buy ? amount : -amount;
+    volume_ += amount;
+    values_.timestamp_ms = std::max(values_.timestamp_ms, timestamp_ms);
+    publish_ratios();
+}
+
+void BookFeatures::reset() {
+    has_top_ = false;
+    values_.valid = false;
+    values_.ofi = 0.0;
+    flow_abs_ = 0.0;
+    publish_ratios();
+}
+
+void BookFeatures::publish_ratios() {
+    values_.ofi_ratio = flow_abs_ > 0.0 ? values_.ofi / flow_abs_ : 0.0;
+    values_.volume_ratio = volume_ > 0.0 ? values_.signed_volume / volume_ : 0.0;
+}
@@ -0,0 +1,195 @@
+#include "control_server.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+#include <spdlog/spdlog.h>
+
+namespace {
+
+constexpr size_t kMaxCommandLength = 4096;
+constexpr size_t kMaxClients = 8;
+constexpr std::chrono::seconds kClientIdleTimeout{60};
+
+bool send_all(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t written = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (written <= 0) {
+            return false;
+        }
+        sent += static_cast<size_t>(written);
+    }
+    return true;
+}
+
+}  // namespace
+
+ControlServer::ControlServer(std::string path, Handler handler)
+    : path_(std::move(path)), handler_(std::move(handler)) {}
+
+ControlServer::~ControlServer() {
+    stop();
+}
+
+void ControlServer::start() {
+    if (running_) return;
+
+    sockaddr_un addr{};
+    if (path_.empty() || path_.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("Control socket path must be 1-" +
+                                 std::to_string(sizeof(addr.sun_path) - 1) + " characters");
+    }
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path_.c_str(), path_.size() + 1);
+
+    // Never unlink something that is not a socket
+    struct stat existing{};
+    if (lstat(path_.c_str(), &existing) == 0) {
+        if (!S_ISSOCK(existing.st_mode)) {
+            throw std::runtime_error("Control socket path " + path_ + " exists and is not a socket");
+        }
+        unlink(path_.c_str());
+    }
+
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) {
+        throw std::runtime_error("Failed to create control socket: " + std::string(strerror(errno)));
+    }
+    // Anyone who can connect can trade, so the socket is created owner-only
+    // rather than tightened after bind, which would leave a window where
+    // other users could connect
+    mode_t previous_umask = umask(0077);
+    int bound = bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    int bind_errno = errno;
+    umask(previous_umask);
+    if (bound < 0 || listen(listen_fd_, 4) < 0) {
+        std::string error = strerror(bound < 0 ? bind_errno : errno);
+        close(listen_fd_);
+        listen_fd_ = -1;
+        throw std::runtime_error("Failed to bind control socket " + path_ + ": " + error);
+    }
+    if (chmod(path_.c_str(), S_IRUSR | S_IWUSR) < 0) {
+        std::string error = strerror(errno);
+        close(listen_fd_);
+        listen_fd_ = -1;
+        unlink(path_.c_str());
+        throw std::runtime_error("Failed to restrict control socket " + path_ + ": " + error);
+    }
+
+    running_ = true;
+    server_thread_ = std::thread(&ControlServer::serve_loop, this);
+    spdlog::info("Control socket listening on {}", path_);
+}
+
+void ControlServer::stop() {
+    running_ = false;
+    if (server_thread_.joinable()) {
+        server_thread_.join();
+    }
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+        listen_fd_ = -1;
+        unlink(path_.c_str());
+    }
+}
+
+void ControlServer::serve_loop() {
+    std::vector<Client> clients;
+
+    while (running_) {
+        std::vector<pollfd> fds;
+        fds.reserve(clients.size() + 1);
+        fds.push_back({listen_fd_, POLLIN, 0});
+        for (const auto& client : clients) {
+            fds.push_back({client.fd, POLLIN, 0});
+        }
+
+        // Wake up periodically so stop() and idle clients are noticed
+        int ready = poll(fds.data(), fds.size(), 200);
+        if (ready < 0) {
+            continue;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < clients.size(); ++i) {
+            Client& client = clients[i];
+            bool open = true;
+            if (fds[i + 1].revents != 0) {
+                client.last_active = now;
+                try {
+                    open = serve_client(client);
+                } catch (const std::exception& e) {
+                    spdlog::warn("Control client failed: {}", e.what());
+                    open = false;
+                }
+            } else if (now - client.last_active > kClientIdleTimeout) {
+                spdlog::info("Closing idle control client");
+                open = false;
+            }
+            if (!open) {
+                close(client.fd);
+                client.fd = -1;
+            }
+        }
+        clients.erase(std::remove_if(clients.begin(), clients.end(),
+                                     [](const Client& client) { return client.fd < 0; }),
+                      clients.end());
+
+        if (fds[0].revents & POLLIN) {
+            int client_fd = accept(listen_fd_, nullptr, nullptr);
+            if (client_fd < 0) {
+                continue;
+            }
+            if (clients.size() >= kMaxClients) {
+                send_all(client_fd, "{\"error\":\"too many control clients\"}\n");
+                close(client_fd);
+                continue;
+            }
+            // A client that stops reading replies must not hold the thread
+            timeval send_timeout{1, 0};
+            setsockopt(client_fd, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout));
+            clients.push_back({client_fd, {}, now});
+        }
+    }
+
+    for (const auto& client : clients) {
+        close(client.fd);
+    }
+}
+
+bool ControlServer::serve_client(Client& client) {
+    char buffer[1024];
+    ssize_t n = recv(client.fd, buffer, sizeof(buffer), 0);
+    if (n <= 0) {
+        return false;
+    }
+    client.pending.append(buffer, static_cast<size_t>(n));
+
+    size_t newline;
+    while ((newline = client.pending.find('\n')) != std::string::npos) {
+        std::string command = client.pending.substr(0, newline);
+        client.pending.erase(0, newline + 1);
+        if (!command.empty() && command.back() == '\r') {
+            command.pop_back();
+        }
+        if (command.empty()) {
+            continue;
+        }
+        if (!send_all(client.fd, handler_(command) + "\n")) {
+            return false;
+        }
+    }
+    if (client.pending.size() > kMaxCommandLength) {
+        send_all(client.fd, "{\"error\":\"command too long\"}\n");
+        return false;
+    }
+    return true;
+}
@@ -1,29 +1,96 @@
 #include "deribit_trader.hpp"
+#include "message_parser.hpp"
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 #include <ctime>
+#include <tuple>
 #include <curl/curl.h>
 #include <openssl/ssl.h>
 #include <openssl/err.h>
 
-// WebSocket protocols
-struct lws_protocols* DeribitTrader::get_protocols() {
-    static struct lws_protocols protocols[] = {
-        {
-            "deribit-protocol",
-            DeribitTrader::ws_callback,
-            0,
-            4096,
-        },
-        { nullptr, nullptr, 0, 0 }
-    };
-    return protocols;
+namespace {
+
+constexpr int kHeartbeatIntervalSeconds = 10;
+constexpr auto kRttProbeInterval = std::chrono::seconds(5);
+constexpr auto kTimeSyncInterval = std::chrono::seconds(30);
+constexpr auto kProbeTimeout = std::chrono::seconds(30);
+constexpr size_t kTimeSamples = 8;
+constexpr auto kStartupTimeout = std::chrono::seconds(30);
+constexpr size_t kSubscribeBatch = 500;
+
+double wall_clock_ms() {
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
 }
 
-DeribitTrader::DeribitTrader(const std::string& api_key, const std::string& api_secret)
-    : api_key_(api_key), api_secret_(api_secret) {
-    init_websocket();
-    authenticate();
+// One entry of a trades notification; false when the price or amount is
+// missing or not a number. The side is the taker's, and anything but "buy"
+// counts as a sell.
+bool parse_trade(const message_json& each, TradeTape::Trade& trade) {
+    auto price = each.find("price");
+    auto amount = each.find("amount");
+    if (price == each.end() || amount == each.end() || !price->is_number() || !amount->is_number()) {
+        return false;
+    }
+    auto direction = each.find("direction");
+    trade.timestamp_ms = each.value("timestamp", int64_t{0});
+    trade.price = price->get<double>();
+    trade.amount = amount->get<double>();
+    trade.buy = direction != each.end() && direction->is_string() &&
+                direction->get_ref<const arena_string&>() == "buy";
+    return true;
+}
+
+}  // namespace
+
+DeribitTrader::DeribitTrader(const std::string& api_key, const std::string& api_secret, bool connect,
+                             size_t ws_sessions)
+    : DeribitTrader(api_key, api_secret, Endpoints{}, connect, ws_sessions) {}
+
+DeribitTrader::DeribitTrader(const std::string& api_key, const std::string& api_secret,
+                             const Endpoints& endpoints, bool connect, size_t ws_sessions,
+                             const std::string& instrument_cache)
+    : api_key_(api_key), api_secret_(api_secret), endpoints_(endpoints),
+      instrument_cache_path_(instrument_cache), constructed_at_(std::chrono::steady_clock::now()) {
+    if (ws_sessions == 0) {
+        throw std::invalid_argument("At least one WebSocket session is required");
+    }
+    for (size_t i = 0; i < ws_sessions; ++i) {
+        auto session = std::make_unique<SessionState>();
+        session->index = i;
+        session->book_pool = std::make_unique<HugePagePool>();
+        sessions_.push_back(std::move(session));
+    }
+
+    if (!connect) {
+        std::promise<StartupReport> offline;
+        offline.set_value({});
+        ready_ = offline.get_future().share();
+        return;
+    }
+
+    // A universe saved by an earlier run serves lookups until the fresh one lands
+    StartupReport report;
+    if (!instrument_cache_path_.empty()) {
+        if (auto file = InstrumentCache::open(instrument_cache_path_)) {
+            spdlog::info("Mapped {} instruments from {}, fetched {:.0f} s ago", file->size(),
+                         instrument_cache_path_, (wall_clock_ms() - file->fetched_at_ms()) / 1000.0);
+            report.instrument_count = file->size();
+            report.instruments = seconds_since_construction();
+            report.instruments_from_file = true;
+            std::atomic_store(&instrument_file_, file);
+        }
+    }
+
+    // Session threads connect and authenticate on their own from here
+    start_sessions();
+    report.tls_init = seconds_since_construction();
+    universe_ = std::async(std::launch::async, [this] {
+        size_t count = load_instruments();
+        return std::make_pair(count, seconds_since_construction());
+    }).share();
+    ready_ = std::async(std::launch::async, &DeribitTrader::run_startup, this, report).share();
 }
 
 DeribitTrader::~DeribitTrader() {
@@ -43,17 +110,108 @@ json DeribitTrader::get_instrument_details(const std::string& instrument_name) {
     return send_public_request("/public/get_instrument", params["params"]);
 }
 
+std::optional<DeribitTrader::InstrumentSpec> DeribitTrader::instrument_spec(const std::string& instrument_name) {
+    {
+        std::lock_guard<std::mutex> lock(instruments_mutex_);
+        auto it = instruments_.find(instrument_name);
+        if (it != instruments_.end()) {
+            return it->second;
+        }
+    }
+    if (auto file = std::atomic_load(&instrument_file_)) {
+        if (auto spec = file->find(instrument_name)) {
+            return spec;
+        }
+    }
+
+    json instrument_response = get_instrument_details(instrument_name);
+    if (!instrument_response.contains("result") || !instrument_response["result"].is_object()) {
+        return std::nullopt;
+    }
+    InstrumentSpec spec = parse_instrument_spec(instrument_response["result"]);
+    std::lock_guard<std::mutex> lock(instruments_mutex_);
+    instruments_[instrument_name] = spec;
+    return spec;
+}
+
+DeribitTrader::InstrumentSpec DeribitTrader::parse_instrument_spec(const json& instrument) {
+    InstrumentSpec spec;
+    spec.contract_size = instrument.value("contract_size", 1.0);
+    if (instrument.contains("min_order_size")) {
+        spec.min_amount = instrument["min_order_size"].get<double>();
+    } else if (instrument.contains("contract_size")) {
+        spec.min_amount = instrument["contract_size"].get<double>();
+    }
+    spec.tick_size = instrument.value("tick_size", 0.0);
+    spec.expiration_ms = instrument.value("expiration_timestamp", int64_t{0});
+    spec.inverse = instrument.value("instrument_type", std::string()) == "reversed";
+
+    std::string kind = instrument.value("kind", std::string("future"));
+    if (kind == "option") {
+        spec.kind = InstrumentKind::OPTION;
+        spec.strike = instrument.value("strike", 0.0);
+        spec.option_type = instrument.value("option_type", std::string()) == "put" ? 'P' : 'C';
+    } else if (kind == "spot") {
+        spec.kind = InstrumentKind::SPOT;
+    } else if (kind == "future_combo") {
+        spec.kind = InstrumentKind::FUTURE_COMBO;
+    } else if (kind == "option_combo") {
+        spec.kind = InstrumentKind::OPTION_COMBO;
+    }
+    return spec;
+}
+
+// One request for every live instrument; afterwards order validation never
+// leaves the process. With a cache path the result replaces the file, and
+// the new mapping is swapped in for readers.
+size_t DeribitTrader::load_instruments() {
+    json response = send_public_request("/public/get_instruments", {
+        {"currency", "any"},
+        {"expired", false}
+    });
+    if (!response.contains("result") || !response["result"].is_array()) {
+        throw std::runtime_error("Invalid get_instruments response");
+    }
+
+    auto fetched_at_ms = static_cast<int64_t>(wall_clock_ms());
+    std::vector<InstrumentCache::Entry> loaded;
+    for (const auto& instrument : response["result"]) {
+        auto name = instrument.find("instrument_name");
+        if (name != instrument.end() && name->is_string()) {
+            loaded.emplace_back(name->get<std::string>(), parse_instrument_spec(instrument));
+        }
+    }
+
+    if (!instrument_cache_path_.empty()) {
+        try {
+            InstrumentCache::write(instrument_cache_path_, loaded, fetched_at_ms);
+            if (auto file = InstrumentCache::open(instrument_cache_path_)) {
+                std::atomic_store(&instrument_file_, file);
+                spdlog::info("Saved {} instruments to {}", file->size(), instrument_cache_path_);
+                return file->size();
+            }
+            spdlog::warn("Instrument cache {} unreadable after writing", instrument_cache_path_);
+        } catch (const std::exception& e) {
+            spdlog::warn("Instrument cache not saved: {}", e.what());
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(instruments_mutex_);
+    for (auto& [name, spec] : loaded) {
+        instruments_[name] = spec;
+    }
+    return loaded.size();
+}
+
 double DeribitTrader::round_to_contract_size(const std::string& instrument_name, double amount) {
     try {
-        json instrument_response = get_instrument_details(instrument_name);
-        
-        if (!instrument_response.contains("result")) {
+        auto spec = instrument_spec(instrument_name);
+        if (!spec) {
             std::cerr << "Failed to retrieve instrument details" << std::endl;
             return amount;
         }
 
-        const auto& instrument = instrument_response["result"];
-        double contract_size = instrument.value("contract_size", 1.0);
+        double contract_size = spec->contract_size;
         double rounded_amount = std::round(amount / contract_size) * contract_size;
         
         std::cout << "Original amount: " << amount 
@@ -69,22 +227,13 @@ double DeribitTrader::round_to_contract_size(const std::string& instrument_name,
 
 double DeribitTrader::get_minimum_order_amount(const std::string& instrument_name) {
     try {
-        json instrument_response = get_instrument_details(instrument_name);
-
-        if (!instrument_response.contains("result")) {
+        auto spec = instrument_spec(instrument_name);
+        if (!spec) {
             std::cerr << "Failed to retrieve instrument details" << std::endl;
             return 0.001; 
         }
 
-        const auto& instrument = instrument_response["result"];
-        double min_amount = 0.001; 
-        
-        if (instrument.contains("min_order_size")) {
-            min_amount = instrument["min_order_size"].get<double>();
-        } else if (instrument.contains("contract_size")) {
-            min_amount = instrument["contract_size"].get<double>();
-        }
-        
+        double min_amount = spec->min_amount;
         std::cout << "Minimum order amount for " << instrument_name 
                   << ": " << min_amount << std::endl;
         
@@ -100,6 +249,7 @@ std::string DeribitTrader::place_order(const OrderRequest& request) {
         throw std::invalid_argument("Instrument name is required");
     }
 
+    auto validate_start = LatencyTracker::now();
     double order_amount = request.amount;
     double min_amount = get_minimum_order_amount(request.instrument_name);
     
@@ -112,44 +262,38 @@ std::string DeribitTrader::place_order(const OrderRequest& request) {
     }
 
     double rounded_amount = round_to_contract_size(request.instrument_name, order_amount);
-
-    json payload = {
-        {"jsonrpc", "2.0"},
-        {"method", "private/" + request.direction},
-        {"params", {
-            {"instrument_name", request.instrument_name},
-            {"type", request.type.empty() ? "limit" : request.type},
-            {"amount", rounded_amount}
-        }},
-        {"id", 1}
-    };
-
-    if (request.type == "limit" || request.type.empty()) {
-        if (request.price <= 0) {
-            throw std::invalid_argument("Limit order price must be positive");
+    latency_.record(LatencyStage::ORDER_VALIDATE, validate_start, LatencyTracker::now());
+
+    // Common order shapes are encoded from per-instrument templates into a
+    // per-thread buffer; anything else falls back to building the JSON
+    // document in the arena
+    thread_local OrderEncoder encoder;
+    thread_local std::string fallback_body;
+    thread_local std::string fallback_endpoint;
+    MessageArena::Scope arena_scope;
+    // Encoding rejects orders too (non-finite numbers, a bad limit price),
+    // and those count as order errors like the exchange's rejections
+    try {
+        auto serialize_start = LatencyTracker::now();
+        uint64_t request_id = next_request_id_.fetch_add(1, std::memory_order_relaxed);
+        OrderFields fields{request.instrument_name, request.direction, request.type,
+                           request.time_in_force, request.post_only, request.reduce_only,
+                           rounded_amount, request.price};
+        OrderEncoder::Encoded encoded;
+        if (!encoder.encode(fields, request_id, encoded)) {
+            message_json payload = build_order_payload(request, rounded_amount);
+            payload["id"] = request_id;
+            const auto body = payload.dump();
+            fallback_body.assign(body.data(), body.size());
+            fallback_endpoint = "/private/" + request.direction;
+            encoded = {fallback_endpoint, fallback_body};
         }
-        payload["params"]["price"] = request.price;
-    }
+        latency_.record(LatencyStage::SERIALIZE, serialize_start, LatencyTracker::now());
 
-    if (request.post_only) {
-        payload["params"]["post_only"] = true;
-    }
+        std::cout << "Order Placement Payload:" << std::endl;
+        std::cout << encoded.body << std::endl;
 
-    if (request.reduce_only) {
-        payload["params"]["reduce_only"] = true;
-    }
-
-    payload["params"]["time_in_force"] = request.time_in_force.empty() 
-        ? "good_til_cancelled" 
-        : request.time_in_force;
-
-    std::cout << "Order Placement Payload:" << std::endl;
-    std::cout << payload.dump(4) << std::endl;
-
-    std::string endpoint = "/private/" + request.direction;
-
-    try {
-        json response = send_authenticated_request(endpoint, payload);
+        json response = send_authenticated_payload(encoded.endpoint, encoded.body);
         std::cout << "Order Placement Response:" << std::endl;
         std::cout << response.dump(4) << std::endl;
 
@@ -184,13 +328,54 @@ std::string DeribitTrader::place_order(const OrderRequest& request) {
         std::cout << "Direction: " << request.direction << std::endl;
         std::cout << "Amount: " << rounded_amount << std::endl;
 
+        orders_placed_.increment();
+        if (!first_order_seen_.exchange(true, std::memory_order_relaxed)) {
+            double seconds = seconds_since_construction();
+            first_order_seconds_.set(seconds);
+            spdlog::info("Time to first trade: {:.3f} s", seconds);
+        }
         return order_id;
     } catch (const std::exception& e) {
+        order_errors_.increment();
         std::cerr << "Order Placement Exception: " << e.what() << std::endl;
         throw;
     }
 }
 
+message_json DeribitTrader::build_order_payload(const OrderRequest& request, double amount) {
+    message_json payload = {
+        {"jsonrpc", "2.0"},
+        {"method", "private/" + request.direction},
+        {"params", {
+            {"instrument_name", request.instrument_name},
+            {"type", request.type.empty() ? "limit" : request.type},
+            {"amount", amount}
+        }},
+        {"id", 1}
+    };
+
+    if (request.type == "limit" || request.type.empty()) {
+        if (request.price <= 0) {
+            throw std::invalid_argument("Limit order price must be positive");
+        }
+        payload["params"]["price"] = request.price;
+    }
+
+    if (request.post_only) {
+        payload["params"]["post_only"] = true;
+    }
+
+    if (request.reduce_only) {
+        payload["params"]["reduce_only"] = true;
+    }
+
+    payload["params"]["time_in_force"] = request.time_in_force.empty() 
+        ? "good_til_cancelled" 
+        : request.time_in_force;
+
+    return payload;
+}
+
 bool DeribitTrader::cancel_order(const std::string& order_id) {
     json payload = {
         {"jsonrpc", "2.0"},
@@ -307,35 +492,449 @@ json DeribitTrader::get_orderbook(const std::string& instrument_name, int depth)
     return send_public_request("/public/get_order_book", params);
 }
 
+json DeribitTrader::get_tradingview_chart_data(const std::string& instrument_name,
+                                               int64_t start_timestamp,
+                                               int64_t end_timestamp,
+                                               const std::string& resolution) {
+    json params = {
+        {"instrument_name", instrument_name},
+        {"start_timestamp", start_timestamp},
+        {"end_timestamp", end_timestamp},
+        {"resolution", resolution}
+    };
+
+    return send_public_request("/public/get_tradingview_chart_data", params);
+}
+
+json DeribitTrader::get_last_trades(const std::string& instrument_name, int count) {
+    json params = {
+        {"instrument_name", instrument_name},
+        {"count", count}
+    };
+
+    return send_public_request("/public/get_last_trades_by_instrument", params);
+}
+
 void DeribitTrader::subscribe_orderbook(const std::string& instrument_name) {
+    subscribe_orderbook(instrument_name, {FeedInterval::MS_100, 0, "none"});
+}
+
+void DeribitTrader::subscribe_orderbook(const std::string& instrument_name, const BookSubscription& options) {
+    std::string channel = book_channel(instrument_name, options);
+    std::string previous = track_book(instrument_name, channel, options.depth > 0);
+    if (!previous.empty() && previous != channel) {
+        unsubscribe(previous);
+    }
+    subscribe_channel(channel);
+}
+
+void DeribitTrader::subscribe_trades(const std::string& instrument_name, FeedInterval interval) {
+    {
+        SessionState& session = *sessions_[shard_for_instrument(instrument_name)];
+        std::lock_guard<std::mutex> lock(session.books_mutex);
+        if (session.tapes.find(instrument_name) == session.tapes.end()) {
+            session.tapes.emplace(instrument_name, std::make_unique<TradeTape>(tape_settings_));
+        }
+    }
+    subscribe_channel(trades_channel(instrument_name, interval));
+}
+
+void DeribitTrader::subscribe_tickers(const std::vector<std::string>& instrument_names, FeedInterval interval) {
+    std::vector<std::string> channels;
+    channels.reserve(instrument_names.size());
+    for (const auto& instrument : instrument_names) {
+        channels.push_back(ticker_channel(instrument, interval));
+    }
+    subscribe_channels(channels);
+}
+
+void DeribitTrader::unsubscribe(const std::string& channel) {
+    SessionState& session = *sessions_[shard_for(channel)];
+    {
+        std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+        session.channels.erase(channel);
+    }
+
+    json msg = {
+        {"jsonrpc", "2.0"},
+        {"method", "public/unsubscribe"},
+        {"params", {
+            {"channels", json::array({channel})}
+        }},
+        {"id", next_request_id_.fetch_add(1, std::memory_order_relaxed)}
+    };
+
+    send_ws_message(session, msg.dump());
+}
+
+// Shards by the instrument part of "kind.instrument[.options]"
+size_t DeribitTrader::shard_for(std::string_view channel) const {
+    auto begin = channel.find('.');
+    std::string_view key = channel;
+    if (begin != std::string_view::npos) {
+        auto end = channel.find('.', begin + 1);
+        key = channel.substr(begin + 1, end == std::string_view::npos ? end : end - begin - 1);
+    }
+    return shard_for_instrument(key);
+}
+
+size_t DeribitTrader::shard_for_instrument(std::string_view instrument) const {
+    return std::hash<std::string_view>{}(instrument) % sessions_.size();
+}
+
+const char* DeribitTrader::interval_name(FeedInterval interval) {
+    switch (interval) {
+        case FeedInterval::RAW: return "raw";
+        case FeedInterval::MS_100: return "100ms";
+        case FeedInterval::AGG2: return "agg2";
+    }
+    return "100ms";
+}
+
+std::string DeribitTrader::book_channel(const std::string& instrument_name, const BookSubscription& options) {
+    if (options.depth == 0) {
+        return "book." + instrument_name + "." + interval_name(options.interval);
+    }
+
+    if (options.depth != 1 && options.depth != 10 && options.depth != 20) {
+        throw std::invalid_argument("Book depth must be 0 (full), 1, 10 or 20");
+    }
+    if (options.interval == FeedInterval::RAW) {
+        throw std::invalid_argument("Depth-limited books are only available at 100ms or agg2");
+    }
+    return "book." + instrument_name + "." + (options.group.empty() ? "none" : options.group) + "." +
+           std::to_string(options.depth) + "." + interval_name(options.interval);
+}
+
+std::string DeribitTrader::trades_channel(const std::string& instrument_name, FeedInterval interval) {
+    return "trades." + instrument_name + "." + interval_name(interval);
+}
+
+std::string DeribitTrader::ticker_channel(const std::string& instrument_name, FeedInterval interval) {
+    return "ticker." + instrument_name + "." + interval_name(interval);
+}
+
+// Returns the channel previously feeding this instrument's book, if any
+std::string DeribitTrader::track_book(const std::string& instrument_name, const std::string& channel,
+                                      bool grouped) {
+    // Every book channel of the instrument shards to this session
+    SessionState& session = *sessions_[shard_for(channel)];
+    std::lock_guard<std::mutex> lock(session.books_mutex);
+    auto it = session.books.find(instrument_name);
+    std::string previous = it == session.books.end() ? std::string{} : it->second.channel;
+    if (previous != channel) {
+        if (it != session.books.end()) {
+            if (it->second.resyncing) {
+                books_resyncing_.fetch_sub(1);
+            }
+            session.books.erase(it);
+        }
+        // Rebuilt rather than assigned: pmr containers keep the resource
+        // they were constructed with
+        session.books.emplace(instrument_name, BookState{channel, OrderBook(grouped, session.book_pool->resource())});
+        market_board_.invalidate_book(instrument_name);
+    }
+    return previous;
+}
+
+void DeribitTrader::track_channel(const std::string& channel) {
+    std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+    sessions_[shard_for(channel)]->channels.insert(channel);
+}
+
+void DeribitTrader::subscribe_channel(const std::string& channel) {
+    track_channel(channel);
+
     json msg = {
         {"jsonrpc", "2.0"},
         {"method", "public/subscribe"},
         {"params", {
-            {"channels", {"book." + instrument_name + ".100ms"}}
+            {"channels", json::array({channel})}
         }},
-        {"id", 42}
+        {"id", next_request_id_.fetch_add(1, std::memory_order_relaxed)}
     };
     
-    send_ws_message(msg.dump());
+    send_ws_message(*sessions_[shard_for(channel)], msg.dump());
+}
+
+// Tracks the channels and subscribes them per session in batches of
+// kSubscribeBatch, instead of one request per channel
+void DeribitTrader::subscribe_channels(const std::vector<std::string>& channels) {
+    std::vector<json> batches(sessions_.size(), json::array());
+    auto flush = [this, &batches](size_t shard) {
+        json msg = {
+            {"jsonrpc", "2.0"},
+            {"method", "public/subscribe"},
+            {"params", {{"channels", std::move(batches[shard])}}},
+            {"id", next_request_id_.fetch_add(1, std::memory_order_relaxed)}
+        };
+        send_ws_message(*sessions_[shard], msg.dump());
+        batches[shard] = json::array();
+    };
+
+    for (const auto& channel : channels) {
+        track_channel(channel);
+        size_t shard = shard_for(channel);
+        batches[shard].push_back(channel);
+        if (batches[shard].size() == kSubscribeBatch) {
+            flush(shard);
+        }
+    }
+    for (size_t shard = 0; shard < batches.size(); ++shard) {
+        if (!batches[shard].empty()) {
+            flush(shard);
+        }
+    }
 }
 
-void DeribitTrader::subscribe_trades(const std::string& instrument_name) {
+// One subscribe for every channel on the session; used after each (re)connect
+void DeribitTrader::resubscribe_all(SessionState& session) {
+    json channels = json::array();
+    {
+        std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+        for (const auto& channel : session.channels) {
+            channels.push_back(channel);
+        }
+    }
+    if (channels.empty()) {
+        return;
+    }
+
     json msg = {
         {"jsonrpc", "2.0"},
         {"method", "public/subscribe"},
         {"params", {
-            {"channels", {"trades." + instrument_name + ".100ms"}}
+            {"channels", channels}
         }},
-        {"id", 43}
+        {"id", next_request_id_.fetch_add(1, std::memory_order_relaxed)}
     };
-    
-    send_ws_message(msg.dump());
+
+    spdlog::info("[{}] Subscribing to {} channels", session.ws->name(), channels.size());
+    send_ws_message(session, msg.dump());
+}
+
+std::optional<DeribitTrader::TopOfBook> DeribitTrader::top_of_book(const std::string& instrument_name) const {
+    auto quote = market_board_.quote(instrument_name);
+    if (!quote || !quote->book_valid) {
+        return std::nullopt;
+    }
+    return TopOfBook{quote->best_bid, quote->best_ask, quote->change_id};
+}
+
+void DeribitTrader::begin_resync(std::string_view instrument, BookState& state) {
+    state.book.clear();
+    state.features.reset();
+    market_board_.invalidate_book(instrument);
+    if (!state.resyncing) {
+        state.resyncing = true;
+        books_resyncing_.fetch_add(1);
+    }
+    mark_market_data_stale();
+}
+
+// Resubscribing to the channel makes the server send a fresh snapshot
+void DeribitTrader::request_book_resync(std::string_view instrument, BookState& state) {
+    begin_resync(instrument, state);
+
+    json channels = json::array({state.channel});
+    json unsubscribe = {
+        {"jsonrpc", "2.0"},
+        {"method", "public/unsubscribe"},
+        {"params", {{"channels", channels}}},
+        {"id", next_request_id_.fetch_add(1, std::memory_order_relaxed)}
+    };
+    json subscribe = {
+        {"jsonrpc", "2.0"},
+        {"method", "public/subscribe"},
+        {"params", {{"channels", channels}}},
+        {"id", next_request_id_.fetch_add(1, std::memory_order_relaxed)}
+    };
+    SessionState& session = *sessions_[shard_for(state.channel)];
+    send_ws_message(session, unsubscribe.dump());
+    send_ws_message(session, subscribe.dump());
+}
+
+bool DeribitTrader::sessions_ready() const {
+    for (const auto& session : sessions_) {
+        if (!session->ws || !session->ws->connected() || !std::atomic_load(&session->token)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void DeribitTrader::mark_market_data_stale() {
+    if (market_data_stale_.load(std::memory_order_acquire)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(stale_mutex_);
+    if (!market_data_stale_.load(std::memory_order_relaxed)) {
+        stale_since_ = std::chrono::steady_clock::now();
+        market_data_stale_.store(true, std::memory_order_release);
+        spdlog::warn("Market data marked stale");
+    }
+}
+
+// Resyncing books are counted before the feed is marked stale, so a
+// session clearing the flag here cannot miss another's new resync
+void DeribitTrader::check_recovered() {
+    if (!market_data_stale_.load(std::memory_order_acquire)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(stale_mutex_);
+    if (!market_data_stale_.load(std::memory_order_relaxed) || books_resyncing_.load() > 0 || !sessions_ready()) {
+        return;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - stale_since_).count();
+    last_recovery_seconds_.set(seconds);
+    market_data_stale_.store(false, std::memory_order_release);
+    spdlog::info("Market data recovered after {:.3f}s", seconds);
+}
+
+// Only the books carried by the lost session need a new snapshot
+void DeribitTrader::mark_stale(SessionState& session) {
+    std::lock_guard<std::mutex> lock(session.books_mutex);
+    for (auto& [instrument, state] : session.books) {
+        begin_resync(instrument, state);
+    }
+    mark_market_data_stale();
+}
+
+void DeribitTrader::set_channel_handler(const std::string& channel,
+                                        std::function<void(const message_json&)> handler) {
+    std::lock_guard<std::mutex> lock(handlers_mutex_);
+    auto table = std::make_shared<RouteTable>(*std::atomic_load(&message_handlers_));
+    // A route is immutable once published; a replacement carries the count on
+    auto route = std::make_shared<ChannelRoute>();
+    route->handler = std::move(handler);
+    if (auto previous = table->find(channel); previous != table->end()) {
+        route->messages.increment(previous->second->messages.load());
+    }
+    (*table)[channel] = std::move(route);
+    std::atomic_store(&message_handlers_, std::shared_ptr<const RouteTable>(std::move(table)));
+}
+
+void DeribitTrader::register_metrics(MetricsServer& server) {
+    server.add_counter("deribit_ws_messages_total", "WebSocket frames received",
+                       [this] { return static_cast<double>(ws_messages_.load()); });
+    server.add_counter("deribit_ws_parse_errors_total", "WebSocket frames that failed to parse",
+                       [this] { return static_cast<double>(parse_errors_.load()); });
+    server.add_counter("deribit_ws_unrouted_notifications_total",
+                       "Subscription notifications without a registered handler",
+                       [this] { return static_cast<double>(unrouted_notifications_.load()); });
+    server.add_counter("deribit_ws_disconnects_total", "WebSocket connection closures",
+                       [this] {
+                           uint64_t total = 0;
+                           for (const auto& session : sessions_) {
+                               total += session->ws ? session->ws->disconnects() : 0;
+                           }
+                           return static_cast<double>(total);
+                       });
+    server.add_counter("deribit_orders_placed_total", "Orders acknowledged by the exchange",
+                       [this] { return static_cast<double>(orders_placed_.load()); });
+    server.add_counter("deribit_order_errors_total", "Order placements that failed",
+                       [this] { return static_cast<double>(order_errors_.load()); });
+    server.add_counter("deribit_token_refreshes_total", "Background access token renewals",
+                       [this] { return static_cast<double>(token_refreshes_.load()); });
+    server.add_counter("deribit_auth_failures_total", "Failed token renewals",
+                       [this] { return static_cast<double>(auth_failures_.load()); });
+    server.add_counter("deribit_ws_reconnects_total", "WebSocket reconnect attempts",
+                       [this] {
+                           uint64_t total = 0;
+                           for (const auto& session : sessions_) {
+                               total += session->ws ? session->ws->reconnects() : 0;
+                           }
+                           return static_cast<double>(total);
+                       });
+    server.add_counter("deribit_book_gaps_total", "Book change_id gaps that forced a resync",
+                       [this] { return static_cast<double>(book_gaps_.load()); });
+    server.add_gauge("deribit_market_data_stale", "1 while the feed is down or books are resyncing",
+                     [this] { return market_data_stale() ? 1.0 : 0.0; });
+    server.add_gauge("deribit_last_recovery_seconds", "Time from going stale to fully resynced, last outage",
+                     [this] { return last_recovery_seconds_.load(); });
+    server.add_counter("deribit_ws_heartbeat_requests_total", "Heartbeat test_requests answered",
+                       [this] { return static_cast<double>(heartbeat_requests_.load()); });
+    server.add_gauge("deribit_startup_seconds", "Construction to REST, instruments and WebSocket auth all ready",
+                     [this] { return startup_seconds_.load(); });
+    server.add_gauge("deribit_time_to_first_order_seconds", "Construction to the first acknowledged order",
+                     [this] { return first_order_seconds_.load(); });
+    server.add_gauge("deribit_clock_offset_ms", "Exchange clock minus local clock",
+                     [this] { return clock_offset_ms_.load(); });
+    server.add_gauge("deribit_book_pool_mapped_bytes", "Memory mapped for order book levels",
+                     [this] {
+                         size_t total = 0;
+                         for (const auto& session : sessions_) {
+                             total += session->book_pool->pages().mapped_bytes();
+                         }
+                         return static_cast<double>(total);
+                     });
+
+    const std::vector<double> latency_bounds = {
+        0.0005, 0.001, 0.002, 0.005, 0.01, 0.02, 0.05, 0.1, 0.2, 0.5, 1.0, 2.0
+    };
+    server.add_histogram("deribit_ws_rtt_seconds", "WebSocket round trip of public/test probes",
+                         [this] { return ws_rtt_.snapshot(); }, latency_bounds);
+    server.add_histogram("deribit_feed_latency_seconds",
+                         "Exchange timestamp to local receipt of notifications (ms resolution)",
+                         [this] { return feed_latency_.snapshot(); }, latency_bounds);
+
+    server.add_collector([this](std::ostream& out) {
+        out << "# HELP deribit_channel_messages_total Notifications received per channel\n"
+            << "# TYPE deribit_channel_messages_total counter\n";
+        auto routes = std::atomic_load(&message_handlers_);
+        for (const auto& [channel, route] : *routes) {
+            out << "deribit_channel_messages_total{channel=\"" << channel << "\"} "
+                << route->messages.load() << "\n";
+        }
+    });
+
+    server.add_collector([this](std::ostream& out) {
+        out << "# HELP deribit_ws_session_connected 1 while the market data session is connected\n"
+            << "# TYPE deribit_ws_session_connected gauge\n";
+        for (const auto& session : sessions_) {
+            out << "deribit_ws_session_connected{session=\"" << session->index << "\"} "
+                << (session->ws && session->ws->connected() ? 1 : 0) << "\n";
+        }
+        out << "# HELP deribit_ws_session_channels Channels carried by each session\n"
+            << "# TYPE deribit_ws_session_channels gauge\n";
+        {
+            std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+            for (const auto& session : sessions_) {
+                out << "deribit_ws_session_channels{session=\"" << session->index << "\"} "
+                    << session->channels.size() << "\n";
+            }
+        }
+        out << "# HELP deribit_ws_session_queued_frames Outbound frames waiting for the socket\n"
+            << "# TYPE deribit_ws_session_queued_frames gauge\n";
+        for (const auto& session : sessions_) {
+            out << "deribit_ws_session_queued_frames{session=\"" << session->index << "\"} "
+                << (session->ws ? session->ws->queued() : 0) << "\n";
+        }
+    });
+
+    server.add_collector([this](std::ostream& out) {
+        out << "# HELP deribit_stage_latency_seconds Tick-to-order stage latency\n"
+            << "# TYPE deribit_stage_latency_seconds summary\n";
+        for (size_t i = 0; i < static_cast<size_t>(LatencyStage::COUNT); ++i) {
+            auto stage = static_cast<LatencyStage>(i);
+            auto snap = latency_.histogram(stage).snapshot();
+            const char* name = LatencyTracker::stage_name(stage);
+            for (double q : {0.5, 0.9, 0.99, 0.999}) {
+                out << "deribit_stage_latency_seconds{stage=\"" << name << "\",quantile=\"" << q << "\"} "
+                    << snap.percentile(q * 100.0) / 1e9 << "\n";
+            }
+            out << "deribit_stage_latency_seconds_sum{stage=\"" << name << "\"} " << snap.sum / 1e9 << "\n"
+                << "deribit_stage_latency_seconds_count{stage=\"" << name << "\"} " << snap.total_count << "\n";
+        }
+    });
 }
 
 void DeribitTrader::init_ssl() {
     static std::once_flag init_flag;
     std::call_once(init_flag, []() {
+        // Before any thread creates an easy handle; the startup requests run concurrently
+        curl_global_init(CURL_GLOBAL_ALL);
         OpenSSL_add_all_algorithms();
         SSL_load_error_strings();
         SSL_library_init();
@@ -351,76 +950,196 @@ void DeribitTrader::init_ssl() {
     });
 }
 
-void DeribitTrader::init_websocket() {
-    init_ssl();
-    struct lws_context_creation_info info;
-    memset(&info, 0, sizeof(info));
-    
-    info.options = LWS_SERVER_OPTION_VALIDATE_UTF8 | LWS_SERVER_OPTION_DO_SSL_GLOBAL_INIT;
-    info.port = CONTEXT_PORT_NO_LISTEN;
-    info.protocols = get_protocols();
-    info.gid = -1;
-    info.uid = -1;
-    info.user = this;
-    info.ssl_cert_filepath = nullptr;
-    info.ssl_private_key_filepath = nullptr;
+// REST auth and the instrument universe load run alongside the session
+// threads' connect and auth; readiness waits for all of them. Only the
+// universe is optional, since orders can still look instruments up singly,
+// and it is not waited for at all when it was mapped from disk.
+DeribitTrader::StartupReport DeribitTrader::run_startup(StartupReport report) {
+    authenticate();
+    report.rest_auth = seconds_since_construction();
+    start_token_refresher();
 
-    lws_set_log_level(LLL_ERR | LLL_WARN, nullptr);
+    // A mapped universe is good enough to trade on; the load only refreshes it
+    if (!report.instruments_from_file) {
+        try {
+            std::tie(report.instrument_count, report.instruments) = universe_.get();
+        } catch (const std::exception& e) {
+            spdlog::warn("Instrument universe load failed, orders will look instruments up singly: {}", e.what());
+        }
+    }
 
-    ws_context_ = lws_create_context(&info);
-    if (!ws_context_) {
-        throw std::runtime_error("Failed to create WebSocket context with SSL");
+    {
+        std::unique_lock<std::mutex> lock(startup_mutex_);
+        bool ready = startup_cv_.wait_for(lock, kStartupTimeout,
+                                          [this] { return startup_cancelled_ || sessions_ready(); });
+        if (startup_cancelled_) {
+            throw std::runtime_error("Startup cancelled");
+        }
+        if (!ready) {
+            throw std::runtime_error("WebSocket sessions not authenticated within " +
+                                     std::to_string(kStartupTimeout.count()) + " s");
+        }
     }
+    report.ws_ready = seconds_since_construction();
+    report.total = report.ws_ready;
+    startup_seconds_.set(report.total);
+
+    spdlog::info("Startup complete in {:.3f} s: TLS {:.3f} s, REST auth {:.3f} s, "
+                 "{} instruments {:.3f} s{}, WebSocket auth {:.3f} s",
+                 report.total, report.tls_init, report.rest_auth, report.instrument_count,
+                 report.instruments, report.instruments_from_file ? " (mapped)" : "", report.ws_ready);
+    return report;
+}
+
+void DeribitTrader::cancel_startup() {
+    {
+        std::lock_guard<std::mutex> lock(startup_mutex_);
+        startup_cancelled_ = true;
+    }
+    startup_cv_.notify_all();
+    if (ready_.valid()) {
+        ready_.wait();
+    }
+    if (universe_.valid()) {
+        universe_.wait();
+    }
+}
+
+double DeribitTrader::seconds_since_construction() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - constructed_at_).count();
+}
+
+// Each session gets its own lws context and service thread, so a burst on
+// one session's instruments never queues behind another's
+void DeribitTrader::start_sessions() {
+    init_ssl();
+    subscribe_default_channels();
 
     try {
-        connect_websocket();
-    } catch (const std::exception& e) {
-        spdlog::error("WebSocket connection failed: {}", e.what());
+        for (auto& owned : sessions_) {
+            SessionState* session = owned.get();
+            WsSession::Callbacks callbacks;
+            callbacks.on_connect = [this, session] { on_ws_connect(*session); };
+            callbacks.on_message = [this, session](std::string_view message) {
+                LatencyTracker::ScopedTimer receive_timer(latency_, LatencyStage::WS_RECEIVE);
+                handle_ws_frame(session, message);
+            };
+            callbacks.on_disconnect = [this, session] { on_ws_disconnect(*session); };
+            callbacks.on_service = [this, session] { run_probes(*session); };
+
+            session->ws = std::make_unique<WsSession>("md-" + std::to_string(session->index),
+                                                      endpoints_.ws_host, endpoints_.ws_port,
+                                                      endpoints_.ws_path,
+                                                      std::move(callbacks));
+            session->ws->start();
+        }
+    } catch (...) {
+        for (auto& session : sessions_) {
+            session->ws.reset();
+        }
         throw;
     }
 }
 
-void DeribitTrader::connect_websocket() {
-    struct lws_client_connect_info i;
-    memset(&i, 0, sizeof(i));
-    
-    i.context = ws_context_;
-    i.port = 443;
-    i.address = "test.deribit.com";
-    i.path = "/ws/api/v2";
-    i.host = i.address;
-    i.origin = i.address;
-    i.protocol = get_protocols()[0].name;
-    i.pwsi = &ws_connection_;
-    i.userdata = this;
-    
-    i.ssl_connection = 
-        LCCSCF_USE_SSL |           
-        LCCSCF_ALLOW_SELFSIGNED |  
-        LCCSCF_SKIP_SERVER_CERT_HOSTNAME_CHECK; 
+void DeribitTrader::send_probe(SessionState& session, ProbeKind kind, const std::string& method,
+                               const json& params) {
+    uint64_t id = next_request_id_.fetch_add(1, std::memory_order_relaxed);
+    json msg = {
+        {"jsonrpc", "2.0"},
+        {"method", method},
+        {"id", id},
+        {"params", params}
+    };
+    session.pending_probes[id] = {kind, std::chrono::steady_clock::now(), wall_clock_ms()};
+    send_ws_message(session, msg.dump());
+}
 
-    spdlog::info("Attempting WebSocket connection to {}:{}{}", 
-                 i.address, i.port, i.path);
+// RTT probes every 5 s on every session and clock sync every 30 s on the
+// first; unanswered probes are dropped after 30 s so the pending map stays
+// small across outages
+void DeribitTrader::run_probes(SessionState& session) {
+    auto now = std::chrono::steady_clock::now();
+    auto& pending = session.pending_probes;
+    for (auto it = pending.begin(); it != pending.end();) {
+        it = now - it->second.sent > kProbeTimeout ? pending.erase(it) : std::next(it);
+    }
 
-    ws_connection_ = lws_client_connect_via_info(&i);
-    
-    if (!ws_connection_) {
-        char errbuf[256];
-        ERR_error_string_n(ERR_get_error(), errbuf, sizeof(errbuf));
-        
-        std::string error_msg = "Failed to establish WebSocket connection. SSL Error: " + 
-                                std::string(errbuf);
-        spdlog::error(error_msg);
-        throw std::runtime_error(error_msg);
+    if (now >= session.next_rtt_probe) {
+        send_probe(session, ProbeKind::RTT, "public/test");
+        session.next_rtt_probe = now + kRttProbeInterval;
     }
-    
-    int n = lws_service(ws_context_, 5000);
-    if (n < 0) {
-        spdlog::error("Initial WebSocket service failed with code {}", n);
-        throw std::runtime_error("WebSocket service initialization failed");
+    if (session.index == 0 && now >= session.next_time_sync) {
+        send_probe(session, ProbeKind::TIME_SYNC, "public/get_time");
+        session.next_time_sync = now + kTimeSyncInterval;
     }
 }
 
+void DeribitTrader::handle_heartbeat(SessionState& session, const message_json& notification) {
+    auto params = notification.find("params");
+    if (params == notification.end()) {
+        return;
+    }
+    auto type = params->find("type");
+    if (type != params->end() && type->is_string() &&
+        type->get_ref<const arena_string&>() == "test_request") {
+        // The server closes the session if test_request goes unanswered
+        heartbeat_requests_.increment();
+        send_probe(session, ProbeKind::SILENT, "public/test");
+    }
+}
+
+void DeribitTrader::handle_probe_response(const PendingProbe& probe, const message_json& response) {
+    auto now = std::chrono::steady_clock::now();
+    auto rtt_ns = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(now - probe.sent).count());
+
+    if (probe.kind == ProbeKind::SILENT) {
+        return;
+    }
+    ws_rtt_.record(rtt_ns);
+
+    auto result = response.find("result");
+    if (probe.kind != ProbeKind::TIME_SYNC || result == response.end() || !result->is_number()) {
+        return;
+    }
+
+    // Assume the server read its clock halfway through the round trip and
+    // trust the sample with the smallest RTT, which bounds that error best
+    double local_mid_ms = probe.sent_wall_ms + rtt_ns / 2e6;
+    time_samples_.push_back({rtt_ns, result->get<double>() - local_mid_ms});
+    if (time_samples_.size() > kTimeSamples) {
+        time_samples_.pop_front();
+    }
+    auto best = std::min_element(time_samples_.begin(), time_samples_.end(),
+        [](const TimeSample& a, const TimeSample& b) { return a.rtt_ns < b.rtt_ns; });
+    clock_offset_ms_.set(best->offset_ms);
+    clock_synced_.store(true, std::memory_order_release);
+}
+
+// Notifications carry the exchange timestamp in ms: book and ticker data
+// as an object, trades as an array whose last element is the newest
+void DeribitTrader::record_feed_latency(const message_json& data) {
+    if (!clock_synced_.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    const message_json* event = &data;
+    if (data.is_array()) {
+        if (data.empty()) return;
+        event = &data.back();
+    }
+    if (!event->is_object()) {
+        return;
+    }
+    auto timestamp = event->find("timestamp");
+    if (timestamp == event->end() || !timestamp->is_number()) {
+        return;
+    }
+
+    double latency_ms = wall_clock_ms() + clock_offset_ms_.load() - timestamp->get<double>();
+    feed_latency_.record(latency_ms > 0 ? static_cast<uint64_t>(latency_ms * 1e6) : 0);
+}
+
 void DeribitTrader::authenticate() {
     json auth_params = {
         {"grant_type", "client_credentials"},
@@ -441,28 +1160,180 @@ void DeribitTrader::authenticate() {
     }
 
     const auto& result = response["result"];
+    auto token = parse_auth_result(result);
+    std::atomic_store(&rest_token_, token);
+
+    std::cout << "Successfully authenticated." << std::endl;
+    std::cout << "Token expires in: " << result["expires_in"] << " seconds" << std::endl;
+    std::cout << "Scope: " << (result.contains("scope") ? result["scope"].get<std::string>() : "N/A") << std::endl;
+
+    if (!token->refresh_token.empty()) {
+        std::cout << "Refresh token obtained" << std::endl;
+    }
+}
 
+std::shared_ptr<const DeribitTrader::AuthToken> DeribitTrader::parse_auth_result(const json& result) {
     if (!result.contains("access_token") || 
         !result.contains("expires_in") || 
         result["access_token"].is_null()) {
         throw std::runtime_error("Invalid authentication response: missing critical fields");
     }
 
-    access_token_ = result["access_token"].get<std::string>();
+    // A zero lifetime would put the refresh deadline in the past and spin
+    // the refresher against /public/auth
+    double expires_in = result["expires_in"].is_number() ? result["expires_in"].get<double>() : 0.0;
+    if (!(expires_in > 0.0)) {
+        throw std::runtime_error("Invalid authentication response: expires_in must be positive");
+    }
 
-    double expires_in = result["expires_in"].is_number() 
-        ? result["expires_in"].get<double>() 
-        : 0.0;
+    auto token = std::make_shared<AuthToken>();
+    token->access_token = result["access_token"].get<std::string>();
+    token->auth_header = "Authorization: Bearer " + token->access_token;
+    if (result.contains("refresh_token") && result["refresh_token"].is_string()) {
+        token->refresh_token = result["refresh_token"].get<std::string>();
+    }
 
-    token_expiry_ = std::time(nullptr) + static_cast<long>(expires_in);
+    // Renew with a fifth of the lifetime left, and at least 30 s early, but
+    // short lifetimes still run half their course and never less than 1 s
+    using Duration = std::chrono::steady_clock::duration;
+    auto lifetime = std::chrono::duration_cast<Duration>(std::chrono::duration<double>(expires_in));
+    auto margin = std::max<Duration>(lifetime / 5, std::chrono::seconds(30));
+    auto floor = std::max<Duration>(lifetime / 2, std::chrono::seconds(1));
+    auto now = std::chrono::steady_clock::now();
+    token->expires_at = now + lifetime;
+    token->refresh_at = now + std::max<Duration>(lifetime - margin, floor);
+    return token;
+}
 
-    std::cout << "Successfully authenticated." << std::endl;
-    std::cout << "Token expires in: " << expires_in << " seconds" << std::endl;
-    std::cout << "Scope: " << (result.contains("scope") ? result["scope"].get<std::string>() : "N/A") << std::endl;
+void DeribitTrader::refresh_rest_token() {
+    auto current = std::atomic_load(&rest_token_);
+    if (!current || current->refresh_token.empty()) {
+        authenticate();
+        return;
+    }
 
-    if (result.contains("refresh_token")) {
-        refresh_token_ = result["refresh_token"].get<std::string>();
-        std::cout << "Refresh token obtained" << std::endl;
+    json response = send_public_request("/public/auth", {
+        {"grant_type", "refresh_token"},
+        {"refresh_token", current->refresh_token}
+    });
+
+    if (response.contains("error") || !response.contains("result")) {
+        // Refresh tokens can be revoked; start over with the client credentials
+        spdlog::warn("Token refresh rejected, re-authenticating: {}",
+                     response.contains("error") ? response["error"].dump() : response.dump());
+        authenticate();
+        return;
+    }
+
+    std::atomic_store(&rest_token_, parse_auth_result(response["result"]));
+    spdlog::info("REST access token refreshed");
+}
+
+void DeribitTrader::refresh_ws_token(SessionState& session) {
+    auto current = std::atomic_load(&session.token);
+    if (!current || !session.ws || !session.ws->connected() || session.refresh_pending.load()) {
+        return;
+    }
+
+    // The response is matched by id in handle_ws_frame and swaps the token
+    uint64_t id = next_request_id_.fetch_add(1, std::memory_order_relaxed);
+    session.auth_request_id.store(id);
+    session.refresh_pending.store(true);
+
+    json auth_msg = {
+        {"jsonrpc", "2.0"},
+        {"method", "public/auth"},
+        {"id", id},
+        {"params", current->refresh_token.empty()
+            ? json{{"grant_type", "client_credentials"}, {"client_id", api_key_}, {"client_secret", api_secret_}}
+            : json{{"grant_type", "refresh_token"}, {"refresh_token", current->refresh_token}}}
+    };
+    send_ws_message(session, auth_msg.dump());
+}
+
+void DeribitTrader::start_token_refresher() {
+    {
+        std::lock_guard<std::mutex> lock(refresh_mutex_);
+        stop_refresher_ = false;
+    }
+    token_refresher_ = std::thread(&DeribitTrader::run_token_refresher, this);
+}
+
+void DeribitTrader::stop_token_refresher() {
+    {
+        std::lock_guard<std::mutex> lock(refresh_mutex_);
+        stop_refresher_ = true;
+    }
+    refresh_cv_.notify_all();
+    if (token_refresher_.joinable()) {
+        token_refresher_.join();
+    }
+}
+
+// Wakes the refresher to re-check deadlines; an expired token is always past
+// its refresh time, so it gets renewed on the next pass
+void DeribitTrader::request_token_refresh() {
+    {
+        std::lock_guard<std::mutex> lock(refresh_mutex_);
+        refresh_requested_ = true;
+    }
+    refresh_cv_.notify_all();
+}
+
+// Renews the REST and every WebSocket session ahead of expiry so the order path only ever reads
+// the current token. Failures retry with exponential backoff up to 30 s.
+void DeribitTrader::run_token_refresher() {
+    using Clock = std::chrono::steady_clock;
+    auto retry_delay = std::chrono::seconds(1);
+    Clock::time_point retry_at = Clock::time_point::max();
+
+    std::unique_lock<std::mutex> lock(refresh_mutex_);
+    while (!stop_refresher_) {
+        Clock::time_point deadline = retry_at;
+        if (auto rest = std::atomic_load(&rest_token_)) {
+            deadline = std::min(deadline, rest->refresh_at);
+        }
+        for (const auto& session : sessions_) {
+            if (auto ws = std::atomic_load(&session->token)) {
+                deadline = std::min(deadline, session->refresh_pending.load()
+                    ? Clock::now() + std::chrono::seconds(10)
+                    : ws->refresh_at);
+            }
+        }
+
+        refresh_cv_.wait_until(lock, deadline, [this] { return stop_refresher_ || refresh_requested_; });
+        if (stop_refresher_) break;
+
+        refresh_requested_ = false;
+        lock.unlock();
+
+        auto now = Clock::now();
+        try {
+            auto rest = std::atomic_load(&rest_token_);
+            if (!rest || now >= rest->refresh_at) {
+                refresh_rest_token();
+                token_refreshes_.increment();
+            }
+            for (auto& session : sessions_) {
+                auto ws = std::atomic_load(&session->token);
+                if (ws && session->refresh_pending.load() && now >= ws->expires_at) {
+                    // No answer before expiry; allow another attempt
+                    session->refresh_pending.store(false);
+                }
+                if (ws && now >= ws->refresh_at) {
+                    refresh_ws_token(*session);
+                }
+            }
+            retry_delay = std::chrono::seconds(1);
+            retry_at = Clock::time_point::max();
+        } catch (const std::exception& e) {
+            auth_failures_.increment();
+            spdlog::error("Token refresh failed, retrying in {}s: {}", retry_delay.count(), e.what());
+            retry_at = Clock::now() + retry_delay;
+            retry_delay = std::min(retry_delay * 2, std::chrono::seconds(30));
+        }
+
+        lock.lock();
     }
 }
 
@@ -471,7 +1342,7 @@ json DeribitTrader::send_public_request(const std::string& endpoint, const json&
     std::string response_string;
 
     if (curl) {
-        std::string url = base_url_ + endpoint;
+        std::string url = endpoints_.rest_url + endpoint;
         
         json rpc_payload = {
             {"jsonrpc", "2.0"},
@@ -510,77 +1381,75 @@ json DeribitTrader::send_public_request(const std::string& endpoint, const json&
 }
 
 json DeribitTrader::send_authenticated_request(const std::string& endpoint, const json& params) {
-    if (std::time(nullptr) >= token_expiry_) {
-        authenticate();
-    }
-
-    CURL* curl = curl_easy_init();
-    std::string response_string;
-
-    if (curl) {
-        struct curl_slist* headers = nullptr;
-        headers = curl_slist_append(headers, ("Authorization: Bearer " + access_token_).c_str());
-        headers = curl_slist_append(headers, "Content-Type: application/json");
-
-        std::string url = base_url_ + endpoint;
-        std::string post_data = params.dump();
-
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl, CURLOPT_POST, 1L);
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, post_data.c_str());
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_string);
+    return send_authenticated_payload(endpoint, params.dump());
+}
 
-        CURLcode res = curl_easy_perform(curl);
-        
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
+json DeribitTrader::send_authenticated_payload(std::string_view endpoint, std::string_view post_data) {
+    // Never authenticate inline; the refresher keeps the token current
+    auto token = std::atomic_load(&rest_token_);
+    if (!token) {
+        throw std::runtime_error("Not authenticated");
+    }
+    if (std::chrono::steady_clock::now() >= token->expires_at) {
+        spdlog::warn("Sending with an expired access token; refresh requested");
+        request_token_refresh();
+    }
 
-        if (res != CURLE_OK) {
-            throw std::runtime_error("Failed to send request: " + std::string(curl_easy_strerror(res)));
+    // One request at a time on the order session; the handle keeps its
+    // connection (and TLS session) alive between calls
+    std::lock_guard<std::mutex> lock(order_http_mutex_);
+    if (!order_curl_) {
+        order_curl_ = curl_easy_init();
+        if (!order_curl_) {
+            throw std::runtime_error("Failed to initialize CURL");
         }
-
-        return json::parse(response_string);
+        curl_easy_setopt(order_curl_, CURLOPT_TCP_NODELAY, 1L);
+        curl_easy_setopt(order_curl_, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(order_curl_, CURLOPT_POST, 1L);
+        curl_easy_setopt(order_curl_, CURLOPT_WRITEFUNCTION, write_callback);
     }
 
-    throw std::runtime_error("Failed to initialize CURL");
-}
+    CURL* curl = order_curl_;
+    std::string response_string;
+    struct curl_slist* headers = nullptr;
+    headers = curl_slist_append(headers, token->auth_header.c_str());
+    headers = curl_slist_append(headers, "Content-Type: application/json");
 
-int DeribitTrader::ws_callback(struct lws* wsi, enum lws_callback_reasons reason,
-                      void* user, void* in, size_t len) {
-    if (!wsi) return -1;
-    DeribitTrader* instance = static_cast<DeribitTrader*>(
-        lws_context_user(lws_get_context(wsi)));
-    if (!instance) return -1;
+    std::string url = endpoints_.rest_url;
+    url.append(endpoint);
 
-    switch (reason) {
-        case LWS_CALLBACK_CLIENT_ESTABLISHED:
-            instance->on_ws_connect();
-            break;
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, static_cast<long>(post_data.size()));
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, post_data.data());
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_string);
 
-        case LWS_CALLBACK_CLIENT_RECEIVE:
-            instance->on_ws_message(std::string(static_cast<char*>(in), len));
-            break;
+    auto send_start = LatencyTracker::now();
+    CURLcode res = curl_easy_perform(curl);
+    latency_.record(LatencyStage::SEND, send_start, LatencyTracker::now());
 
-        case LWS_CALLBACK_CLIENT_CLOSED:
-            instance->on_ws_close();
-            break;
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, nullptr);
+    curl_slist_free_all(headers);
 
-        default:
-            break;
+    if (res != CURLE_OK) {
+        throw std::runtime_error("Failed to send request: " + std::string(curl_easy_strerror(res)));
     }
 
-    return 0;
+    LatencyTracker::ScopedTimer ack_timer(latency_, LatencyStage::ACK);
+    return json::parse(response_string);
 }
 
-void DeribitTrader::on_ws_connect() {
-    spdlog::info("WebSocket connected");
+void DeribitTrader::on_ws_connect(SessionState& session) {
+    session.pending_probes.clear();
+    session.next_rtt_probe = session.next_time_sync = std::chrono::steady_clock::now();
+
+    uint64_t id = next_request_id_.fetch_add(1, std::memory_order_relaxed);
+    session.auth_request_id.store(id);
     
     json auth_msg = {
         {"jsonrpc", "2.0"},
         {"method", "public/auth"},
-        {"id", 1},
+        {"id", id},
         {"params", {
             {"grant_type", "client_credentials"},
             {"client_id", api_key_},
@@ -588,34 +1457,85 @@ void DeribitTrader::on_ws_connect() {
         }}
     };
     
-    send_ws_message(auth_msg.dump());
+    send_ws_message(session, auth_msg.dump());
+}
+
+void DeribitTrader::on_ws_message(std::string_view message) {
+    handle_ws_frame(nullptr, message);
 }
 
-void DeribitTrader::on_ws_message(const std::string& message) {
+// session is null for frames injected through on_ws_message, which skip
+// the per-session heartbeat, probe and auth handling
+void DeribitTrader::handle_ws_frame(SessionState* session, std::string_view message) {
     try {
         if (message.empty()) {
             spdlog::warn("Received empty WebSocket message");
             return;
         }
 
-        json j;
+        ws_messages_.increment();
+
+        // Everything parsed for this frame lives in the thread's arena and
+        // is released in one step when the scope closes
+        MessageArena::Scope arena_scope;
+        const message_json* parsed = nullptr;
         try {
-            j = json::parse(message);
-        } catch (const json::parse_error& e) {
+            LatencyTracker::ScopedTimer parse_timer(latency_, LatencyStage::WS_PARSE);
+            parsed = &parse_message(message);
+        } catch (const message_json::parse_error& e) {
+            parse_errors_.increment();
             spdlog::error("JSON parsing error: {}", e.what());
             spdlog::error("Problematic message: {}", message);
             return;
         }
-        
-        log_message_structure(j);
+        const message_json& notification = *parsed;
+
+        // Market data notifications skip the structure logging below
+        auto method = notification.find("method");
+        if (method != notification.end() && method->is_string() &&
+            method->get_ref<const arena_string&>() == "subscription") {
+            handle_subscription(notification);
+            return;
+        }
+
+        if (method != notification.end() && method->is_string() &&
+            method->get_ref<const arena_string&>() == "heartbeat") {
+            if (session) {
+                handle_heartbeat(*session, notification);
+            }
+            return;
+        }
+
+        // Probe responses are consumed here instead of being logged
+        auto id = notification.find("id");
+        if (session && id != notification.end() && id->is_number_unsigned()) {
+            auto probe = session->pending_probes.find(id->get<uint64_t>());
+            if (probe != session->pending_probes.end()) {
+                handle_probe_response(probe->second, notification);
+                session->pending_probes.erase(probe);
+                return;
+            }
+        }
+
+        // RPC responses are rare; handle them as regular heap-backed json
+        json j = json::parse(message);
+        if (session && j.contains("id") && j["id"].is_number_unsigned() &&
+            j["id"].get<uint64_t>() == session->auth_request_id.load()) {
+            handle_ws_authentication(*session, j);
+            return;
+        }
 
         if (j.contains("method")) {
-            std::string method = j["method"].get<std::string>();
+            std::string method_name = j["method"].get<std::string>();
+
+            log_message_structure(j);
             
-            if (method == "public/auth") {
-                handle_ws_authentication(j);
+            if (session && method_name == "public/auth") {
+                handle_ws_authentication(*session, j);
                 return;
             }
+        } else {
+            log_message_structure(j);
         }
         
         if (j.contains("result")) {
@@ -631,6 +1551,183 @@ void DeribitTrader::on_ws_message(const std::string& message) {
     }
 }
 
+void DeribitTrader::handle_subscription(const message_json& notification) {
+    auto params = notification.find("params");
+    if (params == notification.end()) {
+        return;
+    }
+
+    auto channel = params->find("channel");
+    auto data = params->find("data");
+    if (channel == params->end() || data == params->end() || !channel->is_string()) {
+        return;
+    }
+
+    const auto& channel_name = channel->get_ref<const arena_string&>();
+    std::string_view channel_view(channel_name.data(), channel_name.size());
+    record_feed_latency(*data);
+    LatencyTracker::ScopedTimer book_timer(latency_, LatencyStage::BOOK_UPDATE);
+    bool book_routed = channel_view.compare(0, 5, "book.") == 0 && update_book(channel_view, *data);
+    bool trade_routed = !book_routed && channel_view.compare(0, 7, "trades.") == 0 &&
+                        record_trade(channel_view, *data);
+    bool ticker_routed = channel_view.compare(0, 7, "ticker.") == 0 && route_ticker(channel_view, *data);
+
+    auto routes = std::atomic_load(&message_handlers_);
+    auto route = routes->find(channel_view);
+    if (route == routes->end() || !route->second->handler) {
+        if (!book_routed && !trade_routed && !ticker_routed) {
+            unrouted_notifications_.increment();
+        }
+        return;
+    }
+
+    route->second->messages.increment();
+    route->second->handler(*data);
+}
+
+// Applies a book.{instrument}.{interval} notification to the local book.
+// Returns false when the instrument has no tracked book.
+bool DeribitTrader::update_book(std::string_view channel, const message_json& data) {
+    auto end = channel.find('.', 5);
+    auto instrument = channel.substr(5, end == std::string_view::npos ? end : end - 5);
+
+    SessionState& session = *sessions_[shard_for_instrument(instrument)];
+    std::lock_guard<std::mutex> lock(session.books_mutex);
+    auto it = session.books.find(instrument);
+    if (it == session.books.end() || it->second.channel != channel) {
+        return false;
+    }
+
+    BookState& state = it->second;
+    OrderBook::Update update;
+    try {
+        update = state.book.apply(data);
+    } catch (const std::exception&) {
+        // A half-applied change leaves the book unusable
+        request_book_resync(instrument, state);
+        throw;
+    }
+
+    if (update == OrderBook::Update::SNAPSHOT || update == OrderBook::Update::APPLIED) {
+        int64_t timestamp_ms = data.value("timestamp", int64_t{0});
+        market_board_.update_book(instrument, state.book.best_bid(), state.book.best_ask(),
+                                  state.book.change_id(), timestamp_ms);
+        state.features.on_book(state.book, timestamp_ms);
+        market_board_.update_features(instrument, state.features.values());
+    }
+
+    switch (update) {
+        case OrderBook::Update::SNAPSHOT:
+            if (state.resyncing) {
+                state.resyncing = false;
+                books_resyncing_.fetch_sub(1);
+                check_recovered();
+            }
+            break;
+        case OrderBook::Update::GAP:
+            book_gaps_.increment();
+            spdlog::warn("Sequence gap on {}: expected prev_change_id {}, got {}; resyncing",
+                         state.channel, state.book.change_id(), data.value("prev_change_id", int64_t{0}));
+            request_book_resync(instrument, state);
+            break;
+        default:
+            break;
+    }
+    return true;
+}
+
+// trades.{instrument}.{interval}; a notification batches trades oldest first
+bool DeribitTrader::record_trade(std::string_view channel, const message_json& data) {
+    if (!data.is_array() || data.empty()) {
+        return false;
+    }
+    auto end = channel.find('.', 7);
+    auto instrument = channel.substr(7, end == std::string_view::npos ? end : end - 7);
+
+    // Every trade in the batch counts toward the signed volume and goes on
+    // the tape; malformed entries are skipped. The session's lock guards the
+    // features against track_book; this thread is the tape's only writer.
+    TradeTape::Trade trade{};
+    size_t malformed = 0;
+    TradeTape* tape = nullptr;
+    {
+        SessionState& session = *sessions_[shard_for_instrument(instrument)];
+        std::lock_guard<std::mutex> lock(session.books_mutex);
+        auto tape_it = session.tapes.find(instrument);
+        tape = tape_it == session.tapes.end() ? nullptr : tape_it->second.get();
+        auto it = session.books.find(instrument);
+        BookFeatures* features = it == session.books.end() ? nullptr : &it->second.features;
+        for (const auto& each : data) {
+            if (!parse_trade(each, trade)) {
+                ++malformed;
+            } else if (features) {
+                features->on_trade(trade.buy, trade.amount, trade.timestamp_ms);
+            }
+        }
+        if (features) {
+            market_board_.update_features(instrument, features->values());
+        }
+    }
+    if (malformed > 0) {
+        spdlog::warn("Skipped {} malformed trades on {}", malformed, channel);
+    }
+    if (malformed == data.size()) {
+        return true;
+    }
+    // The last well-formed trade is still in trade
+    market_board_.update_trade(instrument, trade.price, trade.amount, trade.timestamp_ms);
+
+    if (!tape) {
+        return true;
+    }
+    for (const auto& each : data) {
+        if (parse_trade(each, trade)) {
+            tape->on_trade(trade);
+        }
+    }
+    tape->publish();
+    return true;
+}
+
+const TradeTape* DeribitTrader::trade_tape(std::string_view instrument) const {
+    const SessionState& session = *sessions_[shard_for_instrument(instrument)];
+    std::lock_guard<std::mutex> lock(session.books_mutex);
+    auto it = session.tapes.find(instrument);
+    return it == session.tapes.end() ? nullptr : it->second.get();
+}
+
+// ticker.{instrument}.{interval}; handed on whole, the handler picks the fields
+bool DeribitTrader::route_ticker(std::string_view channel, const message_json& data) {
+    if (!ticker_handler_ || !data.is_object()) {
+        return false;
+    }
+    auto end = channel.find('.', 7);
+    ticker_handler_(channel.substr(7, end == std::string_view::npos ? end : end - 7), data);
+    return true;
+}
+
+std::vector<InstrumentCache::Entry> DeribitTrader::list_instruments(InstrumentKind kind, std::string_view prefix) {
+    std::vector<InstrumentCache::Entry> result;
+    auto matches = [&](std::string_view name, const InstrumentSpec& spec) {
+        return spec.kind == kind && name.compare(0, prefix.size(), prefix) == 0;
+    };
+    auto file = std::atomic_load(&instrument_file_);
+    if (file) {
+        for (size_t i = 0; i < file->size(); ++i) {
+            if (matches(file->name(i), file->spec(i))) {
+                result.emplace_back(std::string(file->name(i)), file->spec(i));
+            }
+        }
+    }
+    std::lock_guard<std::mutex> lock(instruments_mutex_);
+    for (const auto& [name, spec] : instruments_) {
+        if (matches(name, spec) && !(file && file->find(name))) {
+            result.emplace_back(name, spec);
+        }
+    }
+    return result;
+}
+
 void DeribitTrader::log_message_structure(const json& message) {
     std::cout << "Message Keys: ";
     for (const auto& [key, value] : message.items()) {
@@ -654,7 +1751,8 @@ void DeribitTrader::log_message_structure(const json& message) {
     }
 }
 
-void DeribitTrader::handle_ws_authentication(const json& auth_response) {
+void DeribitTrader::handle_ws_authentication(SessionState& session, const json& auth_response) {
+    session.refresh_pending.store(false);
     try {
         if (!auth_response.contains("result") || auth_response["result"].is_null()) {
             spdlog::error("WebSocket authentication failed: No result or result is null");
@@ -670,9 +1768,24 @@ void DeribitTrader::handle_ws_authentication(const json& auth_response) {
             return;
         }
 
-        ws_access_token_ = result["access_token"].get<std::string>();
-        spdlog::info("WebSocket authentication successful");
-        subscribe_default_channels();
+        // Re-authentication keeps the session and its subscriptions
+        bool first = !std::atomic_load(&session.token);
+        std::atomic_store(&session.token, parse_auth_result(result));
+        if (!first) {
+            spdlog::info("[{}] WebSocket access token refreshed", session.ws->name());
+            return;
+        }
+
+        spdlog::info("[{}] WebSocket authentication successful", session.ws->name());
+        {
+            std::lock_guard<std::mutex> lock(startup_mutex_);
+        }
+        startup_cv_.notify_all();
+        session.ws->reset_backoff();
+        send_probe(session, ProbeKind::SILENT, "public/set_heartbeat", {{"interval", kHeartbeatIntervalSeconds}});
+        request_token_refresh();
+        resubscribe_all(session);
+        check_recovered();
     } catch (const std::exception& e) {
         spdlog::error("Error processing WebSocket authentication: {}", e.what());
     }
@@ -728,26 +1841,28 @@ void DeribitTrader::handle_ws_error(const json& error_response) {
     }
 }
 
+// Only tracks the defaults, before any session connects; resubscribe_all
+// sends them with the rest
 void DeribitTrader::subscribe_default_channels() {
-    try {
-        subscribe_orderbook("BTC-PERPETUAL");
-        subscribe_trades("BTC-PERPETUAL");
-    } catch (const std::exception& e) {
-        spdlog::error("Error subscribing to default channels: {}", e.what());
-    }
+    track_book("BTC-PERPETUAL", "book.BTC-PERPETUAL.100ms", false);
+    track_channel("book.BTC-PERPETUAL.100ms");
+    track_channel("trades.BTC-PERPETUAL.100ms");
 }
 
-void DeribitTrader::on_ws_close() {
-    spdlog::info("WebSocket connection closed");
+// The session reconnects on its own; its token dies with the connection
+// and its books wait for fresh snapshots
+void DeribitTrader::on_ws_disconnect(SessionState& session) {
+    std::atomic_store(&session.token, std::shared_ptr<const AuthToken>());
+    session.refresh_pending.store(false);
+    mark_stale(session);
 }
 
-void DeribitTrader::send_ws_message(const std::string& message) {
-    if (!ws_connection_) return;
-
-    std::vector<uint8_t> buf(LWS_PRE + message.length());
-    memcpy(buf.data() + LWS_PRE, message.c_str(), message.length());
-
-    lws_write(ws_connection_, buf.data() + LWS_PRE, message.length(), LWS_WRITE_TEXT);
+// Frames sent while the session is disconnected are dropped; auth and
+// subscriptions are replayed on the next connect
+void DeribitTrader::send_ws_message(SessionState& session, std::string message) {
+    if (session.ws) {
+        session.ws->send(std::move(message));
+    }
 }
 
 size_t DeribitTrader::write_callback(void* contents, size_t size, size_t nmemb, void* userp) {
@@ -756,13 +1871,16 @@ size_t DeribitTrader::write_callback(void* contents, size_t size, size_t nmemb,
 }
 
 void DeribitTrader::cleanup() {
-    if (ws_connection_) {
-        lws_callback_on_writable(ws_connection_);
-        lws_cancel_service(ws_context_);
+    // The startup task may still start the refresher, so it goes first
+    cancel_startup();
+    stop_token_refresher();
+    for (auto& session : sessions_) {
+        session->ws.reset();
     }
-    
-    if (ws_context_) {
-        lws_context_destroy(ws_context_);
-        ws_context_ = nullptr;
+
+    std::lock_guard<std::mutex> lock(order_http_mutex_);
+    if (order_curl_) {
+        curl_easy_cleanup(order_curl_);
+        order_curl_ = nullptr;
     }
 }
\ No newline at end of file
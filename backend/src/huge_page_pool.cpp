@@ -0,0 +1,141 @@
+#include "huge_page_pool.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <spdlog/spdlog.h>
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+
+namespace {
+
+constexpr size_t kPageSize = 4096;
+
+size_t round_up(size_t value, size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+int current_numa_node() {
+    unsigned cpu = 0;
+    unsigned node = 0;
+#ifdef SYS_getcpu
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+        return static_cast<int>(node);
+    }
+#endif
+    return -1;
+}
+
+// Over-maps by one huge page and trims both ends so the region starts on a
+// 2 MB boundary, which transparent huge pages need
+char* map_aligned(size_t size) {
+    size_t padded = size + HugePageResource::kHugePageSize;
+    void* raw = mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+        return nullptr;
+    }
+    auto start = reinterpret_cast<uintptr_t>(raw);
+    auto aligned = round_up(start, HugePageResource::kHugePageSize);
+    if (aligned > start) {
+        munmap(raw, aligned - start);
+    }
+    size_t tail = (start + padded) - (aligned + size);
+    if (tail > 0) {
+        munmap(reinterpret_cast<void*>(aligned + size), tail);
+    }
+    return reinterpret_cast<char*>(aligned);
+}
+
+}  // namespace
+
+HugePageResource::HugePageResource(size_t region_size, bool try_huge_pages)
+    : region_size_(round_up(region_size, kHugePageSize)), try_huge_pages_(try_huge_pages) {}
+
+HugePageResource::~HugePageResource() {
+    for (const auto& region : regions_) {
+        munmap(region.data, region.size);
+    }
+}
+
+const char* HugePageResource::backing_name(Backing backing) {
+    switch (backing) {
+        case Backing::HUGETLB: return "hugetlb";
+        case Backing::TRANSPARENT: return "transparent";
+        case Backing::NORMAL: return "normal";
+        default: return "none";
+    }
+}
+
+void* HugePageResource::do_allocate(size_t bytes, size_t alignment) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!regions_.empty()) {
+        const Region& region = regions_.back();
+        size_t start = round_up(offset_, alignment);
+        if (start + bytes <= region.size) {
+            offset_ = start + bytes;
+            return region.data + start;
+        }
+    }
+    // Regions start 2 MB-aligned, so any alignment up to that fits at 0
+    map_region(bytes);
+    offset_ = bytes;
+    return regions_.back().data;
+}
+
+void HugePageResource::map_region(size_t min_bytes) {
+    size_t size = round_up(std::max(min_bytes, region_size_), kHugePageSize);
+    char* data = nullptr;
+    Backing backing = Backing::NORMAL;
+
+#ifdef MAP_HUGETLB
+    if (try_huge_pages_) {
+        void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_2MB, -1, 0);
+        if (p != MAP_FAILED) {
+            data = static_cast<char*>(p);
+            backing = Backing::HUGETLB;
+        }
+    }
+#endif
+    if (!data) {
+        data = map_aligned(size);
+        if (!data) {
+            throw std::bad_alloc();
+        }
+#ifdef MADV_HUGEPAGE
+        if (try_huge_pages_ && madvise(data, size, MADV_HUGEPAGE) == 0) {
+            backing = Backing::TRANSPARENT;
+        }
+#endif
+    }
+
+    // First touch from the allocating thread places the pages on its node
+    // and keeps page faults off the hot path later
+    for (size_t offset = 0; offset < size; offset += kPageSize) {
+        data[offset] = 0;
+    }
+
+    regions_.push_back({data, size});
+    backing_.store(backing);
+    mapped_bytes_.fetch_add(size);
+    spdlog::info("Mapped {} KB of {} pages on NUMA node {}", size / 1024, backing_name(backing),
+                 current_numa_node());
+}
+
+HugePagePool::HugePagePool(Sharing sharing, size_t region_size, bool try_huge_pages)
+    : pages_(region_size, try_huge_pages) {
+    if (sharing == Sharing::SHARED) {
+        pool_ = std::make_unique<std::pmr::synchronized_pool_resource>(&pages_);
+    } else {
+        pool_ = std::make_unique<std::pmr::unsynchronized_pool_resource>(&pages_);
+    }
+}
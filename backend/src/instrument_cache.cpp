@@ -0,0 +1,171 @@
+#include "instrument_cache.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unistd.h>
+
+struct InstrumentCache::Record {
+    char name[kNameSize];
+    InstrumentSpec spec;
+};
+
+namespace {
+
+constexpr char kMagic[8] = {'D', 'R', 'B', 'I', 'N', 'S', 'T', 'R'};
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t count;
+    int64_t fetched_at_ms;
+    uint64_t checksum;  // FNV-1a over the records
+};
+
+static_assert(std::is_trivially_copyable_v<InstrumentSpec>, "InstrumentSpec is written to disk as is");
+
+uint64_t fnv1a(const void* data, size_t size) {
+    auto bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = 1469598103934665603ULL;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+void write_all(int fd, const void* data, size_t size, const std::string& path) {
+    auto bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t written = ::write(fd, bytes, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("Failed to write " + path + ": " + strerror(errno));
+        }
+        bytes += written;
+        size -= static_cast<size_t>(written);
+    }
+}
+
+}  // namespace
+
+std::shared_ptr<const InstrumentCache> InstrumentCache::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+        close(fd);
+        return nullptr;
+    }
+    size_t length = static_cast<size_t>(st.st_size);
+    void* mapping = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return nullptr;
+    }
+
+    const auto* header = static_cast<const Header*>(mapping);
+    const auto* records = reinterpret_cast<const Record*>(static_cast<const char*>(mapping) + sizeof(Header));
+    bool valid = std::memcmp(header->magic, kMagic, sizeof(kMagic)) == 0 &&
+                 header->version == kVersion &&
+                 header->record_size == sizeof(Record) &&
+                 header->count == (length - sizeof(Header)) / sizeof(Record) &&
+                 length == sizeof(Header) + header->count * sizeof(Record) &&
+                 header->checksum == fnv1a(records, header->count * sizeof(Record));
+    if (!valid) {
+        munmap(mapping, length);
+        return nullptr;
+    }
+    return std::shared_ptr<const InstrumentCache>(
+        new InstrumentCache(mapping, length, records, header->count, header->fetched_at_ms));
+}
+
+size_t InstrumentCache::write(const std::string& path, std::vector<Entry> instruments, int64_t fetched_at_ms) {
+    std::sort(instruments.begin(), instruments.end(),
+              [](const Entry& a, const Entry& b) { return a.first < b.first; });
+    instruments.erase(std::unique(instruments.begin(), instruments.end(),
+                                  [](const Entry& a, const Entry& b) { return a.first == b.first; }),
+                      instruments.end());
+
+    instruments.erase(std::remove_if(instruments.begin(), instruments.end(),
+                                     [](const Entry& entry) { return entry.first.size() >= kNameSize; }),
+                      instruments.end());
+
+    // Zero-filled in place so padding bytes, and with them the checksum, are stable
+    std::vector<Record> records(instruments.size());
+    std::memset(static_cast<void*>(records.data()), 0, records.size() * sizeof(Record));
+    for (size_t i = 0; i < instruments.size(); ++i) {
+        std::memcpy(records[i].name, instruments[i].first.data(), instruments[i].first.size());
+        records[i].spec = instruments[i].second;
+    }
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.record_size = sizeof(Record);
+    header.count = records.size();
+    header.fetched_at_ms = fetched_at_ms;
+    header.checksum = fnv1a(records.data(), records.size() * sizeof(Record));
+
+    std::string tmp_path = path + ".tmp";
+    int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to create " + tmp_path + ": " + strerror(errno));
+    }
+    try {
+        write_all(fd, &header, sizeof(header), tmp_path);
+        write_all(fd, records.data(), records.size() * sizeof(Record), tmp_path);
+        if (fsync(fd) != 0) {
+            throw std::runtime_error("Failed to sync " + tmp_path + ": " + strerror(errno));
+        }
+    } catch (...) {
+        close(fd);
+        unlink(tmp_path.c_str());
+        throw;
+    }
+    close(fd);
+
+    if (rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::string error = strerror(errno);
+        unlink(tmp_path.c_str());
+        throw std::runtime_error("Failed to replace " + path + ": " + error);
+    }
+    return records.size();
+}
+
+InstrumentCache::InstrumentCache(void* mapping, size_t length, const Record* records, size_t count,
+                                 int64_t fetched_at_ms)
+    : mapping_(mapping), length_(length), records_(records), count_(count), fetched_at_ms_(fetched_at_ms) {}
+
+InstrumentCache::~InstrumentCache() {
+    munmap(mapping_, length_);
+}
+
+std::optional<InstrumentSpec> InstrumentCache::find(std::string_view name) const {
+    if (name.size() >= kNameSize) {
+        return std::nullopt;
+    }
+    const Record* end = records_ + count_;
+    const Record* it = std::lower_bound(records_, end, name, [](const Record& record, std::string_view key) {
+        return std::string_view(record.name) < key;
+    });
+    if (it == end || std::string_view(it->name) != name) {
+        return std::nullopt;
+    }
+    return it->spec;
+}
+
+std::string_view InstrumentCache::name(size_t index) const {
+    return records_[index].name;
+}
+
+const InstrumentSpec& InstrumentCache::spec(size_t index) const {
+    return records_[index].spec;
+}
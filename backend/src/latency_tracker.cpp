@@ -0,0 +1,213 @@
+#include "latency_tracker.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include <spdlog/spdlog.h>
+
+uint64_t HistogramSnapshot::percentile(double p) const {
+    if (total_count == 0) return 0;
+
+    double clamped = std::min(std::max(p, 0.0), 100.0);
+    uint64_t target = static_cast<uint64_t>(std::ceil(clamped / 100.0 * total_count));
+    target = std::max<uint64_t>(target, 1);
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        seen += counts[i];
+        if (seen >= target) {
+            return std::min(LatencyHistogram::bucket_upper_bound(i), max);
+        }
+    }
+    return max;
+}
+
+HistogramSnapshot HistogramSnapshot::since(const HistogramSnapshot& earlier) const {
+    HistogramSnapshot delta;
+    delta.counts.resize(counts.size(), 0);
+    for (size_t i = 0; i < counts.size(); ++i) {
+        uint64_t before = i < earlier.counts.size() ? earlier.counts[i] : 0;
+        delta.counts[i] = counts[i] - std::min(counts[i], before);
+        if (delta.counts[i] > 0) {
+            delta.max = LatencyHistogram::bucket_upper_bound(i);
+        }
+    }
+    delta.total_count = total_count - std::min(total_count, earlier.total_count);
+    delta.sum = sum - std::min(sum, earlier.sum);
+    // The overall max is exact; the interval max is only bucket-accurate
+    delta.max = std::min(delta.max, max);
+    return delta;
+}
+
+LatencyHistogram::LatencyHistogram() {
+    for (auto& count : counts_) {
+        count.store(0, std::memory_order_relaxed);
+    }
+}
+
+size_t LatencyHistogram::bucket_index(uint64_t value) {
+    if (value < kSubBucketCount) {
+        return static_cast<size_t>(value);
+    }
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - (kSubBucketBits - 1);
+    size_t sub_bucket = static_cast<size_t>(value >> shift) - kHalfSubBucketCount;
+    return kSubBucketCount + static_cast<size_t>(shift - 1) * kHalfSubBucketCount + sub_bucket;
+}
+
+uint64_t LatencyHistogram::bucket_upper_bound(size_t index) {
+    if (index < kSubBucketCount) {
+        return index;
+    }
+    size_t offset = index - kSubBucketCount;
+    int shift = static_cast<int>(offset / kHalfSubBucketCount) + 1;
+    uint64_t sub_bucket = offset % kHalfSubBucketCount + kHalfSubBucketCount;
+    return (sub_bucket << shift) + ((uint64_t{1} << shift) - 1);
+}
+
+void LatencyHistogram::record(uint64_t value) {
+    counts_[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+    total_count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t current_max = max_.load(std::memory_order_relaxed);
+    while (value > current_max &&
+           !max_.compare_exchange_weak(current_max, value, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::reset() {
+    for (auto& count : counts_) {
+        count.store(0, std::memory_order_relaxed);
+    }
+    total_count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+HistogramSnapshot LatencyHistogram::snapshot() const {
+    HistogramSnapshot snap;
+    snap.counts.resize(kBucketCount);
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        snap.counts[i] = counts_[i].load(std::memory_order_relaxed);
+        snap.total_count += snap.counts[i];
+    }
+    snap.sum = sum_.load(std::memory_order_relaxed);
+    snap.max = max_.load(std::memory_order_relaxed);
+    return snap;
+}
+
+LatencyTracker::~LatencyTracker() {
+    stop_reporting();
+}
+
+const char* LatencyTracker::stage_name(LatencyStage stage) {
+    switch (stage) {
+        case LatencyStage::WS_RECEIVE: return "ws_receive";
+        case LatencyStage::WS_PARSE: return "ws_parse";
+        case LatencyStage::BOOK_UPDATE: return "book_update";
+        case LatencyStage::TICK_QUEUE: return "tick_queue";
+        case LatencyStage::PRICE_UPDATE: return "price_update";
+        case LatencyStage::SIGNAL: return "signal";
+        case LatencyStage::RISK_CHECK: return "risk_check";
+        case LatencyStage::ORDER_VALIDATE: return "order_validate";
+        case LatencyStage::SERIALIZE: return "serialize";
+        case LatencyStage::SEND: return "send";
+        case LatencyStage::ACK: return "ack";
+        case LatencyStage::TICK_TO_ORDER: return "tick_to_order";
+        case LatencyStage::COUNT: break;
+    }
+    return "unknown";
+}
+
+void LatencyTracker::record(LatencyStage stage, Clock::time_point start, Clock::time_point end) {
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    record(stage, static_cast<uint64_t>(std::max<int64_t>(elapsed, 0)));
+}
+
+void LatencyTracker::record(LatencyStage stage, uint64_t nanoseconds) {
+    histograms_[static_cast<size_t>(stage)].record(nanoseconds);
+}
+
+const LatencyHistogram& LatencyTracker::histogram(LatencyStage stage) const {
+    return histograms_[static_cast<size_t>(stage)];
+}
+
+std::string LatencyTracker::report() const {
+    std::array<HistogramSnapshot, kStageCount> snapshots;
+    for (size_t i = 0; i < kStageCount; ++i) {
+        snapshots[i] = histograms_[i].snapshot();
+    }
+    return format_report(snapshots);
+}
+
+std::string LatencyTracker::format_report(
+    const std::array<HistogramSnapshot, kStageCount>& snapshots) const {
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    ss << std::left << std::setw(16) << "stage"
+       << std::right << std::setw(10) << "count"
+       << std::setw(12) << "p50(us)"
+       << std::setw(12) << "p90(us)"
+       << std::setw(12) << "p99(us)"
+       << std::setw(12) << "p99.9(us)"
+       << std::setw(12) << "max(us)" << "\n";
+
+    for (size_t i = 0; i < kStageCount; ++i) {
+        const auto& snap = snapshots[i];
+        if (snap.total_count == 0) continue;
+
+        ss << std::left << std::setw(16) << stage_name(static_cast<LatencyStage>(i))
+           << std::right << std::setw(10) << snap.total_count
+           << std::setw(12) << snap.percentile(50.0) / 1000.0
+           << std::setw(12) << snap.percentile(90.0) / 1000.0
+           << std::setw(12) << snap.percentile(99.0) / 1000.0
+           << std::setw(12) << snap.percentile(99.9) / 1000.0
+           << std::setw(12) << snap.max / 1000.0 << "\n";
+    }
+    return ss.str();
+}
+
+void LatencyTracker::start_reporting(std::chrono::seconds interval) {
+    stop_reporting();
+    {
+        std::lock_guard<std::mutex> lock(reporter_mutex_);
+        reporter_stop_ = false;
+    }
+    reporter_thread_ = std::thread(&LatencyTracker::reporting_loop, this, interval);
+}
+
+void LatencyTracker::stop_reporting() {
+    {
+        std::lock_guard<std::mutex> lock(reporter_mutex_);
+        reporter_stop_ = true;
+    }
+    reporter_cv_.notify_all();
+    if (reporter_thread_.joinable()) {
+        reporter_thread_.join();
+    }
+}
+
+void LatencyTracker::reporting_loop(std::chrono::seconds interval) {
+    std::array<HistogramSnapshot, kStageCount> previous;
+    for (size_t i = 0; i < kStageCount; ++i) {
+        previous[i] = histograms_[i].snapshot();
+    }
+
+    std::unique_lock<std::mutex> lock(reporter_mutex_);
+    while (!reporter_cv_.wait_for(lock, interval, [this] { return reporter_stop_; })) {
+        std::array<HistogramSnapshot, kStageCount> current;
+        std::array<HistogramSnapshot, kStageCount> window;
+        bool has_samples = false;
+        for (size_t i = 0; i < kStageCount; ++i) {
+            current[i] = histograms_[i].snapshot();
+            window[i] = current[i].since(previous[i]);
+            has_samples = has_samples || window[i].total_count > 0;
+        }
+        previous = std::move(current);
+
+        if (has_samples) {
+            spdlog::info("Latency report (last {}s):\n{}", interval.count(), format_report(window));
+        }
+    }
+}
@@ -1,11 +1,23 @@
 #include "deribit_trader.hpp"
 #include "trading_agent.hpp"
+#include "trading_pipeline.hpp"
+#include "thread_layout.hpp"
+#include "app_config.hpp"
+#include "control_server.hpp"
+#include "options_chain.hpp"
+#include "monte_carlo_var.hpp"
 #include <iostream>
 #include <iomanip>
 #include <csignal>
 #include <thread>
+#include <future>
 #include <atomic>
 #include <fstream>
+#include <optional>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <cstdlib>
 
 std::atomic<bool> g_running(true);
 
@@ -48,37 +60,452 @@ private:
     }
 
     DeribitTrader& trader_;
+    AppConfig config_;
+    PortfolioRisk portfolio_;  // Every agent and manual order, before the agent that points at it
     TradingAgent agent_;
-    bool running_ = true;
-    std::string current_instrument_ = "BTC-PERPETUAL";
-
-    struct MarketSnapshot {
-        double best_bid = 0.0;
-        double best_ask = 0.0;
-        double last_price = 0.0;
-        std::chrono::steady_clock::time_point last_updated;
-    };
-    MarketSnapshot market_data_;
+    TradingPipeline pipeline_;
+    std::thread market_data_thread_;
+    std::atomic<bool> running_{true};
+    std::string current_instrument_;
+    // Menu thread writes, feed thread reads
+    std::shared_ptr<const std::string> feed_instrument_;
+    MetricsServer metrics_server_;
+    OptionsChain options_;  // Filled at engine start when options_underlying is set
+    MonteCarloVar var_;     // Fed by the feed thread, run on its own threads
 
 public:
-    TradingApp(DeribitTrader& trader) 
+    TradingApp(DeribitTrader& trader, const AppConfig& config)
         : trader_(trader)
-        , agent_(trader, "BTC-PERPETUAL", TradingAgent::RiskLevel::CONSERVATIVE) {
+        , config_(config)
+        , agent_(trader, config.instrument, config.risk_level, config.strategy)
+        , pipeline_(trader, agent_)
+        , current_instrument_(config.instrument)
+        , feed_instrument_(std::make_shared<const std::string>(config.instrument))
+        , metrics_server_(config.metrics_port)
+        , var_(config.var) {
 
         initialize_logging();
+        if (!config_.backfill_file.empty()) {
+            agent_.setBackfillFile(config_.backfill_file);
+        }
+
+        portfolio_.set_limits(config_.risk_limits);
+        trader_.set_trade_tape_settings(config_.trade_tape);
+
+        trader_.register_metrics(metrics_server_);
+        agent_.registerMetrics(metrics_server_);
+        portfolio_.register_metrics(metrics_server_);
+        pipeline_.register_metrics(metrics_server_);
+        options_.register_metrics(metrics_server_);
+        var_.register_metrics(metrics_server_);
+        // For the frontend's risk page
+        metrics_server_.add_route("/risk", "application/json", [this] { return risk_json().dump(); });
+        metrics_server_.set_route_origin(config_.frontend_origin);
+        try {
+            metrics_server_.start();
+        } catch (const std::exception& e) {
+            log_message("Metrics endpoint disabled: " + std::string(e.what()));
+        }
     }
 
+    // Feed thread -> strategy thread -> order gateway thread; this thread
+    // only drives the menu and talks to the agent through the pipeline
     void run() {
-        // Start market data thread
-        std::thread market_data_thread(&TradingApp::update_market_data, this);
-        market_data_thread.detach();
-
+        start_engine();
         while (running_ && g_running) {
             display_main_menu();
         }
+        stop_engine();
+    }
+
+    // No TTY: the control socket thread takes the menu's place as the
+    // pipeline's control thread, and this thread only waits for shutdown
+    void run_headless() {
+        start_engine();
+        if (config_.start_trading) {
+            // Queued before the control thread exists, so the control ring
+            // still has a single producer at a time
+            pipeline_.start_trading();
+        }
+
+        ControlServer control(config_.control_socket,
+                              [this](const std::string& command) { return handle_command(command); });
+        control.start();
+        log_message("Headless engine running; control socket " + control.path());
+
+        while (running_ && g_running) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        }
+
+        control.stop();
+        stop_engine();
+        log_message("Headless engine stopped");
     }
 
 private:
+    // The indicator backfill only needs public REST, so it overlaps the
+    // trader's connect sequence; the engine starts once both are done
+    void start_engine() {
+        auto backfill = std::async(std::launch::async, [this] { agent_.backfillPriceHistory(); });
+        trader_.subscribe_orderbook(config_.instrument);
+        trader_.subscribe_trades(config_.instrument);
+
+        DeribitTrader::StartupReport report = trader_.ready().get();
+        backfill.get();
+        std::ostringstream timings;
+        timings << std::fixed << std::setprecision(3)
+                << "Ready to trade after " << trader_.seconds_since_construction() << " s (REST auth "
+                << report.rest_auth << " s, " << report.instrument_count << " instruments "
+                << report.instruments << " s" << (report.instruments_from_file ? " mapped" : "")
+                << ", WebSocket auth " << report.ws_ready << " s)";
+        log_message(timings.str());
+
+        try {
+            agent_.setPortfolioRisk(&portfolio_);
+        } catch (const std::exception& e) {
+            log_message("Agent runs without portfolio limits: " + std::string(e.what()));
+        }
+        pipeline_.start();
+        for (const auto& instrument : config_.watch_instruments) {
+            try {
+                trader_.subscribe_orderbook(instrument);
+                trader_.subscribe_trades(instrument);
+            } catch (const std::exception& e) {
+                log_message("Cannot watch " + instrument + ": " + e.what());
+            }
+        }
+        if (!config_.options_underlying.empty()) {
+            start_options();
+        }
+        market_data_thread_ = std::thread(&TradingApp::update_market_data, this);
+        var_.start([this] { return var_exposures(); },
+                   [this](const MonteCarloVar::Result& result) {
+                       if (result.valid) {
+                           portfolio_.set_value_at_risk(result.var);
+                       }
+                   });
+    }
+
+    // Every listed option on the underlying, fed by its ticker and repriced
+    // by the feed thread
+    void start_options() {
+        auto listed = trader_.list_instruments(InstrumentKind::OPTION, config_.options_underlying + "-");
+        std::vector<std::string> instruments;
+        instruments.reserve(listed.size());
+        for (const auto& [instrument, spec] : listed) {
+            options_.add_option(instrument, spec);
+            instruments.push_back(instrument);
+        }
+
+        trader_.set_ticker_handler([this](std::string_view instrument, const message_json& data) {
+            auto index = options_.find(instrument);
+            if (!index) {
+                return;
+            }
+            auto number = [&data](const char* key) {
+                auto it = data.find(key);
+                return it != data.end() && it->is_number() ? it->get<double>() : 0.0;
+            };
+            options_.update_quote(*index, number("best_bid_price"), number("best_ask_price"),
+                                  number("underlying_price"));
+        });
+        trader_.subscribe_tickers(instruments);
+        log_message("Pricing " + std::to_string(instruments.size()) + " " + config_.options_underlying +
+                    " options");
+    }
+
+    // Futures and spot at the board's mid, options at the chain's Greeks;
+    // instruments with neither keep their last mark
+    void mark_portfolio(size_t slot) {
+        const std::string& instrument = portfolio_.instrument(slot);
+        if (portfolio_.spec(slot).kind == InstrumentKind::OPTION) {
+            if (auto index = options_.find(instrument)) {
+                auto option = options_.option(*index);
+                if (option.valid) {
+                    portfolio_.update_option(slot, option.forward, option.delta, option.gamma, option.vega);
+                }
+            }
+            return;
+        }
+        auto quote = trader_.market_board().quote(instrument);
+        if (quote && quote->book_valid) {
+            portfolio_.update_price(slot, 0.5 * (quote->best_bid + quote->best_ask));
+        }
+    }
+
+    void stop_engine() {
+        running_ = false;
+        var_.stop();
+        market_data_thread_.join();
+        pipeline_.stop();
+    }
+
+    // The book's delta and gamma summed per underlying
+    std::vector<MonteCarloVar::Exposure> var_exposures() const {
+        std::map<std::string_view, MonteCarloVar::Exposure> by_underlying;
+        for (size_t slot = 0; slot < portfolio_.size(); ++slot) {
+            auto exposure = portfolio_.instrument_exposure(slot);
+            if (exposure.positions == 0) {
+                continue;
+            }
+            std::string_view underlying = MonteCarloVar::underlying_of(portfolio_.instrument(slot));
+            auto& entry = by_underlying[underlying];
+            entry.underlying = std::string(underlying);
+            entry.delta += exposure.delta;
+            entry.gamma += exposure.gamma;
+        }
+        std::vector<MonteCarloVar::Exposure> exposures;
+        for (auto& [underlying, exposure] : by_underlying) {
+            exposures.push_back(std::move(exposure));
+        }
+        return exposures;
+    }
+
+    // One price per underlying: the first futures or spot mid on the board,
+    // else an option's forward
+    void sample_var_prices() {
+        std::map<std::string_view, double> prices;
+        auto add_mid = [&](const std::string& instrument) {
+            auto quote = trader_.market_board().quote(instrument);
+            if (quote && quote->book_valid) {
+                prices.emplace(MonteCarloVar::underlying_of(instrument), 0.5 * (quote->best_bid + quote->best_ask));
+            }
+        };
+        add_mid(config_.instrument);
+        for (const auto& instrument : config_.watch_instruments) {
+            add_mid(instrument);
+        }
+        for (size_t slot = 0; slot < portfolio_.size(); ++slot) {
+            const std::string& instrument = portfolio_.instrument(slot);
+            if (portfolio_.spec(slot).kind != InstrumentKind::OPTION) {
+                add_mid(instrument);
+            } else if (auto index = options_.find(instrument)) {
+                auto option = options_.option(*index);
+                if (option.forward > 0.0) {
+                    prices.emplace(MonteCarloVar::underlying_of(instrument), option.forward);
+                }
+            }
+        }
+
+        std::vector<std::pair<std::string, double>> sample;
+        sample.reserve(prices.size());
+        for (const auto& [underlying, price] : prices) {
+            sample.emplace_back(std::string(underlying), price);
+        }
+        if (!sample.empty()) {
+            var_.record_prices(sample);
+        }
+    }
+
+    // Window figures and the latest few bars of each kind that is on
+    static json tape_json(const std::string& instrument, const TradeTape& tape) {
+        auto stats = tape.stats();
+        json bars = json::object();
+        for (auto kind : {TradeTape::BarKind::TICK, TradeTape::BarKind::VOLUME, TradeTape::BarKind::DOLLAR}) {
+            json list = json::array();
+            for (const auto& bar : tape.bars(kind, 5)) {
+                list.push_back({
+                    {"open_ms", bar.open_ms},
+                    {"close_ms", bar.close_ms},
+                    {"open", bar.open},
+                    {"high", bar.high},
+                    {"low", bar.low},
+                    {"close", bar.close},
+                    {"volume", bar.volume},
+                    {"buy_volume", bar.buy_volume},
+                    {"vwap", bar.vwap()},
+                    {"trades", bar.trades}
+                });
+            }
+            bars[TradeTape::bar_kind_name(kind)] = {
+                {"completed", tape.bars_completed(kind)},
+                {"latest", list}
+            };
+        }
+        return {
+            {"instrument", instrument},
+            {"trades", stats.trades},
+            {"last_price", stats.last_price},
+            {"last_timestamp_ms", stats.last_timestamp_ms},
+            {"window_s", std::chrono::duration<double>(tape.settings().window).count()},
+            {"window_trades", stats.window_trades},
+            {"window_volume", stats.window_volume},
+            {"window_buy_volume", stats.window_buy_volume},
+            {"vwap", stats.vwap},
+            {"bars", bars}
+        };
+    }
+
+    static json var_json(const MonteCarloVar::Result& result) {
+        if (!result.valid) {
+            return {{"valid", false}, {"error", result.error}};
+        }
+        json factors = json::array();
+        for (const auto& factor : result.factors) {
+            factors.push_back({
+                {"underlying", factor.underlying},
+                {"delta_usd", factor.delta},
+                {"gamma_usd", factor.gamma},
+                {"horizon_vol", factor.horizon_vol}
+            });
+        }
+        return {
+            {"valid", true},
+            {"var_usd", result.var},
+            {"expected_shortfall_usd", result.expected_shortfall},
+            {"mean_pnl_usd", result.mean_pnl},
+            {"stdev_pnl_usd", result.stdev_pnl},
+            {"confidence", result.confidence},
+            {"horizon_s", result.horizon_seconds},
+            {"paths", result.paths},
+            {"samples", result.samples},
+            {"factors", factors},
+            {"run_s", result.seconds},
+            {"computed_at_ms", result.computed_at_ms}
+        };
+    }
+
+    // Exposure, limits and the latest VaR; unlimited bounds serialize as null
+    json risk_json() const {
+        auto exposure = portfolio_.exposure();
+        auto limits = portfolio_.limits();
+        auto latest = var_.latest();
+        return {
+            {"positions", exposure.positions},
+            {"delta_usd", exposure.delta},
+            {"gamma_usd", exposure.gamma},
+            {"vega_usd", exposure.vega},
+            {"gross_notional_usd", exposure.gross_notional},
+            {"within_limits", portfolio_.within_limits()},
+            {"limits", {
+                {"max_delta_usd", limits.max_delta},
+                {"max_gamma_usd", limits.max_gamma},
+                {"max_vega_usd", limits.max_vega},
+                {"max_notional_usd", limits.max_gross_notional},
+                {"max_var_usd", limits.max_var}
+            }},
+            {"var", latest ? var_json(*latest) : json(nullptr)}
+        };
+    }
+
+    // One command per line, one JSON reply per command:
+    //   status | start | stop | quote [instrument] | shutdown
+    //   strategy <momentum|mean_reversion|breakout|order_flow|book_imbalance>
+    //   risk <conservative|moderate|aggressive>
+    //   options | option <instrument> | portfolio | var | tape [instrument]
+    std::string handle_command(const std::string& line) {
+        std::istringstream in(line);
+        std::string command, argument;
+        in >> command >> argument;
+
+        json reply;
+        try {
+            if (command == "status") {
+                auto status = pipeline_.status();
+                reply = {
+                    {"running", status->running},
+                    {"instrument", config_.instrument},
+                    {"strategy", AppConfig::strategy_name(status->strategy)},
+                    {"risk_level", AppConfig::risk_level_name(status->risk_level)},
+                    {"unrealized_pnl", status->unrealized_pnl},
+                    {"daily_pnl", status->daily_pnl},
+                    {"total_profit", status->total_profit},
+                    {"total_trades", status->total_trades},
+                    {"open_positions", status->positions.size()},
+                    {"market_data_stale", trader_.market_data_stale()},
+                    {"time_to_first_trade_s", trader_.time_to_first_order()}
+                };
+            } else if (command == "start") {
+                reply = {{"ok", pipeline_.start_trading()}};
+            } else if (command == "stop") {
+                reply = {{"ok", pipeline_.stop_trading()}};
+            } else if (command == "strategy") {
+                reply = {{"ok", pipeline_.set_strategy(AppConfig::parse_strategy(argument))}};
+            } else if (command == "risk") {
+                reply = {{"ok", pipeline_.set_risk_level(AppConfig::parse_risk_level(argument))}};
+            } else if (command == "quote") {
+                std::string instrument = argument.empty() ? config_.instrument : argument;
+                auto quote = trader_.market_board().quote(instrument);
+                if (!quote || !quote->book_valid) {
+                    reply = {{"error", "no market data for " + instrument}};
+                } else {
+                    reply = {
+                        {"instrument", instrument},
+                        {"best_bid", quote->best_bid},
+                        {"best_ask", quote->best_ask},
+                        {"last_price", quote->last_price},
+                        {"age_ms", std::chrono::duration_cast<std::chrono::milliseconds>(
+                                       quote_age(*quote)).count()}
+                    };
+                    auto features = trader_.market_board().features(instrument);
+                    if (features && features->valid) {
+                        reply["features"] = {
+                            {"microprice", features->microprice},
+                            {"top_imbalance", features->top_imbalance},
+                            {"depth_imbalance", features->depth_imbalance},
+                            {"ofi", features->ofi},
+                            {"ofi_ratio", features->ofi_ratio},
+                            {"signed_volume", features->signed_volume},
+                            {"volume_ratio", features->volume_ratio}
+                        };
+                    }
+                }
+            } else if (command == "tape") {
+                std::string instrument = argument.empty() ? config_.instrument : argument;
+                const TradeTape* tape = trader_.trade_tape(instrument);
+                if (!tape) {
+                    reply = {{"error", "no trade tape for " + instrument}};
+                } else {
+                    reply = tape_json(instrument, *tape);
+                }
+            } else if (command == "options") {
+                reply = {
+                    {"underlying", config_.options_underlying},
+                    {"options", options_.size()},
+                    {"priced", options_.valid_count()}
+                };
+            } else if (command == "option") {
+                auto index = options_.find(argument);
+                if (!index) {
+                    reply = {{"error", "no option " + argument}};
+                } else {
+                    auto option = options_.option(*index);
+                    reply = {
+                        {"instrument", argument},
+                        {"bid", option.bid},
+                        {"ask", option.ask},
+                        {"forward", option.forward},
+                        {"valid", option.valid},
+                        {"iv", option.iv},
+                        {"price_usd", option.price_usd},
+                        {"delta", option.delta},
+                        {"gamma", option.gamma},
+                        {"vega", option.vega},
+                        {"theta", option.theta}
+                    };
+                }
+            } else if (command == "portfolio") {
+                reply = risk_json();
+            } else if (command == "var") {
+                // On demand, over the book as it stands now
+                auto result = var_.run(var_exposures());
+                if (result->valid) {
+                    portfolio_.set_value_at_risk(result->var);
+                }
+                reply = var_json(*result);
+            } else if (command == "shutdown") {
+                running_ = false;
+                reply = {{"ok", true}};
+            } else {
+                reply = {{"error", "unknown command '" + command + "'"}};
+            }
+        } catch (const std::exception& e) {
+            reply = {{"error", e.what()}};
+        }
+        log_message("Control: " + line + " -> " + reply.dump());
+        return reply.dump();
+    }
+
     void display_main_menu() {
         clear_screen();
         display_market_overview();
@@ -167,7 +594,21 @@ private:
                 .reduce_only = false
             };
 
+            // Manual orders count against the same book as the agent's
+            auto spec = trader_.instrument_spec(current_instrument_);
+            size_t slot = portfolio_.add_instrument(current_instrument_, spec.value_or(InstrumentSpec{}));
+            mark_portfolio(slot);
+            double signed_amount = direction == "buy" ? amount : -amount;
+            auto breach = portfolio_.check_order(slot, signed_amount);
+            if (breach != PortfolioRisk::Breach::NONE && breach != PortfolioRisk::Breach::UNPRICED) {
+                std::cout << "Order refused: portfolio " << PortfolioRisk::breach_name(breach)
+                          << " limit" << std::endl;
+                wait_for_user();
+                return;
+            }
+
             std::string order_id = trader_.place_order(order);
+            portfolio_.on_fill(slot, signed_amount);
             std::cout << "Order placed successfully. Order ID: " << order_id << std::endl;
         } catch (const std::exception& e) {
             std::cerr << "Order placement failed: " << e.what() << std::endl;
@@ -185,6 +626,8 @@ private:
         std::cout << "1. Momentum Trading\n";
         std::cout << "2. Mean Reversion\n";
         std::cout << "3. Breakout Trading\n";
+        std::cout << "4. Order Flow\n";
+        std::cout << "5. Book Imbalance\n";
         std::cout << "Choice: ";
 
         int strategy_choice;
@@ -195,6 +638,8 @@ private:
             case 1: strategy = TradingAgent::Strategy::MOMENTUM; break;
             case 2: strategy = TradingAgent::Strategy::MEAN_REVERSION; break;
             case 3: strategy = TradingAgent::Strategy::BREAKOUT; break;
+            case 4: strategy = TradingAgent::Strategy::ORDER_FLOW; break;
+            case 5: strategy = TradingAgent::Strategy::BOOK_IMBALANCE; break;
             default: strategy = TradingAgent::Strategy::MOMENTUM;
         }
 
@@ -216,36 +661,34 @@ private:
             default: risk = TradingAgent::RiskLevel::CONSERVATIVE;
         }
 
-        agent_.setStrategy(strategy);
-        agent_.setRiskLevel(risk);
+        pipeline_.set_strategy(strategy);
+        pipeline_.set_risk_level(risk);
 
         std::cout << "\nTrading configuration updated successfully!" << std::endl;
         wait_for_user();
     }
 
     void start_automated_trading() {
-        if (!agent_.isRunning()) {
-            agent_.start();
-            std::cout << "Automated trading started!" << std::endl;
-        } else {
+        if (pipeline_.status()->running) {
             std::cout << "Trading already running!" << std::endl;
+        } else if (pipeline_.start_trading()) {
+            std::cout << "Automated trading started!" << std::endl;
         }
         wait_for_user();
     }
 
     void stop_automated_trading() {
-        if (agent_.isRunning()) {
-            agent_.stop();
-            std::cout << "Automated trading stopped!" << std::endl;
-        } else {
+        if (!pipeline_.status()->running) {
             std::cout << "Trading already stopped!" << std::endl;
+        } else if (pipeline_.stop_trading()) {
+            std::cout << "Automated trading stopped!" << std::endl;
         }
         wait_for_user();
     }
 
     void view_positions_and_performance() {
         clear_screen();
-        std::cout << agent_.getStrategyStatus() << std::endl;
+        std::cout << TradingAgent::formatStatus(*pipeline_.status()) << std::endl;
         wait_for_user();
     }
 
@@ -282,28 +725,55 @@ private:
         std::cin >> params.max_loss_daily;
         params.max_loss_daily /= 100.0;
 
-        agent_.setTradingParams(params);
+        pipeline_.set_trading_params(params);
         std::cout << "\nRisk parameters updated successfully!" << std::endl;
         wait_for_user();
     }
 
+    // The WebSocket sessions keep the market board current; REST only fills
+    // in while the stream has no fresh book for this instrument
     void update_market_data() {
+        ThreadLayout::process().apply("feed");
+        int64_t last_published_ns = 0;
+        auto next_var_sample = std::chrono::steady_clock::now();
         while (running_ && g_running) {
+            auto instrument = std::atomic_load(&feed_instrument_);
             try {
-                json orderbook = trader_.get_orderbook(current_instrument_);
-                
-                if (orderbook.contains("result")) {
-                    const auto& result = orderbook["result"];
-                    market_data_.best_bid = result["bids"][0][0].get<double>();
-                    market_data_.best_ask = result["asks"][0][0].get<double>();
-                    market_data_.last_updated = std::chrono::steady_clock::now();
-                    
-                    // Update trading agent with new prices
-                    if (agent_.isRunning()) {
-                        double mid_price = (market_data_.best_bid + market_data_.best_ask) / 2;
-                        agent_.updatePrice(mid_price, market_data_.best_bid, market_data_.best_ask);
+                MarketBoard& board = trader_.market_board();
+                auto quote = board.quote(*instrument);
+                if (!quote || !quote->book_valid || quote_age(*quote) > std::chrono::seconds(1)) {
+                    json orderbook = trader_.get_orderbook(*instrument);
+                    if (orderbook.contains("result")) {
+                        const auto& result = orderbook["result"];
+                        board.update_book(*instrument,
+                                          result["bids"][0][0].get<double>(),
+                                          result["asks"][0][0].get<double>(),
+                                          result.value("change_id", int64_t{0}),
+                                          result.value("timestamp", int64_t{0}));
+                        quote = board.quote(*instrument);
                     }
                 }
+
+                // Hand each new quote to the strategy thread once; a full
+                // ring drops the tick and counts it
+                if (quote && quote->book_valid && quote->updated_ns != last_published_ns) {
+                    last_published_ns = quote->updated_ns;
+                    pipeline_.publish_tick(quote->best_bid, quote->best_ask);
+                }
+
+                // Expiries are in exchange time
+                if (options_.size() > 0) {
+                    auto now_ms = std::chrono::duration<double, std::milli>(
+                        std::chrono::system_clock::now().time_since_epoch()).count();
+                    options_.refresh(static_cast<int64_t>(now_ms + trader_.clock_offset_ms()));
+                }
+                for (size_t slot = 0; slot < portfolio_.size(); ++slot) {
+                    mark_portfolio(slot);
+                }
+                if (auto now = std::chrono::steady_clock::now(); now >= next_var_sample) {
+                    next_var_sample = now + var_.settings().sample_interval;
+                    sample_var_prices();
+                }
             } catch (const std::exception& e) {
                 std::cerr << "Market data update error: " << e.what() << std::endl;
                 std::this_thread::sleep_for(std::chrono::seconds(5));
@@ -407,45 +877,60 @@ private:
             std::cerr << "Invalid instrument. Reverting to previous instrument." << std::endl;
             current_instrument_ = "BTC-PERPETUAL";
         }
+        std::atomic_store(&feed_instrument_, std::make_shared<const std::string>(current_instrument_));
 
         wait_for_user();
     }
 
+    // Since the last book write; trades alone do not keep a book fresh
+    static std::chrono::nanoseconds quote_age(const MarketBoard::Quote& quote) {
+        return LatencyTracker::now().time_since_epoch() - std::chrono::nanoseconds(quote.updated_ns);
+    }
+
     void display_market_overview() {
         std::cout << "Market Overview for " << current_instrument_ << ":\n";
-        
-        auto now = std::chrono::steady_clock::now();
-        auto age = std::chrono::duration_cast<std::chrono::seconds>(
-            now - market_data_.last_updated).count();
-        
+
+        // One consistent copy; the feed never waits on this thread
+        auto quote = trader_.market_board().quote(current_instrument_);
+        if (!quote || !quote->book_valid) {
+            std::cout << "No market data yet\n";
+            return;
+        }
+
+        auto age = std::chrono::duration_cast<std::chrono::seconds>(quote_age(*quote)).count();
         if (age > 10) {
             std::cout << "Market data is stale (last updated " << age << " seconds ago)\n";
             return;
         }
 
+        if (trader_.market_data_stale()) {
+            std::cout << "WebSocket feed down or resyncing; automated entries paused\n";
+        }
+
         std::cout << std::fixed << std::setprecision(2);
-        std::cout << "Best Bid: $" << market_data_.best_bid << std::endl;
-        std::cout << "Best Ask: $" << market_data_.best_ask << std::endl;
-        std::cout << "Spread: $" << (market_data_.best_ask - market_data_.best_bid) << std::endl;
+        std::cout << "Best Bid: $" << quote->best_bid << std::endl;
+        std::cout << "Best Ask: $" << quote->best_ask << std::endl;
+        std::cout << "Spread: $" << (quote->best_ask - quote->best_bid) << std::endl;
+        if (quote->trade_timestamp_ms != 0) {
+            std::cout << "Last Trade: $" << quote->last_price << " x " << quote->last_amount << std::endl;
+        }
     }
 
     void display_trading_status() {
-        if (agent_.isRunning()) {
+        auto status = pipeline_.status();
+        if (status->running) {
             std::cout << "\nTrading Bot Status: ACTIVE\n";
-            std::cout << "Current P&L: $" << agent_.getCurrentPnL() << std::endl;
-            std::cout << "Daily P&L: $" << agent_.getDailyPnL() << std::endl;
-            std::cout << "Open Positions: " << agent_.getOpenPositions().size() << std::endl;
+            std::cout << "Current P&L: $" << status->unrealized_pnl << std::endl;
+            std::cout << "Daily P&L: $" << status->daily_pnl << std::endl;
+            std::cout << "Open Positions: " << status->positions.size() << std::endl;
         } else {
             std::cout << "\nTrading Bot Status: INACTIVE\n";
         }
     }
 
+    // ANSI erase and home instead of spawning clear(1) on every redraw
     void clear_screen() {
-        #ifdef _WIN32
-            system("cls");
-        #else
-            system("clear");
-        #endif
+        std::cout << "\033[2J\033[H" << std::flush;
     }
 
     void wait_for_user() {
@@ -455,8 +940,29 @@ private:
     }
 };
 
-int main() {
+void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [--config FILE] [--headless]\n"
+              << "  --config FILE  JSON startup settings (see app_config.hpp)\n"
+              << "  --headless     Run without the terminal menu; control via the control socket\n"
+              << "API keys come from DERIBIT_API_KEY / DERIBIT_API_SECRET or the config file.\n";
+}
+
+int main(int argc, char** argv) {
     try {
+        std::string config_path;
+        bool headless = false;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--config" && i + 1 < argc) {
+                config_path = argv[++i];
+            } else if (arg == "--headless") {
+                headless = true;
+            } else {
+                print_usage(argv[0]);
+                return arg == "--help" ? 0 : 1;
+            }
+        }
+
         // Add more comprehensive logging and error handling
         std::ofstream main_log("trading_main.log", std::ios::app);
         
@@ -477,24 +983,44 @@ int main() {
         signal(SIGINT, signal_handler);
         signal(SIGTERM, signal_handler);
 
-        std::cout << "=== Deribit Automated Trading System ===\n\n";
-        
-        std::string api_key = "IfKb1DKS";
-        std::string api_secret = "OsySwvQZLZDNamcmit07SnXZvZmRVYk6AWL4zVRw-LE";
+        AppConfig config = config_path.empty() ? AppConfig{} : AppConfig::load(config_path);
+        config.apply_environment();
+        if (!config_path.empty()) {
+            log_message("Loaded config " + config_path);
+        }
 
-        if (api_key.empty() || api_secret.empty()) {
+        // Placement for the hot threads; DERIBIT_THREAD_LAYOUT overrides the file
+        if (!config.thread_layout.empty() && !std::getenv("DERIBIT_THREAD_LAYOUT")) {
+            ThreadLayout::configure(config.thread_layout);
+        }
+        const ThreadLayout& layout = ThreadLayout::process();
+        log_message("Thread layout: " + layout.describe());
+        layout.lock_memory_if_requested();
+
+        if (!headless) {
+            std::cout << "=== Deribit Automated Trading System ===\n\n";
+        }
+
+        if (config.api_key.empty() || config.api_secret.empty()) {
             log_message("API key or secret is empty");
-            std::cerr << "API key and secret cannot be empty!" << std::endl;
+            std::cerr << "Set DERIBIT_API_KEY and DERIBIT_API_SECRET, or api_key and api_secret "
+                         "in the config file" << std::endl;
             return 1;
         }
 
         try {
-            DeribitTrader trader(api_key, api_secret);
-            log_message("Trader initialized successfully");
+            DeribitTrader trader(config.api_key, config.api_secret, config.endpoints, true,
+                                 config.ws_sessions, config.instrument_cache);
+            log_message("Trader connecting");
+            trader.latency().start_reporting(std::chrono::seconds(60));
             
-            TradingApp app(trader);
+            TradingApp app(trader, config);
             
-            app.run();
+            if (headless) {
+                app.run_headless();
+            } else {
+                app.run();
+            }
         } catch (const std::exception& e) {
             log_message("Trader initialization failed: " + std::string(e.what()));
             std::cerr << "Trader initialization failed: " << e.what() << std::endl;
@@ -509,4 +1035,4 @@ int main() {
         std::cerr << "Fatal error: " << e.what() << std::endl;
         return 1;
     }
-}
\ No newline at end of file
+}
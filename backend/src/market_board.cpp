@@ -0,0 +1,105 @@
+#include "market_board.hpp"
+#include <stdexcept>
+#include "latency_tracker.hpp"
+
+namespace {
+
+int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        LatencyTracker::now().time_since_epoch()).count();
+}
+
+}  // namespace
+
+MarketBoard::MarketBoard() : slots_(new Slot[kMaxInstruments]) {}
+
+// Slots are only ever appended, so a reader scans the published prefix
+// without synchronizing with writers adding instruments
+MarketBoard::Slot* MarketBoard::find(std::string_view instrument) const {
+    size_t count = count_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; ++i) {
+        if (slots_[i].instrument == instrument) {
+            return &slots_[i];
+        }
+    }
+    return nullptr;
+}
+
+MarketBoard::Slot& MarketBoard::find_or_add(std::string_view instrument) {
+    if (Slot* slot = find(instrument)) {
+        return *slot;
+    }
+
+    std::lock_guard<std::mutex> lock(add_mutex_);
+    size_t count = count_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < count; ++i) {
+        if (slots_[i].instrument == instrument) {
+            return slots_[i];
+        }
+    }
+    if (count == kMaxInstruments) {
+        throw std::length_error("MarketBoard is full");
+    }
+    slots_[count].instrument.assign(instrument);
+    count_.store(count + 1, std::memory_order_release);
+    return slots_[count];
+}
+
+std::optional<MarketBoard::Quote> MarketBoard::quote(std::string_view instrument) const {
+    Slot* slot = find(instrument);
+    if (!slot || slot->quote.version() == 0) {
+        return std::nullopt;
+    }
+    return slot->quote.load();
+}
+
+std::optional<BookFeatures::Values> MarketBoard::features(std::string_view instrument) const {
+    Slot* slot = find(instrument);
+    if (!slot || slot->features.version() == 0) {
+        return std::nullopt;
+    }
+    return slot->features.load();
+}
+
+void MarketBoard::update_book(std::string_view instrument, double best_bid, double best_ask,
+                              int64_t change_id, int64_t timestamp_ms) {
+    find_or_add(instrument).quote.update([&](Quote& quote) {
+        if (quote.book_valid && change_id < quote.change_id) {
+            return;
+        }
+        quote.best_bid = best_bid;
+        quote.best_ask = best_ask;
+        quote.change_id = change_id;
+        quote.book_timestamp_ms = timestamp_ms;
+        quote.book_valid = true;
+        quote.updated_ns = now_ns();
+    });
+}
+
+void MarketBoard::invalidate_book(std::string_view instrument) {
+    Slot* slot = find(instrument);
+    if (!slot) {
+        return;
+    }
+    slot->quote.update([](Quote& quote) {
+        quote.book_valid = false;
+    });
+    if (slot->features.version() != 0) {
+        slot->features.update([](BookFeatures::Values& values) {
+            values.valid = false;
+        });
+    }
+}
+
+void MarketBoard::update_trade(std::string_view instrument, double price, double amount, int64_t timestamp_ms) {
+    find_or_add(instrument).quote.update([&](Quote& quote) {
+        quote.last_price = price;
+        quote.last_amount = amount;
+        quote.trade_timestamp_ms = timestamp_ms;
+        quote.trade_updated_ns = now_ns();
+    });
+}
+
+void MarketBoard::update_features(std::string_view instrument, const BookFeatures::Values& values) {
+    find_or_add(instrument).features.store(values);
+}
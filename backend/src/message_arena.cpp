@@ -0,0 +1,71 @@
+#include "message_arena.hpp"
+#include <algorithm>
+
+MessageArena::MessageArena(size_t block_size) : block_size_(block_size) {
+    add_block(block_size_);
+}
+
+MessageArena::~MessageArena() {
+    for (auto& block : blocks_) {
+        ::operator delete(block.data);
+    }
+}
+
+MessageArena& MessageArena::local() {
+    thread_local MessageArena arena;
+    return arena;
+}
+
+void* MessageArena::allocate(size_t bytes, size_t alignment) {
+    while (true) {
+        Block& block = blocks_[current_block_];
+        size_t aligned = (offset_ + alignment - 1) & ~(alignment - 1);
+        if (aligned + bytes <= block.size) {
+            offset_ = aligned + bytes;
+            return block.data + aligned;
+        }
+
+        // Move to the next retained block, growing only past the high-water mark
+        if (current_block_ + 1 == blocks_.size()) {
+            add_block(std::max(block_size_, bytes + alignment));
+        }
+        ++current_block_;
+        offset_ = 0;
+    }
+}
+
+bool MessageArena::owns(const void* p) const {
+    auto address = reinterpret_cast<uintptr_t>(p);
+    for (const auto& block : blocks_) {
+        auto start = reinterpret_cast<uintptr_t>(block.data);
+        if (address >= start && address < start + block.size) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t MessageArena::bytes_in_use() const {
+    size_t used = offset_;
+    for (size_t i = 0; i < current_block_; ++i) {
+        used += blocks_[i].size;
+    }
+    return used;
+}
+
+size_t MessageArena::capacity() const {
+    size_t total = 0;
+    for (const auto& block : blocks_) {
+        total += block.size;
+    }
+    return total;
+}
+
+void MessageArena::rewind() {
+    current_block_ = 0;
+    offset_ = 0;
+}
+
+void MessageArena::add_block(size_t min_size) {
+    blocks_.push_back({static_cast<char*>(::operator new(min_size)), min_size});
+}
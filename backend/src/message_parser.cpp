@@ -0,0 +1,237 @@
+#include "message_parser.hpp"
+#include <charconv>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+
+namespace {
+
+constexpr int kMaxDepth = 64;
+
+bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// Recursive descent over the frame. Every method returns false for input
+// it leaves to nlohmann, whether malformed or merely unusual.
+class Reader {
+public:
+    explicit Reader(std::string_view text) : p_(text.data()), end_(text.data() + text.size()) {}
+
+    bool document(message_json& out) {
+        return value(out, 0) && (skip_space(), p_ == end_);
+    }
+
+private:
+    void skip_space() {
+        while (p_ != end_ && (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t')) {
+            ++p_;
+        }
+    }
+
+    bool consume(char c) {
+        skip_space();
+        if (p_ != end_ && *p_ == c) {
+            ++p_;
+            return true;
+        }
+        return false;
+    }
+
+    bool literal(std::string_view word) {
+        if (static_cast<size_t>(end_ - p_) < word.size() || std::string_view(p_, word.size()) != word) {
+            return false;
+        }
+        p_ += word.size();
+        return true;
+    }
+
+    bool value(message_json& out, int depth) {
+        skip_space();
+        if (p_ == end_) {
+            return false;
+        }
+        switch (*p_) {
+        case '{':
+            return depth < kMaxDepth && object(out, depth + 1);
+        case '[':
+            return depth < kMaxDepth && array(out, depth + 1);
+        case '"':
+            out = message_json(message_json::value_t::string);
+            return string(out.get_ref<arena_string&>());
+        case 't':
+            out = true;
+            return literal("true");
+        case 'f':
+            out = false;
+            return literal("false");
+        case 'n':
+            return literal("null");
+        default:
+            return number(out);
+        }
+    }
+
+    bool object(message_json& out, int depth) {
+        ++p_;
+        out = message_json(message_json::value_t::object);
+        auto& members = out.get_ref<message_json::object_t&>();
+        if (consume('}')) {
+            return true;
+        }
+        do {
+            arena_string key;
+            if (!consume('"') || !string(key, false) || !consume(':')) {
+                return false;
+            }
+            // A repeated key keeps the last value, as nlohmann does
+            if (!value(members[std::move(key)], depth)) {
+                return false;
+            }
+        } while (consume(','));
+        return consume('}');
+    }
+
+    bool array(message_json& out, int depth) {
+        ++p_;
+        out = message_json(message_json::value_t::array);
+        auto& items = out.get_ref<message_json::array_t&>();
+        if (consume(']')) {
+            return true;
+        }
+        do {
+            items.emplace_back();
+            if (!value(items.back(), depth)) {
+                return false;
+            }
+        } while (consume(','));
+        return consume(']');
+    }
+
+    bool string(arena_string& out, bool at_quote = true) {
+        if (at_quote) {
+            ++p_;
+        }
+        const char* run = p_;
+        while (p_ != end_) {
+            auto c = static_cast<unsigned char>(*p_);
+            if (c == '"') {
+                out.append(run, p_);
+                ++p_;
+                return true;
+            }
+            if (c < 0x20 || c >= 0x80) {
+                return false;
+            }
+            if (c != '\\') {
+                ++p_;
+                continue;
+            }
+            out.append(run, p_);
+            if (++p_ == end_) {
+                return false;
+            }
+            switch (*p_) {
+            case '"': out.push_back('"'); break;
+            case '\\': out.push_back('\\'); break;
+            case '/': out.push_back('/'); break;
+            case 'b': out.push_back('\b'); break;
+            case 'f': out.push_back('\f'); break;
+            case 'n': out.push_back('\n'); break;
+            case 'r': out.push_back('\r'); break;
+            case 't': out.push_back('\t'); break;
+            default: return false;
+            }
+            run = ++p_;
+        }
+        return false;
+    }
+
+    // Integers without a fraction or exponent stay integral, unsigned unless
+    // negative; out of range ones become doubles, matching nlohmann
+    bool number(message_json& out) {
+        const char* start = p_;
+        bool negative = p_ != end_ && *p_ == '-';
+        if (negative) {
+            ++p_;
+        }
+        if (p_ == end_ || !is_digit(*p_)) {
+            return false;
+        }
+        if (*p_++ != '0') {
+            while (p_ != end_ && is_digit(*p_)) {
+                ++p_;
+            }
+        }
+        bool integral = true;
+        if (p_ != end_ && *p_ == '.') {
+            integral = false;
+            if (++p_ == end_ || !is_digit(*p_)) {
+                return false;
+            }
+            while (p_ != end_ && is_digit(*p_)) {
+                ++p_;
+            }
+        }
+        if (p_ != end_ && (*p_ == 'e' || *p_ == 'E')) {
+            integral = false;
+            if (++p_ != end_ && (*p_ == '+' || *p_ == '-')) {
+                ++p_;
+            }
+            if (p_ == end_ || !is_digit(*p_)) {
+                return false;
+            }
+            while (p_ != end_ && is_digit(*p_)) {
+                ++p_;
+            }
+        }
+
+        if (integral) {
+            if (negative) {
+                std::int64_t v = 0;
+                if (std::from_chars(start, p_, v).ec == std::errc{}) {
+                    out = v;
+                    return true;
+                }
+            } else {
+                std::uint64_t v = 0;
+                if (std::from_chars(start, p_, v).ec == std::errc{}) {
+                    out = v;
+                    return true;
+                }
+            }
+        }
+        double v = 0.0;
+        auto result = std::from_chars(start, p_, v);
+        if (result.ec != std::errc{} || result.ptr != p_) {
+            return false;
+        }
+        out = v;
+        return true;
+    }
+
+    const char* p_;
+    const char* end_;
+};
+
+message_json* arena_document(MessageArena& arena) {
+    return new (arena.allocate(sizeof(message_json), alignof(message_json))) message_json();
+}
+
+}  // namespace
+
+const message_json& parse_message(std::string_view text) {
+    MessageArena& arena = MessageArena::local();
+    if (!arena.active()) {
+        throw std::logic_error("parse_message needs an open MessageArena::Scope");
+    }
+
+    message_json* document = arena_document(arena);
+    if (Reader(text).document(*document)) {
+        return *document;
+    }
+    // The partial document is abandoned to the arena rather than destroyed
+    document = arena_document(arena);
+    *document = message_json::parse(text);
+    return *document;
+}
@@ -0,0 +1,244 @@
+#include "metrics_server.hpp"
+#include <arpa/inet.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <spdlog/spdlog.h>
+
+namespace {
+
+// Label values may hold anything; the exposition format escapes these three
+std::string escape_label(const std::string& value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            escaped += '\\';
+            escaped += c;
+        } else if (c == '\n') {
+            escaped += "\\n";
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+}  // namespace
+
+MetricsServer::MetricsServer(int port, const std::string& bind_address)
+    : port_(port), bind_address_(bind_address) {}
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+void MetricsServer::add_counter(const std::string& name, const std::string& help, Sampler sampler,
+                                Labels labels) {
+    metrics_.push_back({name, help, "counter", std::move(sampler), std::move(labels)});
+}
+
+void MetricsServer::add_gauge(const std::string& name, const std::string& help, Sampler sampler,
+                              Labels labels) {
+    metrics_.push_back({name, help, "gauge", std::move(sampler), std::move(labels)});
+}
+
+void MetricsServer::add_histogram(const std::string& name, const std::string& help,
+                                  HistogramSampler sampler, std::vector<double> bounds, double scale) {
+    histograms_.push_back({name, help, std::move(sampler), std::move(bounds), scale});
+}
+
+void MetricsServer::add_collector(Collector collector) {
+    collectors_.push_back(std::move(collector));
+}
+
+void MetricsServer::add_route(const std::string& path, const std::string& content_type, RouteHandler handler) {
+    routes_.push_back({path, content_type, std::move(handler)});
+}
+
+void MetricsServer::set_route_origin(const std::string& origin) {
+    route_origin_ = origin;
+}
+
+void MetricsServer::start() {
+    if (running_) return;
+
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) {
+        throw std::runtime_error("Failed to create metrics socket: " + std::string(strerror(errno)));
+    }
+
+    int reuse = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port_));
+    if (inet_pton(AF_INET, bind_address_.c_str(), &addr.sin_addr) != 1) {
+        close(listen_fd_);
+        listen_fd_ = -1;
+        throw std::runtime_error("Invalid metrics bind address: " + bind_address_);
+    }
+
+    if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        listen(listen_fd_, 16) < 0) {
+        std::string error = strerror(errno);
+        close(listen_fd_);
+        listen_fd_ = -1;
+        throw std::runtime_error("Failed to bind metrics port " + std::to_string(port_) + ": " + error);
+    }
+
+    // Report the kernel-assigned port when started with port 0
+    socklen_t addr_len = sizeof(addr);
+    if (getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &addr_len) == 0) {
+        port_ = ntohs(addr.sin_port);
+    }
+
+    running_ = true;
+    server_thread_ = std::thread(&MetricsServer::serve_loop, this);
+    spdlog::info("Metrics endpoint listening on http://{}:{}/metrics", bind_address_, port_);
+}
+
+void MetricsServer::stop() {
+    running_ = false;
+    if (server_thread_.joinable()) {
+        server_thread_.join();
+    }
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+        listen_fd_ = -1;
+    }
+}
+
+std::string MetricsServer::render() const {
+    std::ostringstream out;
+    // A family's series must be contiguous, whatever order they were added in
+    std::set<std::string_view> written;
+    for (const auto& family : metrics_) {
+        if (!written.insert(family.name).second) {
+            continue;
+        }
+        out << "# HELP " << family.name << " " << family.help << "\n"
+            << "# TYPE " << family.name << " " << family.type << "\n";
+        for (const auto& metric : metrics_) {
+            if (metric.name != family.name) {
+                continue;
+            }
+            out << metric.name;
+            if (!metric.labels.empty()) {
+                const char* separator = "{";
+                for (const auto& [label, value] : metric.labels) {
+                    out << separator << label << "=\"" << escape_label(value) << "\"";
+                    separator = ",";
+                }
+                out << "}";
+            }
+            out << " " << metric.sampler() << "\n";
+        }
+    }
+    for (const auto& histogram : histograms_) {
+        HistogramSnapshot snap = histogram.sampler();
+        out << "# HELP " << histogram.name << " " << histogram.help << "\n"
+            << "# TYPE " << histogram.name << " histogram\n";
+
+        // Buckets count whole LatencyHistogram buckets whose upper bound
+        // fits under the limit, so they inherit its ~3% precision
+        uint64_t cumulative = 0;
+        size_t bucket = 0;
+        for (double bound : histogram.bounds) {
+            double limit = bound / histogram.scale;
+            while (bucket < snap.counts.size() &&
+                   static_cast<double>(LatencyHistogram::bucket_upper_bound(bucket)) <= limit) {
+                cumulative += snap.counts[bucket++];
+            }
+            out << histogram.name << "_bucket{le=\"" << bound << "\"} " << cumulative << "\n";
+        }
+        out << histogram.name << "_bucket{le=\"+Inf\"} " << snap.total_count << "\n"
+            << histogram.name << "_sum " << snap.sum * histogram.scale << "\n"
+            << histogram.name << "_count " << snap.total_count << "\n";
+    }
+    for (const auto& collector : collectors_) {
+        collector(out);
+    }
+    return out.str();
+}
+
+void MetricsServer::serve_loop() {
+    while (running_) {
+        // Wake up periodically so stop() never waits on a scrape
+        pollfd pfd{listen_fd_, POLLIN, 0};
+        int ready = poll(&pfd, 1, 200);
+        if (ready <= 0 || !(pfd.revents & POLLIN)) {
+            continue;
+        }
+
+        int client_fd = accept(listen_fd_, nullptr, nullptr);
+        if (client_fd < 0) {
+            continue;
+        }
+
+        try {
+            handle_client(client_fd);
+        } catch (const std::exception& e) {
+            spdlog::warn("Metrics request failed: {}", e.what());
+        }
+        close(client_fd);
+    }
+}
+
+void MetricsServer::handle_client(int client_fd) {
+    timeval timeout{1, 0};
+    setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    char buffer[2048];
+    ssize_t n = recv(client_fd, buffer, sizeof(buffer) - 1, 0);
+    if (n <= 0) {
+        return;
+    }
+    buffer[n] = '\0';
+
+    std::string request(buffer, static_cast<size_t>(n));
+    std::string status = "200 OK";
+    std::string content_type = "text/plain; version=0.0.4";
+    std::string body;
+    std::string extra_headers;
+    auto requests = [&request](const std::string& path) {
+        return request.rfind("GET " + path + " ", 0) == 0 || request.rfind("GET " + path + "?", 0) == 0;
+    };
+    auto route = std::find_if(routes_.begin(), routes_.end(),
+                              [&](const Route& candidate) { return requests(candidate.path); });
+
+    if (requests("/metrics")) {
+        body = render();
+    } else if (route != routes_.end()) {
+        content_type = route->content_type;
+        if (!route_origin_.empty()) {
+            extra_headers = "Access-Control-Allow-Origin: " + route_origin_ + "\r\n";
+        }
+        body = route->handler();
+    } else {
+        status = "404 Not Found";
+        content_type = "text/plain";
+        body = "Not found\n";
+    }
+
+    std::string response = "HTTP/1.1 " + status + "\r\n"
+        "Content-Type: " + content_type + "\r\n"
+        "Content-Length: " + std::to_string(body.size()) + "\r\n" + extra_headers +
+        "Connection: close\r\n\r\n" + body;
+
+    size_t sent = 0;
+    while (sent < response.size()) {
+        ssize_t written = send(client_fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if (written <= 0) break;
+        sent += static_cast<size_t>(written);
+    }
+}
@@ -0,0 +1,413 @@
+#include "monte_carlo_var.hpp"
+#include <algorithm>
+#include <cmath>
+#include <spdlog/spdlog.h>
+#include "fast_math.hpp"
+#include "thread_layout.hpp"
+
+namespace {
+
+using namespace fast_math;
+
+constexpr size_t kLanes = 8;    // Independent streams per worker
+constexpr size_t kBatch = 512;  // Paths per pass through the kernel loops
+
+inline uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+uint64_t splitmix64(uint64_t& state) {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// xoshiro256++ in kLanes lanes, one state word per array, so a step is
+// the same shifts and xors on every lane
+struct LaneRng {
+    alignas(64) uint64_t s0[kLanes];
+    alignas(64) uint64_t s1[kLanes];
+    alignas(64) uint64_t s2[kLanes];
+    alignas(64) uint64_t s3[kLanes];
+
+    explicit LaneRng(uint64_t seed) {
+        for (size_t lane = 0; lane < kLanes; ++lane) {
+            s0[lane] = splitmix64(seed);
+            s1[lane] = splitmix64(seed);
+            s2[lane] = splitmix64(seed);
+            s3[lane] = splitmix64(seed);
+        }
+    }
+
+    // n must be a multiple of kLanes. The state is worked on in locals, so
+    // the compiler can keep it in registers across the whole fill.
+    void fill_uniform(double* __restrict out, size_t n) {
+        uint64_t a[kLanes], b[kLanes], c[kLanes], d[kLanes];
+        std::copy(s0, s0 + kLanes, a);
+        std::copy(s1, s1 + kLanes, b);
+        std::copy(s2, s2 + kLanes, c);
+        std::copy(s3, s3 + kLanes, d);
+        for (size_t base = 0; base < n; base += kLanes) {
+            // Left as a loop it vectorizes across lanes; unrolled, the
+            // rotates would stay scalar
+#pragma GCC unroll 1
+            for (size_t lane = 0; lane < kLanes; ++lane) {
+                uint64_t result = rotl(a[lane] + d[lane], 23) + a[lane];
+                uint64_t t = b[lane] << 17;
+                c[lane] ^= a[lane];
+                d[lane] ^= b[lane];
+                b[lane] ^= c[lane];
+                a[lane] ^= d[lane];
+                c[lane] ^= t;
+                d[lane] = rotl(d[lane], 45);
+                out[base + lane] = uniform_from_bits(result);
+            }
+        }
+        std::copy(a, a + kLanes, s0);
+        std::copy(b, b + kLanes, s1);
+        std::copy(c, c + kLanes, s2);
+        std::copy(d, d + kLanes, s3);
+    }
+};
+
+void to_normal(double* __restrict values, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        values[i] = norm_inv(values[i]);
+    }
+}
+
+// returns += weight * normals
+void accumulate(double* __restrict returns, const double* __restrict normals, double weight, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        returns[i] += weight * normals[i];
+    }
+}
+
+// Delta-gamma on the simple return of one underlying; gamma is per unit
+// return squared here
+void price_factor(double* __restrict pnl, const double* __restrict log_returns, double delta, double gamma,
+                  size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        double move = fast_exp(log_returns[i]) - 1.0;
+        pnl[i] += delta * move + 0.5 * gamma * move * move;
+    }
+}
+
+// Lower-triangular L with L * L^T = cov, row-major. Directions without
+// variance of their own, e.g. an underlying that moves exactly with
+// another, get a zero column instead of failing the factorization.
+std::vector<double> cholesky(const std::vector<double>& cov, size_t k) {
+    std::vector<double> l(k * k, 0.0);
+    for (size_t j = 0; j < k; ++j) {
+        double diagonal = cov[j * k + j];
+        for (size_t m = 0; m < j; ++m) {
+            diagonal -= l[j * k + m] * l[j * k + m];
+        }
+        if (diagonal <= 1e-12 * cov[j * k + j] || diagonal <= 0.0) {
+            continue;
+        }
+        l[j * k + j] = std::sqrt(diagonal);
+        for (size_t i = j + 1; i < k; ++i) {
+            double sum = cov[i * k + j];
+            for (size_t m = 0; m < j; ++m) {
+                sum -= l[i * k + m] * l[j * k + m];
+            }
+            l[i * k + j] = sum / l[j * k + j];
+        }
+    }
+    return l;
+}
+
+int64_t wall_clock_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace
+
+MonteCarloVar::MonteCarloVar() : MonteCarloVar(Settings{}) {}
+
+MonteCarloVar::MonteCarloVar(const Settings& settings) : settings_(settings) {
+    size_t threads = settings_.threads;
+    if (threads == 0) {
+        threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), 8);
+    }
+    for (size_t worker = 0; worker < threads; ++worker) {
+        workers_.emplace_back(&MonteCarloVar::worker_loop, this, worker);
+    }
+}
+
+MonteCarloVar::~MonteCarloVar() {
+    stop();
+    {
+        std::lock_guard<std::mutex> lock(job_mutex_);
+        workers_stopping_ = true;
+    }
+    job_cv_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+std::string_view MonteCarloVar::underlying_of(std::string_view instrument) {
+    return instrument.substr(0, instrument.find_first_of("-_"));
+}
+
+void MonteCarloVar::record_prices(const std::vector<std::pair<std::string, double>>& prices) {
+    std::lock_guard<std::mutex> lock(history_mutex_);
+    std::map<std::string_view, double> sample;
+    for (const auto& [underlying, price] : prices) {
+        if (price > 0.0) {
+            sample.emplace(underlying, price);
+        }
+    }
+
+    // Every known underlying gets a return per sample, so the histories
+    // stay aligned at their ends
+    for (auto& [underlying, last] : last_price_) {
+        auto it = sample.find(underlying);
+        double price = it != sample.end() ? it->second : last;
+        auto& returns = returns_[underlying];
+        returns.push_back(std::log(price / last));
+        if (returns.size() > kMaxSamples) {
+            returns.pop_front();
+        }
+        last = price;
+    }
+    for (const auto& [underlying, price] : sample) {
+        last_price_.emplace(std::string(underlying), price);
+    }
+}
+
+std::shared_ptr<const MonteCarloVar::Result> MonteCarloVar::run(const std::vector<Exposure>& exposures) {
+    std::lock_guard<std::mutex> lock(run_mutex_);
+    auto started = std::chrono::steady_clock::now();
+    Result result = simulate(exposures);
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    result.computed_at_ms = wall_clock_ms();
+
+    if (result.valid) {
+        var_gauge_.set(result.var);
+        shortfall_gauge_.set(result.expected_shortfall);
+    }
+    run_seconds_gauge_.set(result.seconds);
+    runs_.increment();
+
+    auto published = std::make_shared<const Result>(std::move(result));
+    std::atomic_store(&latest_, published);
+    return published;
+}
+
+MonteCarloVar::Result MonteCarloVar::simulate(const std::vector<Exposure>& exposures) {
+    Result result;
+    result.confidence = settings_.confidence;
+    result.horizon_seconds = static_cast<double>(settings_.horizon.count());
+
+    // One factor per underlying the book is exposed to
+    std::map<std::string, std::pair<double, double>, std::less<>> by_underlying;
+    for (const auto& exposure : exposures) {
+        if (exposure.delta != 0.0 || exposure.gamma != 0.0) {
+            auto& [delta, gamma] = by_underlying[exposure.underlying];
+            delta += exposure.delta;
+            gamma += exposure.gamma;
+        }
+    }
+    if (by_underlying.empty()) {
+        result.valid = true;  // Flat book, nothing at risk
+        return result;
+    }
+
+    // Returns for the covariance, aligned at their ends
+    size_t k = by_underlying.size();
+    std::vector<std::vector<double>> history;
+    {
+        std::lock_guard<std::mutex> lock(history_mutex_);
+        size_t samples = kMaxSamples;
+        for (const auto& [underlying, sensitivity] : by_underlying) {
+            auto it = returns_.find(underlying);
+            samples = std::min(samples, it == returns_.end() ? 0 : it->second.size());
+        }
+        if (samples < kMinSamples) {
+            result.error = "need " + std::to_string(kMinSamples) + " price samples per underlying, have " +
+                           std::to_string(samples);
+            return result;
+        }
+        for (const auto& [underlying, sensitivity] : by_underlying) {
+            const auto& returns = returns_.find(underlying)->second;
+            history.emplace_back(returns.end() - static_cast<std::ptrdiff_t>(samples), returns.end());
+        }
+        result.samples = samples;
+    }
+
+    // Zero-mean covariance of the sampled returns, scaled to the horizon
+    double scale = static_cast<double>(settings_.horizon.count()) /
+                   static_cast<double>(settings_.sample_interval.count());
+    std::vector<double> cov(k * k, 0.0);
+    for (size_t i = 0; i < k; ++i) {
+        for (size_t j = 0; j <= i; ++j) {
+            double sum = 0.0;
+            for (size_t t = 0; t < result.samples; ++t) {
+                sum += history[i][t] * history[j][t];
+            }
+            cov[i * k + j] = cov[j * k + i] = sum / static_cast<double>(result.samples) * scale;
+        }
+    }
+    std::vector<double> chol = cholesky(cov, k);
+
+    std::vector<double> delta, gamma;
+    for (const auto& [underlying, sensitivity] : by_underlying) {
+        result.factors.push_back({underlying, sensitivity.first, sensitivity.second, 0.0});
+        delta.push_back(sensitivity.first);
+        gamma.push_back(sensitivity.second * 100.0);  // Per 1% move to per unit return
+    }
+    for (size_t i = 0; i < k; ++i) {
+        result.factors[i].horizon_vol = std::sqrt(cov[i * k + i]);
+    }
+
+    // Whole batches per worker; the run may simulate a few more paths than asked
+    size_t workers = workers_.size();
+    size_t batches = std::max<size_t>(1, (settings_.paths + kBatch - 1) / kBatch);
+    size_t paths = batches * kBatch;
+    pnl_.resize(paths);
+    std::vector<double> sums(workers, 0.0), squares(workers, 0.0);
+    uint64_t run_seed = settings_.seed + runs_.load() * 0x9e3779b97f4a7c15ULL;
+
+    std::function<void(size_t)> job = [&](size_t worker) {
+        size_t first = batches * worker / workers;
+        size_t last = batches * (worker + 1) / workers;
+        LaneRng rng(run_seed ^ (0xd1b54a32d192ed03ULL * (worker + 1)));
+        std::vector<double> normals(k * kBatch), returns(kBatch);
+        double sum = 0.0, square = 0.0;
+
+        for (size_t batch = first; batch < last; ++batch) {
+            for (size_t j = 0; j < k; ++j) {
+                rng.fill_uniform(&normals[j * kBatch], kBatch);
+                to_normal(&normals[j * kBatch], kBatch);
+            }
+            double* pnl = &pnl_[batch * kBatch];
+            std::fill(pnl, pnl + kBatch, 0.0);
+            for (size_t i = 0; i < k; ++i) {
+                std::fill(returns.begin(), returns.end(), 0.0);
+                for (size_t j = 0; j <= i; ++j) {
+                    accumulate(returns.data(), &normals[j * kBatch], chol[i * k + j], kBatch);
+                }
+                price_factor(pnl, returns.data(), delta[i], gamma[i], kBatch);
+            }
+            for (size_t p = 0; p < kBatch; ++p) {
+                sum += pnl[p];
+                square += pnl[p] * pnl[p];
+            }
+        }
+        sums[worker] = sum;
+        squares[worker] = square;
+    };
+    run_on_workers(job);
+
+    double n = static_cast<double>(paths);
+    double sum = 0.0, square = 0.0;
+    for (size_t worker = 0; worker < workers; ++worker) {
+        sum += sums[worker];
+        square += squares[worker];
+    }
+    result.mean_pnl = sum / n;
+    result.stdev_pnl = std::sqrt(std::max(0.0, square / n - result.mean_pnl * result.mean_pnl));
+
+    // The worst (1 - confidence) of paths form the tail
+    size_t tail = std::max<size_t>(1, static_cast<size_t>(std::ceil((1.0 - settings_.confidence) * n)));
+    std::nth_element(pnl_.begin(), pnl_.begin() + static_cast<std::ptrdiff_t>(tail - 1), pnl_.end());
+    double tail_sum = 0.0;
+    for (size_t p = 0; p < tail; ++p) {
+        tail_sum += pnl_[p];
+    }
+    result.var = std::max(0.0, -pnl_[tail - 1]);
+    result.expected_shortfall = std::max(0.0, -tail_sum / static_cast<double>(tail));
+    result.paths = paths;
+    result.valid = true;
+    return result;
+}
+
+void MonteCarloVar::run_on_workers(const std::function<void(size_t)>& job) {
+    std::unique_lock<std::mutex> lock(job_mutex_);
+    job_ = &job;
+    jobs_pending_ = workers_.size();
+    ++job_generation_;
+    job_cv_.notify_all();
+    done_cv_.wait(lock, [this] { return jobs_pending_ == 0; });
+    job_ = nullptr;
+}
+
+void MonteCarloVar::worker_loop(size_t worker) {
+    ThreadLayout::process().apply("risk-" + std::to_string(worker));
+    uint64_t seen = 0;
+    for (;;) {
+        const std::function<void(size_t)>* job;
+        {
+            std::unique_lock<std::mutex> lock(job_mutex_);
+            job_cv_.wait(lock, [&] { return workers_stopping_ || job_generation_ != seen; });
+            if (workers_stopping_) {
+                return;
+            }
+            seen = job_generation_;
+            job = job_;
+        }
+        (*job)(worker);
+        std::lock_guard<std::mutex> lock(job_mutex_);
+        if (--jobs_pending_ == 0) {
+            done_cv_.notify_one();
+        }
+    }
+}
+
+void MonteCarloVar::start(ExposureSource source, ResultHandler handler) {
+    std::lock_guard<std::mutex> lock(periodic_mutex_);
+    if (periodic_running_) {
+        return;
+    }
+    periodic_running_ = true;
+    periodic_thread_ = std::thread(&MonteCarloVar::periodic_loop, this, std::move(source), std::move(handler));
+}
+
+void MonteCarloVar::stop() {
+    {
+        std::lock_guard<std::mutex> lock(periodic_mutex_);
+        periodic_running_ = false;
+    }
+    periodic_cv_.notify_all();
+    if (periodic_thread_.joinable()) {
+        periodic_thread_.join();
+    }
+}
+
+void MonteCarloVar::periodic_loop(ExposureSource source, ResultHandler handler) {
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(periodic_mutex_);
+            if (periodic_cv_.wait_for(lock, settings_.interval, [this] { return !periodic_running_; })) {
+                return;
+            }
+        }
+        try {
+            auto result = run(source());
+            if (!result->valid) {
+                spdlog::warn("VaR run skipped: {}", result->error);
+            }
+            if (handler) {
+                handler(*result);
+            }
+        } catch (const std::exception& e) {
+            spdlog::error("VaR run failed: {}", e.what());
+        }
+    }
+}
+
+void MonteCarloVar::register_metrics(MetricsServer& server) {
+    server.add_gauge("var_usd", "Monte Carlo value at risk of the book at the configured confidence",
+                     [this] { return var_gauge_.load(); });
+    server.add_gauge("var_expected_shortfall_usd", "Mean loss beyond the value at risk",
+                     [this] { return shortfall_gauge_.load(); });
+    server.add_gauge("var_run_seconds", "Wall time of the latest VaR run",
+                     [this] { return run_seconds_gauge_.load(); });
+    server.add_counter("var_runs_total", "VaR runs, periodic and on demand",
+                       [this] { return static_cast<double>(runs_.load()); });
+}
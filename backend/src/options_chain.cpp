@@ -0,0 +1,276 @@
+#include "options_chain.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include "fast_math.hpp"
+
+namespace {
+
+using namespace fast_math;
+
+constexpr double kYearMs = 365.0 * 86400000.0;
+constexpr double kMinVol = 1e-4;
+constexpr double kMaxVol = 10.0;
+constexpr double kPriceTolerance = 1e-6;  // Underlying units; Deribit ticks are 1e-4
+// Below this much time value the price carries no information about the vol
+constexpr double kMinTimeValue = 1e-5;
+
+// The lane loops take restrict pointers: with a dozen columns the
+// compiler would otherwise need more runtime alias checks than it is
+// willing to emit, and would leave the loops scalar
+void prepare_lanes(size_t n, const double* __restrict forward, const double* __restrict strike,
+                   const double* __restrict years, double* __restrict log_moneyness,
+                   double* __restrict moneyness, double* __restrict sqrt_years, double* __restrict vol) {
+    for (size_t i = 0; i < n; ++i) {
+        moneyness[i] = strike[i] / forward[i];
+        log_moneyness[i] = fast_log(forward[i] / strike[i]);
+        sqrt_years[i] = std::sqrt(years[i]);
+        double cold = std::sqrt(2.0 * std::fabs(log_moneyness[i]) / years[i]);
+        vol[i] = std::min(std::max(vol[i] > 0.0 ? vol[i] : cold, kMinVol), kMaxVol);
+    }
+}
+
+void newton_step(size_t n, const double* __restrict sign, const double* __restrict target,
+                 const double* __restrict log_moneyness, const double* __restrict moneyness,
+                 const double* __restrict sqrt_years, double* __restrict vol) {
+    for (size_t i = 0; i < n; ++i) {
+        double sd = vol[i] * sqrt_years[i];
+        double d1 = log_moneyness[i] / sd + 0.5 * sd;
+        double d2 = d1 - sd;
+        double s = sign[i];
+        double model = s * (norm_cdf(s * d1) - moneyness[i] * norm_cdf(s * d2));
+        double vega = std::max(norm_pdf(d1) * sqrt_years[i], 1e-12);
+        vol[i] = std::min(std::max(vol[i] - (model - target[i]) / vega, kMinVol), kMaxVol);
+    }
+}
+
+// Lanes whose target is outside the no-arbitrage bounds, or too close to
+// them to imply a vol, or that did not converge get zero vol and Greeks
+// and valid = 0
+void finish_lanes(size_t n, const double* __restrict forward, const double* __restrict sign,
+                  const double* __restrict target, const double* __restrict log_moneyness,
+                  const double* __restrict moneyness, const double* __restrict sqrt_years,
+                  double* __restrict vol, double* __restrict valid, double* __restrict price,
+                  double* __restrict delta, double* __restrict gamma, double* __restrict vega,
+                  double* __restrict theta) {
+    for (size_t i = 0; i < n; ++i) {
+        double s = sign[i];
+        double sd = vol[i] * sqrt_years[i];
+        double d1 = log_moneyness[i] / sd + 0.5 * sd;
+        double d2 = d1 - sd;
+        double model = s * (norm_cdf(s * d1) - moneyness[i] * norm_cdf(s * d2));
+        double intrinsic = std::max(s * (1.0 - moneyness[i]), 0.0);
+        double upper = s > 0.0 ? 1.0 : moneyness[i];
+        double keep = target[i] - intrinsic >= kMinTimeValue ? 1.0 : 0.0;
+        keep = upper - target[i] >= kMinTimeValue ? keep : 0.0;
+        keep = std::fabs(model - target[i]) <= kPriceTolerance ? keep : 0.0;
+
+        double pdf = norm_pdf(d1);
+        valid[i] = keep;
+        price[i] = keep * forward[i] * model;
+        delta[i] = keep * (norm_cdf(d1) - 0.5 * (1.0 - s));
+        gamma[i] = keep * pdf / (forward[i] * sd);
+        vega[i] = keep * forward[i] * pdf * sqrt_years[i] / 100.0;
+        theta[i] = keep * -forward[i] * pdf * vol[i] / (2.0 * sqrt_years[i]) / 365.0;
+        vol[i] *= keep;
+    }
+}
+
+}  // namespace
+
+void OptionsChain::Batch::resize(size_t n) {
+    index.resize(n);
+    for (auto* column : {&forward, &strike, &years, &sign, &target, &vol, &log_moneyness,
+                         &moneyness, &sqrt_years, &price, &delta, &gamma, &vega, &theta, &valid}) {
+        column->resize(n);
+    }
+}
+
+size_t OptionsChain::add_option(const std::string& instrument, const InstrumentSpec& spec) {
+    auto existing = index_.find(instrument);
+    if (existing != index_.end()) {
+        return existing->second;
+    }
+
+    auto expiry = std::lower_bound(expiries_.begin(), expiries_.end(), spec.expiration_ms);
+    uint32_t expiry_index;
+    if (expiry != expiries_.end() && *expiry == spec.expiration_ms) {
+        expiry_index = static_cast<uint32_t>(expiry - expiries_.begin());
+    } else {
+        // Keep expiries sorted; renumber the options of later expiries
+        expiry_index = static_cast<uint32_t>(expiry - expiries_.begin());
+        expiries_.insert(expiry, spec.expiration_ms);
+        expiry_members_.insert(expiry_members_.begin() + expiry_index, std::vector<uint32_t>{});
+        for (auto& of : expiry_of_) {
+            of += of >= expiry_index ? 1 : 0;
+        }
+        std::lock_guard<std::mutex> lock(input_mutex_);
+        forward_.insert(forward_.begin() + expiry_index, 0.0);
+    }
+
+    auto index = static_cast<uint32_t>(strike_.size());
+    instrument_.push_back(instrument);
+    index_.emplace(instrument_.back(), index);
+    strike_.push_back(spec.strike);
+    expiration_ms_.push_back(spec.expiration_ms);
+    sign_.push_back(spec.option_type == 'P' ? -1.0 : 1.0);
+    expiry_of_.push_back(expiry_index);
+    expiry_members_[expiry_index].push_back(index);
+    {
+        std::lock_guard<std::mutex> lock(input_mutex_);
+        bid_.push_back(0.0);
+        ask_.push_back(0.0);
+        dirty_.push_back(1);
+    }
+    std::lock_guard<std::mutex> lock(output_mutex_);
+    for (auto* column : {&iv_, &price_usd_, &delta_, &gamma_, &vega_, &theta_}) {
+        column->push_back(0.0);
+    }
+    valid_.push_back(0);
+    return index;
+}
+
+std::optional<size_t> OptionsChain::find(std::string_view instrument) const {
+    auto it = index_.find(instrument);
+    if (it == index_.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+void OptionsChain::update_quote(size_t index, double bid, double ask, double forward) {
+    std::lock_guard<std::mutex> lock(input_mutex_);
+    if (bid != bid_[index] || ask != ask_[index]) {
+        bid_[index] = bid;
+        ask_[index] = ask;
+        dirty_[index] = 1;
+    }
+
+    // Every option on the expiry prices off the same forward
+    uint32_t expiry = expiry_of_[index];
+    if (forward > 0.0 && forward != forward_[expiry]) {
+        forward_[expiry] = forward;
+        for (uint32_t member : expiry_members_[expiry]) {
+            dirty_[member] = 1;
+        }
+    }
+}
+
+size_t OptionsChain::refresh(int64_t now_ms) {
+    auto started = std::chrono::steady_clock::now();
+    size_t n = 0;
+    {
+        std::lock_guard<std::mutex> lock(input_mutex_);
+        bool full = now_ms - last_full_refresh_ms_ >= kFullRefreshInterval;
+        if (full) {
+            last_full_refresh_ms_ = now_ms;
+        }
+        batch_.resize(size());
+        for (size_t i = 0; i < size(); ++i) {
+            if (!full && !dirty_[i]) {
+                continue;
+            }
+            dirty_[i] = 0;
+
+            double forward = forward_[expiry_of_[i]];
+            double years = static_cast<double>(expiration_ms_[i] - now_ms) / kYearMs;
+            bool priced = bid_[i] > 0.0 && ask_[i] > 0.0 && forward > 0.0 && strike_[i] > 0.0 && years > 0.0;
+            // Unpriceable options still go through the kernel, with inputs
+            // that keep the arithmetic finite and a target it rejects
+            batch_.index[n] = static_cast<uint32_t>(i);
+            batch_.forward[n] = priced ? forward : 1.0;
+            batch_.strike[n] = priced ? strike_[i] : 1.0;
+            batch_.years[n] = priced ? years : 1.0;
+            batch_.sign[n] = sign_[i];
+            batch_.target[n] = priced ? 0.5 * (bid_[i] + ask_[i]) : 0.0;
+            batch_.vol[n] = valid_[i] ? iv_[i] : 0.0;  // Warm start; only this thread writes iv_
+            ++n;
+        }
+    }
+    if (n == 0) {
+        return 0;
+    }
+
+    solve(batch_, n);
+
+    {
+        std::lock_guard<std::mutex> lock(output_mutex_);
+        for (size_t j = 0; j < n; ++j) {
+            uint32_t i = batch_.index[j];
+            iv_[i] = batch_.vol[j];
+            price_usd_[i] = batch_.price[j];
+            delta_[i] = batch_.delta[j];
+            gamma_[i] = batch_.gamma[j];
+            vega_[i] = batch_.vega[j];
+            theta_[i] = batch_.theta[j];
+            valid_[i] = batch_.valid[j] > 0.0 ? 1 : 0;
+        }
+    }
+
+    recomputed_.increment(n);
+    last_refresh_seconds_.set(
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count());
+    return n;
+}
+
+// Newton on the forward-normalised Black-76 price, a fixed number of steps
+// for every lane so the loops stay branch-free. Cold lanes start at the
+// Manaster-Koehler point sqrt(2|ln(F/K)|/T), from which Newton converges
+// monotonically; warm lanes start from their last solution.
+void OptionsChain::solve(Batch& b, size_t n) {
+    prepare_lanes(n, b.forward.data(), b.strike.data(), b.years.data(), b.log_moneyness.data(),
+                  b.moneyness.data(), b.sqrt_years.data(), b.vol.data());
+    for (int iteration = 0; iteration < kNewtonIterations; ++iteration) {
+        newton_step(n, b.sign.data(), b.target.data(), b.log_moneyness.data(), b.moneyness.data(),
+                    b.sqrt_years.data(), b.vol.data());
+    }
+    finish_lanes(n, b.forward.data(), b.sign.data(), b.target.data(), b.log_moneyness.data(),
+                 b.moneyness.data(), b.sqrt_years.data(), b.vol.data(), b.valid.data(), b.price.data(),
+                 b.delta.data(), b.gamma.data(), b.vega.data(), b.theta.data());
+}
+
+OptionsChain::Option OptionsChain::option(size_t index) const {
+    Option option{};
+    option.instrument = instrument_[index];
+    option.expiration_ms = expiration_ms_[index];
+    option.strike = strike_[index];
+    option.call = sign_[index] > 0.0;
+    {
+        std::lock_guard<std::mutex> lock(input_mutex_);
+        option.bid = bid_[index];
+        option.ask = ask_[index];
+        option.forward = forward_[expiry_of_[index]];
+    }
+    std::lock_guard<std::mutex> lock(output_mutex_);
+    option.valid = valid_[index] != 0;
+    option.iv = iv_[index];
+    option.price_usd = price_usd_[index];
+    option.delta = delta_[index];
+    option.gamma = gamma_[index];
+    option.vega = vega_[index];
+    option.theta = theta_[index];
+    return option;
+}
+
+size_t OptionsChain::valid_count() const {
+    std::lock_guard<std::mutex> lock(output_mutex_);
+    return static_cast<size_t>(std::count(valid_.begin(), valid_.end(), 1));
+}
+
+void OptionsChain::register_metrics(MetricsServer& server) {
+    server.add_counter("options_recomputed_total", "Options repriced by chain refreshes",
+                       [this] { return static_cast<double>(recomputed_.load()); });
+    server.add_gauge("options_last_refresh_seconds", "Duration of the latest chain refresh",
+                     [this] { return last_refresh_seconds_.load(); });
+    server.add_gauge("options_valid", "Options with a solved implied volatility",
+                     [this] { return static_cast<double>(valid_count()); });
+}
+
+double OptionsChain::black76_price(double forward, double strike, double years, double vol, bool call) {
+    double sd = vol * std::sqrt(years);
+    double d1 = std::log(forward / strike) / sd + 0.5 * sd;
+    double d2 = d1 - sd;
+    auto cdf = [](double x) { return 0.5 * std::erfc(-x * kInvSqrt2); };
+    return call ? forward * cdf(d1) - strike * cdf(d2)
+                : strike * cdf(-d2) - forward * cdf(-d1);
+}
@@ -0,0 +1,73 @@
+#include "order_book.hpp"
+
+OrderBook::Update OrderBook::apply(const message_json& data) {
+    if (grouped_) {
+        replace_levels(bids_, data.at("bids"));
+        replace_levels(asks_, data.at("asks"));
+        change_id_ = data.at("change_id").get<int64_t>();
+        valid_ = true;
+        return Update::SNAPSHOT;
+    }
+
+    auto type = data.find("type");
+    bool snapshot = type != data.end() && type->is_string() &&
+                    type->get_ref<const arena_string&>() == "snapshot";
+
+    if (snapshot) {
+        clear();
+        apply_levels(bids_, data.at("bids"));
+        apply_levels(asks_, data.at("asks"));
+        change_id_ = data.at("change_id").get<int64_t>();
+        valid_ = true;
+        return Update::SNAPSHOT;
+    }
+
+    if (!valid_) {
+        return Update::IGNORED;
+    }
+
+    auto prev = data.find("prev_change_id");
+    if (prev == data.end() || prev->get<int64_t>() != change_id_) {
+        invalidate();
+        return Update::GAP;
+    }
+
+    apply_levels(bids_, data.at("bids"));
+    apply_levels(asks_, data.at("asks"));
+    change_id_ = data.at("change_id").get<int64_t>();
+    return Update::APPLIED;
+}
+
+void OrderBook::invalidate() {
+    valid_ = false;
+}
+
+void OrderBook::clear() {
+    bids_.clear();
+    asks_.clear();
+    change_id_ = 0;
+    valid_ = false;
+}
+
+// Levels are ["new"|"change"|"delete", price, amount]
+template <typename Levels>
+void OrderBook::apply_levels(Levels& levels, const message_json& updates) {
+    for (const auto& level : updates) {
+        const auto& action = level.at(0).get_ref<const arena_string&>();
+        double price = level.at(1).get<double>();
+        if (action == "delete") {
+            levels.erase(price);
+        } else {
+            levels[price] = level.at(2).get<double>();
+        }
+    }
+}
+
+// Grouped levels are [price, amount]
+template <typename Levels>
+void OrderBook::replace_levels(Levels& levels, const message_json& snapshot) {
+    levels.clear();
+    for (const auto& level : snapshot) {
+        levels.emplace(level.at(0).get<double>(), level.at(1).get<double>());
+    }
+}
@@ -0,0 +1,138 @@
+#include "order_encoder.hpp"
+#include <charconv>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+constexpr std::array<std::string_view, 3> kTimeInForce = {
+    "good_til_cancelled", "fill_or_kill", "immediate_or_cancel"
+};
+
+}  // namespace
+
+OrderTemplate::OrderTemplate(std::string_view instrument_name, std::string_view direction,
+                             std::string_view type, std::string_view time_in_force,
+                             bool post_only, bool reduce_only)
+    : has_price_(type.empty() || type == "limit") {
+    std::string method = "private/" + std::string(direction);
+    endpoint_ = "/" + method;
+
+    head_ = "{\"jsonrpc\":\"2.0\",\"id\":";
+    before_amount_ = ",\"method\":\"" + method + "\",\"params\":{\"instrument_name\":\"" +
+                     std::string(instrument_name) + "\",\"type\":\"" +
+                     std::string(type.empty() ? "limit" : type) + "\",\"amount\":";
+    before_price_ = ",\"price\":";
+
+    if (post_only) {
+        tail_ += ",\"post_only\":true";
+    }
+    if (reduce_only) {
+        tail_ += ",\"reduce_only\":true";
+    }
+    tail_ += ",\"time_in_force\":\"" +
+             std::string(time_in_force.empty() ? "good_til_cancelled" : time_in_force) + "\"}}";
+}
+
+void OrderTemplate::encode(std::string& out, uint64_t id, double amount, double price) const {
+    out.clear();
+    out.append(head_);
+    OrderEncoder::append_number(out, id);
+    out.append(before_amount_);
+    OrderEncoder::append_number(out, amount);
+    if (has_price_) {
+        out.append(before_price_);
+        OrderEncoder::append_number(out, price);
+    }
+    out.append(tail_);
+}
+
+OrderEncoder::OrderEncoder() {
+    buffer_.reserve(512);
+}
+
+void OrderEncoder::append_number(std::string& out, double value) {
+    if (!std::isfinite(value)) {
+        throw std::invalid_argument("Order numbers must be finite");
+    }
+    char digits[32];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, result.ptr);
+}
+
+void OrderEncoder::append_number(std::string& out, uint64_t value) {
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, result.ptr);
+}
+
+std::optional<size_t> OrderEncoder::variant_index(const OrderFields& order) {
+    size_t direction;
+    if (order.direction == "buy") {
+        direction = 0;
+    } else if (order.direction == "sell") {
+        direction = 1;
+    } else {
+        return std::nullopt;
+    }
+
+    size_t type;
+    if (order.type.empty() || order.type == "limit") {
+        type = 0;
+    } else if (order.type == "market") {
+        type = 1;
+    } else {
+        return std::nullopt;
+    }
+
+    size_t tif = kTimeInForce.size();
+    std::string_view requested = order.time_in_force.empty() ? kTimeInForce[0] : order.time_in_force;
+    for (size_t i = 0; i < kTimeInForce.size(); ++i) {
+        if (requested == kTimeInForce[i]) {
+            tif = i;
+        }
+    }
+    if (tif == kTimeInForce.size()) {
+        return std::nullopt;
+    }
+
+    return (((direction * 2 + type) * 2 + (order.post_only ? 1 : 0)) * 2 +
+            (order.reduce_only ? 1 : 0)) * kTimeInForce.size() + tif;
+}
+
+bool OrderEncoder::encode(const OrderFields& order, uint64_t id, Encoded& out) {
+    auto index = variant_index(order);
+    if (!index) {
+        return false;
+    }
+
+    auto instrument = templates_.find(order.instrument_name);
+    if (instrument == templates_.end()) {
+        instrument = templates_.emplace(std::string(order.instrument_name), InstrumentTemplates{}).first;
+    }
+
+    auto& slot = instrument->second[*index];
+    if (!slot) {
+        slot.emplace(order.instrument_name, order.direction, order.type, order.time_in_force,
+                     order.post_only, order.reduce_only);
+    }
+
+    if (slot->has_price() && order.price <= 0) {
+        throw std::invalid_argument("Limit order price must be positive");
+    }
+
+    slot->encode(buffer_, id, order.amount, order.price);
+    out.endpoint = slot->endpoint();
+    out.body = buffer_;
+    return true;
+}
+
+size_t OrderEncoder::template_count() const {
+    size_t count = 0;
+    for (const auto& [name, variants] : templates_) {
+        for (const auto& variant : variants) {
+            count += variant.has_value() ? 1 : 0;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,176 @@
+#include "portfolio_risk.hpp"
+#include <cmath>
+#include <stdexcept>
+
+PortfolioRisk::PortfolioRisk() : slots_(new Slot[kMaxInstruments]) {
+    // A SeqLock reads as zeros until its first store, which for limits
+    // would refuse everything
+    limits_.store(Limits{});
+}
+
+// Slots are only ever appended, as in MarketBoard, so lookups scan the
+// published prefix without a lock
+std::optional<size_t> PortfolioRisk::find(std::string_view instrument) const {
+    size_t count = count_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; ++i) {
+        if (slots_[i].instrument == instrument) {
+            return i;
+        }
+    }
+    return std::nullopt;
+}
+
+size_t PortfolioRisk::add_instrument(std::string_view instrument, const InstrumentSpec& spec) {
+    if (auto slot = find(instrument)) {
+        return *slot;
+    }
+
+    std::lock_guard<std::mutex> lock(update_mutex_);
+    size_t count = count_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < count; ++i) {
+        if (slots_[i].instrument == instrument) {
+            return i;
+        }
+    }
+    if (count == kMaxInstruments) {
+        throw std::length_error("PortfolioRisk is full");
+    }
+    slots_[count].instrument.assign(instrument);
+    slots_[count].spec = spec;
+    count_.store(count + 1, std::memory_order_release);
+    return count;
+}
+
+void PortfolioRisk::on_fill(size_t slot, double signed_amount) {
+    apply(slots_[slot], signed_amount, nullptr);
+}
+
+void PortfolioRisk::update_price(size_t slot, double mark) {
+    const InstrumentSpec& spec = slots_[slot].spec;
+    if (mark <= 0.0 || spec.kind == InstrumentKind::OPTION || spec.kind == InstrumentKind::OPTION_COMBO) {
+        return;
+    }
+    // Inverse futures are sized in USD, everything else in the coin
+    bool usd_amounts = spec.inverse && spec.kind != InstrumentKind::SPOT;
+    UnitRisk unit{usd_amounts ? 1.0 : mark, 0.0, 0.0, usd_amounts ? 1.0 : mark};
+    apply(slots_[slot], 0.0, &unit);
+}
+
+void PortfolioRisk::update_option(size_t slot, double forward, double delta, double gamma, double vega) {
+    if (forward <= 0.0) {
+        return;
+    }
+    // Option amounts are in the coin
+    UnitRisk unit{delta * forward, gamma * forward * forward * 0.01, vega, forward};
+    apply(slots_[slot], 0.0, &unit);
+}
+
+void PortfolioRisk::apply(Slot& slot, double position_change, const UnitRisk* unit) {
+    std::lock_guard<std::mutex> lock(update_mutex_);
+    State before = slot.state.load();
+    State after = before;
+    after.position += position_change;
+    if (unit) {
+        after.unit = *unit;
+    }
+
+    totals_.update([&](Exposure& totals) {
+        totals.delta += after.position * after.unit.delta - before.position * before.unit.delta;
+        totals.gamma += after.position * after.unit.gamma - before.position * before.unit.gamma;
+        totals.vega += after.position * after.unit.vega - before.position * before.unit.vega;
+        totals.gross_notional += std::fabs(after.position) * after.unit.notional -
+                                 std::fabs(before.position) * before.unit.notional;
+        totals.positions += after.position != 0.0 ? 1 : 0;
+        totals.positions -= before.position != 0.0 ? 1 : 0;
+        // Flat again: drop the rounding the running sums picked up
+        if (totals.positions == 0) {
+            totals = Exposure{};
+        }
+    });
+    slot.state.store(after);
+}
+
+PortfolioRisk::Breach PortfolioRisk::first_breach(const Exposure& before, const Exposure& after,
+                                                  const Limits& limits, double var) {
+    auto breaches = [](double was, double now, double limit) {
+        return std::fabs(now) > limit && std::fabs(now) > std::fabs(was);
+    };
+    if (breaches(before.delta, after.delta, limits.max_delta)) return Breach::DELTA;
+    if (breaches(before.gamma, after.gamma, limits.max_gamma)) return Breach::GAMMA;
+    if (breaches(before.vega, after.vega, limits.max_vega)) return Breach::VEGA;
+    if (breaches(before.gross_notional, after.gross_notional, limits.max_gross_notional)) return Breach::NOTIONAL;
+    // VaR is only recomputed periodically, so the order is judged by the
+    // delta it adds
+    if (var > limits.max_var && std::fabs(after.delta) > std::fabs(before.delta)) return Breach::VAR;
+    return Breach::NONE;
+}
+
+// The totals and the slot are read separately, so a concurrent update may
+// land between the two loads; either way the check sees a state at most
+// one update old
+PortfolioRisk::Breach PortfolioRisk::check_order(size_t slot, double signed_amount) const {
+    State state = slots_[slot].state.load();
+    if (state.unit.notional <= 0.0) {
+        rejected_.increment();
+        return Breach::UNPRICED;
+    }
+
+    Exposure before = totals_.load();
+    Exposure after = before;
+    after.delta += signed_amount * state.unit.delta;
+    after.gamma += signed_amount * state.unit.gamma;
+    after.vega += signed_amount * state.unit.vega;
+    after.gross_notional += (std::fabs(state.position + signed_amount) - std::fabs(state.position)) *
+                            state.unit.notional;
+
+    Breach breach = first_breach(before, after, limits_.load(), value_at_risk());
+    if (breach != Breach::NONE) {
+        rejected_.increment();
+    }
+    return breach;
+}
+
+bool PortfolioRisk::within_limits() const {
+    Exposure totals = totals_.load();
+    Limits limits = limits_.load();
+    return std::fabs(totals.delta) <= limits.max_delta &&
+           std::fabs(totals.gamma) <= limits.max_gamma &&
+           std::fabs(totals.vega) <= limits.max_vega &&
+           totals.gross_notional <= limits.max_gross_notional &&
+           value_at_risk() <= limits.max_var;
+}
+
+PortfolioRisk::Exposure PortfolioRisk::instrument_exposure(size_t slot) const {
+    State state = slots_[slot].state.load();
+    return Exposure{state.position * state.unit.delta, state.position * state.unit.gamma,
+                    state.position * state.unit.vega, std::fabs(state.position) * state.unit.notional,
+                    state.position != 0.0 ? 1u : 0u};
+}
+
+void PortfolioRisk::register_metrics(MetricsServer& server) {
+    server.add_gauge("portfolio_delta_usd", "Dollar delta across every position",
+                     [this] { return exposure().delta; });
+    server.add_gauge("portfolio_gamma_usd", "Change in dollar delta for a 1% move",
+                     [this] { return exposure().gamma; });
+    server.add_gauge("portfolio_vega_usd", "Change in value per vol point",
+                     [this] { return exposure().vega; });
+    server.add_gauge("portfolio_gross_notional_usd", "Gross notional across every position",
+                     [this] { return exposure().gross_notional; });
+    server.add_gauge("portfolio_positions", "Instruments with an open position",
+                     [this] { return static_cast<double>(exposure().positions); });
+    server.add_counter("portfolio_orders_refused_total", "Orders refused by the portfolio limits",
+                       [this] { return static_cast<double>(rejected_.load()); });
+}
+
+const char* PortfolioRisk::breach_name(Breach breach) {
+    switch (breach) {
+        case Breach::NONE: return "none";
+        case Breach::DELTA: return "delta";
+        case Breach::GAMMA: return "gamma";
+        case Breach::VEGA: return "vega";
+        case Breach::NOTIONAL: return "notional";
+        case Breach::VAR: return "var";
+        case Breach::UNPRICED: return "unpriced";
+    }
+    return "unknown";
+}
@@ -0,0 +1,167 @@
+#include "thread_layout.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <spdlog/spdlog.h>
+
+namespace {
+
+int parse_int(std::string_view text, std::string_view key) {
+    std::string value(text);
+    char* end = nullptr;
+    errno = 0;
+    long parsed = std::strtol(value.c_str(), &end, 10);
+    if (value.empty() || *end != '\0' || errno != 0 || parsed < 0 || parsed > 4096) {
+        throw std::invalid_argument("Bad value '" + value + "' for '" + std::string(key) + "'");
+    }
+    return static_cast<int>(parsed);
+}
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && text.front() == ' ') text.remove_prefix(1);
+    while (!text.empty() && text.back() == ' ') text.remove_suffix(1);
+    return text;
+}
+
+}  // namespace
+
+ThreadLayout ThreadLayout::parse(std::string_view spec) {
+    ThreadLayout layout;
+    while (!spec.empty()) {
+        auto comma = spec.find(',');
+        auto entry = trim(spec.substr(0, comma));
+        spec = comma == std::string_view::npos ? std::string_view{} : spec.substr(comma + 1);
+        if (entry.empty()) {
+            continue;
+        }
+
+        auto eq = entry.find('=');
+        if (eq == std::string_view::npos) {
+            throw std::invalid_argument("Expected key=value, got '" + std::string(entry) + "'");
+        }
+        auto key = trim(entry.substr(0, eq));
+        auto value = trim(entry.substr(eq + 1));
+
+        if (key == "wait") {
+            if (value == "spin") {
+                layout.wait_mode_ = WaitMode::SPIN;
+            } else if (value == "backoff") {
+                layout.wait_mode_ = WaitMode::BACKOFF;
+            } else {
+                throw std::invalid_argument("wait must be spin or backoff");
+            }
+        } else if (key == "mlock") {
+            layout.lock_memory_ = parse_int(value, key) != 0;
+        } else {
+            ThreadPlacement placement;
+            auto slash = value.find('/');
+            placement.cpu = parse_int(value.substr(0, slash), key);
+            if (slash != std::string_view::npos) {
+                placement.fifo_priority = parse_int(value.substr(slash + 1), key);
+                if (placement.fifo_priority < 1 || placement.fifo_priority > 99) {
+                    throw std::invalid_argument("SCHED_FIFO priority for '" + std::string(key) +
+                                                "' must be 1-99");
+                }
+            }
+            layout.placements_[std::string(key)] = placement;
+        }
+    }
+    return layout;
+}
+
+ThreadLayout& ThreadLayout::instance() {
+    static ThreadLayout layout = [] {
+        const char* spec = std::getenv("DERIBIT_THREAD_LAYOUT");
+        if (!spec) {
+            return ThreadLayout{};
+        }
+        try {
+            return parse(spec);
+        } catch (const std::exception& e) {
+            spdlog::error("Ignoring DERIBIT_THREAD_LAYOUT: {}", e.what());
+            return ThreadLayout{};
+        }
+    }();
+    return layout;
+}
+
+const ThreadLayout& ThreadLayout::process() {
+    return instance();
+}
+
+void ThreadLayout::configure(std::string_view spec) {
+    instance() = parse(spec);
+}
+
+ThreadPlacement ThreadLayout::placement(std::string_view thread_name) const {
+    auto it = placements_.find(thread_name);
+    if (it != placements_.end()) {
+        return it->second;
+    }
+    // md-1 falls back to md
+    auto dash = thread_name.rfind('-');
+    if (dash != std::string_view::npos) {
+        it = placements_.find(thread_name.substr(0, dash));
+        if (it != placements_.end()) {
+            return it->second;
+        }
+    }
+    return {};
+}
+
+std::string ThreadLayout::describe() const {
+    std::ostringstream out;
+    out << "wait=" << (wait_mode_ == WaitMode::SPIN ? "spin" : "backoff")
+        << " mlock=" << (lock_memory_ ? 1 : 0);
+    for (const auto& [name, placement] : placements_) {
+        out << " " << name << "=" << placement.cpu;
+        if (placement.fifo_priority > 0) {
+            out << "/" << placement.fifo_priority;
+        }
+    }
+    return out.str();
+}
+
+void ThreadLayout::apply(std::string_view thread_name) const {
+    // Kernel thread names are limited to 15 characters
+    std::string name(thread_name.substr(0, 15));
+    pthread_setname_np(pthread_self(), name.c_str());
+
+    ThreadPlacement placement = this->placement(thread_name);
+    if (placement.cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(placement.cpu, &cpus);
+        int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        if (rc != 0) {
+            spdlog::warn("Could not pin {} to CPU {}: {}", name, placement.cpu, std::strerror(rc));
+        } else {
+            spdlog::info("Pinned {} to CPU {}", name, placement.cpu);
+        }
+    }
+    if (placement.fifo_priority > 0) {
+        sched_param param{};
+        param.sched_priority = placement.fifo_priority;
+        int rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (rc != 0) {
+            spdlog::warn("Could not run {} under SCHED_FIFO {}: {}", name, placement.fifo_priority,
+                         std::strerror(rc));
+        }
+    }
+}
+
+void ThreadLayout::lock_memory_if_requested() const {
+    if (!lock_memory_) {
+        return;
+    }
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        spdlog::warn("mlockall failed: {}", std::strerror(errno));
+    } else {
+        spdlog::info("Process memory locked");
+    }
+}
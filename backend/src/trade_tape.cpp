@@ -0,0 +1,113 @@
+#include "trade_tape.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+TradeTape::TradeTape() : TradeTape(Settings{}) {}
+
+TradeTape::TradeTape(const Settings& settings) : settings_(settings) {
+    if (settings_.capacity == 0 || settings_.max_bars == 0) {
+        throw std::invalid_argument("TradeTape needs a capacity and max_bars");
+    }
+    ring_.resize(settings_.capacity);
+
+    double sizes[kBarKinds] = {settings_.tick_bar, settings_.volume_bar, settings_.dollar_bar};
+    for (size_t kind = 0; kind < kBarKinds; ++kind) {
+        builders_[kind].size = std::max(sizes[kind], 0.0);
+        if (builders_[kind].size > 0.0) {
+            builders_[kind].completed.reset(new SeqLock<Bar>[settings_.max_bars]);
+        }
+    }
+}
+
+void TradeTape::evict(int64_t now_ms) {
+    int64_t cutoff = now_ms - settings_.window.count();
+    while (size_ > 0 && (ring_[oldest_].timestamp_ms < cutoff || size_ == ring_.size())) {
+        const Trade& trade = ring_[oldest_];
+        volume_ -= trade.amount;
+        buy_volume_ -= trade.buy ? trade.amount : 0.0;
+        notional_ -= trade.price * trade.amount;
+        oldest_ = (oldest_ + 1) % ring_.size();
+        --size_;
+    }
+    // Drop the rounding the running sums picked up
+    if (size_ == 0) {
+        volume_ = buy_volume_ = notional_ = 0.0;
+    }
+}
+
+void TradeTape::on_trade(const Trade& trade) {
+    evict(trade.timestamp_ms);
+    ring_[(oldest_ + size_) % ring_.size()] = trade;
+    ++size_;
+    volume_ += trade.amount;
+    buy_volume_ += trade.buy ? trade.amount : 0.0;
+    notional_ += trade.price * trade.amount;
+    ++trades_;
+    last_ = trade;
+
+    for (size_t kind = 0; kind < kBarKinds; ++kind) {
+        if (builders_[kind].size > 0.0) {
+            add_to_bar(builders_[kind], static_cast<BarKind>(kind), trade);
+        }
+    }
+}
+
+void TradeTape::add_to_bar(Builder& builder, BarKind kind, const Trade& trade) {
+    Bar& bar = builder.current;
+    if (bar.trades == 0) {
+        bar = Bar{trade.timestamp_ms, trade.timestamp_ms, trade.price, trade.price, trade.price, trade.price,
+                  0.0, 0.0, 0.0, 0};
+    }
+    bar.close_ms = trade.timestamp_ms;
+    bar.high = std::max(bar.high, trade.price);
+    bar.low = std::min(bar.low, trade.price);
+    bar.close = trade.price;
+    bar.volume += trade.amount;
+    bar.buy_volume += trade.buy ? trade.amount : 0.0;
+    bar.notional += trade.price * trade.amount;
+    ++bar.trades;
+
+    double progress = kind == BarKind::TICK ? static_cast<double>(bar.trades)
+                    : kind == BarKind::VOLUME ? bar.volume
+                    : bar.notional;
+    if (progress < builder.size) {
+        return;
+    }
+    uint64_t count = builder.count.load(std::memory_order_relaxed);
+    builder.completed[count % settings_.max_bars].store(bar);
+    builder.count.store(count + 1, std::memory_order_release);
+    bar = Bar{};
+}
+
+void TradeTape::publish() {
+    stats_.store(Stats{trades_, last_.price, last_.timestamp_ms, static_cast<uint32_t>(size_), volume_,
+                       buy_volume_, notional_, volume_ > 0.0 ? notional_ / volume_ : 0.0});
+}
+
+std::vector<TradeTape::Bar> TradeTape::bars(BarKind kind, size_t count) const {
+    const Builder& builder = builders_[static_cast<size_t>(kind)];
+    std::vector<Bar> result;
+    if (!builder.completed) {
+        return result;
+    }
+    uint64_t completed = builder.count.load(std::memory_order_acquire);
+    uint64_t n = std::min<uint64_t>({count, completed, settings_.max_bars});
+    result.reserve(n);
+    for (uint64_t i = completed - n; i < completed; ++i) {
+        result.push_back(builder.completed[i % settings_.max_bars].load());
+    }
+    return result;
+}
+
+uint64_t TradeTape::bars_completed(BarKind kind) const {
+    return builders_[static_cast<size_t>(kind)].count.load(std::memory_order_acquire);
+}
+
+const char* TradeTape::bar_kind_name(BarKind kind) {
+    switch (kind) {
+        case BarKind::TICK: return "tick";
+        case BarKind::VOLUME: return "volume";
+        case BarKind::DOLLAR: return "dollar";
+    }
+    return "unknown";
+}
@@ -6,6 +6,8 @@
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/basic_file_sink.h>
 #include <sstream>
+#include <fstream>
+#include <future>
 
 TradingAgent::TradingAgent(DeribitTrader& trader_instance, 
                          const std::string& instrument,
@@ -16,6 +18,9 @@ TradingAgent::TradingAgent(DeribitTrader& trader_instance,
     , risk_level(risk)
     , current_strategy(strategy)
     , running(false)
+    , current_price(0.0)
+    , current_bid(0.0)
+    , current_ask(0.0)
     , total_profit(0.0)
     , daily_profit(0.0)
     , total_trades(0)
@@ -49,6 +54,7 @@ TradingAgent::TradingAgent(DeribitTrader& trader_instance,
     params = risk_params.at(risk_level);
     trading_start_time = std::chrono::system_clock::now();
     resetDailyMetrics();
+    publishSnapshot(true);
 }
 
 double TradingAgent::determineOptimalOrderSize() {
@@ -152,9 +158,13 @@ void TradingAgent::start() {
     // Subscribe to market data
     trader.subscribe_orderbook(current_instrument);
     trader.subscribe_trades(current_instrument);
+    trade_tape = trader.trade_tape(current_instrument);
 
-    // Wait a short time to gather initial market data
-    std::this_thread::sleep_for(std::chrono::seconds(5));
+    // Seed indicators from recent history instead of waiting on the poller,
+    // unless startup already did and the feed has kept it current
+    if (price_history.size() < static_cast<size_t>(params.lookback_period)) {
+        backfillPriceHistory();
+    }
 
     // Determine initial order parameters
     std::string direction = determineInitialOrderDirection();
@@ -188,6 +198,7 @@ void TradingAgent::start() {
             open_positions.push_back(pos);
             position_history[order_id] = pos;
             last_trade_time = std::chrono::system_clock::now();
+            reportFill(direction, order.amount);
             
             spdlog::info("Initial position entered - Order ID: {}, Direction: {}, Amount: {}, Price: {}", 
                         order_id, direction, order_size, pos.entry_price);
@@ -198,20 +209,152 @@ void TradingAgent::start() {
     catch (const std::exception& e) {
         spdlog::error("Error placing initial order: {}", e.what());
     }
+    publishMetrics();
+    publishSnapshot(true);
+}
+
+void TradingAgent::backfillPriceHistory() {
+    auto started = std::chrono::steady_clock::now();
+    size_t needed = static_cast<size_t>(params.lookback_period);
+
+    // Fetch recent trades, one-minute candles and the top of book concurrently
+    auto now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    auto window_ms = static_cast<int64_t>(needed + 1) * 60 * 1000;
+
+    auto trades_future = std::async(std::launch::async, [&] {
+        return trader.get_last_trades(current_instrument, static_cast<int>(needed));
+    });
+    auto chart_future = std::async(std::launch::async, [&] {
+        return trader.get_tradingview_chart_data(current_instrument, now_ms - window_ms, now_ms);
+    });
+    auto book_future = std::async(std::launch::async, [&] {
+        return trader.get_orderbook(current_instrument, 1);
+    });
+
+    std::vector<double> trade_prices;
+    try {
+        json response = trades_future.get();
+        if (response.contains("result") && response["result"].contains("trades")) {
+            std::vector<std::pair<int64_t, double>> trades;
+            for (const auto& trade : response["result"]["trades"]) {
+                trades.emplace_back(trade.value("timestamp", int64_t{0}), trade["price"].get<double>());
+            }
+            std::sort(trades.begin(), trades.end());
+            for (const auto& trade : trades) {
+                trade_prices.push_back(trade.second);
+            }
+        }
+    } catch (const std::exception& e) {
+        spdlog::warn("Trade history backfill failed: {}", e.what());
+    }
+
+    std::vector<double> candle_closes;
+    try {
+        json response = chart_future.get();
+        if (response.contains("result") && response["result"].contains("close")) {
+            for (const auto& close : response["result"]["close"]) {
+                candle_closes.push_back(close.get<double>());
+            }
+        }
+    } catch (const std::exception& e) {
+        spdlog::warn("Chart data backfill failed: {}", e.what());
+    }
+
+    try {
+        json response = book_future.get();
+        if (response.contains("result")) {
+            const auto& result = response["result"];
+            if (result.contains("bids") && !result["bids"].empty() &&
+                result.contains("asks") && !result["asks"].empty()) {
+                current_bid = result["bids"][0][0].get<double>();
+                current_ask = result["asks"][0][0].get<double>();
+                current_price = (current_bid + current_ask) / 2;
+            }
+        }
+    } catch (const std::exception& e) {
+        spdlog::warn("Order book backfill failed: {}", e.what());
+    }
+
+    // Prefer tick-level trades, then candles, then locally recorded prices
+    std::vector<double> prices;
+    std::string source;
+    if (trade_prices.size() >= needed) {
+        prices = std::move(trade_prices);
+        source = "trades";
+    } else if (candle_closes.size() >= needed) {
+        prices = std::move(candle_closes);
+        source = "chart";
+    } else {
+        prices = loadRecordedPrices();
+        source = "recorded";
+        if (prices.size() < needed) {
+            prices = trade_prices.size() >= candle_closes.size() ? trade_prices : candle_closes;
+            source = "partial";
+        }
+    }
+
+    if (prices.size() > needed) {
+        prices.erase(prices.begin(), prices.end() - needed);
+    }
+
+    price_history.assign(prices.begin(), prices.end());
+    if (current_price <= 0.0 && !price_history.empty()) {
+        current_price = price_history.back();
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - started).count();
+    spdlog::info("Backfilled {} of {} prices from {} in {} ms", 
+                 price_history.size(), needed, source, elapsed);
+}
+
+std::vector<double> TradingAgent::loadRecordedPrices() const {
+    std::vector<double> prices;
+    if (backfill_file.empty()) {
+        return prices;
+    }
+
+    std::ifstream file(backfill_file);
+    if (!file.is_open()) {
+        spdlog::warn("Could not open backfill file: {}", backfill_file);
+        return prices;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        try {
+            // Accept either "price" or "timestamp,price" lines
+            auto comma = line.find_last_of(',');
+            prices.push_back(std::stod(comma == std::string::npos ? line : line.substr(comma + 1)));
+        } catch (const std::exception&) {
+            continue;
+        }
+    }
+    return prices;
 }
 
 void TradingAgent::stop() {
     running = false;
-    // Close all open positions
+    // Close all open positions; inline exits remove them as they complete
+    std::vector<std::string> order_ids;
     for (const auto& position : open_positions) {
-        exitPosition(position.order_id);
+        order_ids.push_back(position.order_id);
     }
+    for (const auto& order_id : order_ids) {
+        exitPosition(order_id);
+    }
+    publishMetrics();
+    publishSnapshot(true);
     spdlog::info("Automated trading stopped. Final profit: {}", total_profit);
 }
 
 
 
 void TradingAgent::updatePrice(double price, double bid_price, double ask_price) {
+    last_tick_time = LatencyTracker::now();
+    LatencyTracker::ScopedTimer update_timer(trader.latency(), LatencyStage::PRICE_UPDATE);
+
     current_price = price;
     current_bid = bid_price;
     current_ask = ask_price;
@@ -221,10 +364,15 @@ void TradingAgent::updatePrice(double price, double bid_price, double ask_price)
         price_history.pop_front();
     }
     
+    if (portfolio_risk) {
+        portfolio_risk->update_price(risk_slot, price);
+    }
     if (running) {
         updatePositionPnL();  // Update P&L for existing positions
         processSignal();      // Check for new trading signals
     }
+    publishMetrics();
+    publishSnapshot();
 
     // Log current state
     spdlog::info("Price Update - Bid: {}, Ask: {}, Mid: {}", bid_price, ask_price, price);
@@ -234,11 +382,31 @@ void TradingAgent::updatePrice(double price, double bid_price, double ask_price)
 }
 
 void TradingAgent::processSignal() {
+    LatencyTracker::ScopedTimer signal_timer(trader.latency(), LatencyStage::SIGNAL);
+
+    // No new entries while the feed is down or books are resyncing; logged
+    // on the transitions only, since ticks keep arriving meanwhile
+    bool stale = trader.market_data_stale();
+    if (stale != market_data_stale) {
+        market_data_stale = stale;
+        if (stale) {
+            spdlog::warn("Market data stale, skipping signal evaluation");
+        } else {
+            spdlog::info("Market data fresh again, evaluating signals");
+        }
+    }
+    if (stale) {
+        return;
+    }
+
     if (!checkTradeTimeRestrictions() || !checkRiskLimits()) {
         return;
     }
 
-    if (price_history.size() < params.lookback_period) {
+    // The book strategies read the feature engine instead of the history
+    bool book_strategy = current_strategy == Strategy::ORDER_FLOW ||
+                         current_strategy == Strategy::BOOK_IMBALANCE;
+    if (!book_strategy && price_history.size() < params.lookback_period) {
         spdlog::info("Insufficient price history. Current size: {}", price_history.size());
         return;
     }
@@ -286,10 +454,51 @@ void TradingAgent::processSignal() {
                 }
                 break;
             }
+
+            case Strategy::ORDER_FLOW: {
+                auto features = trader.market_board().features(current_instrument);
+                if (!features || !features->valid) {
+                    break;
+                }
+                spdlog::info("OFI ratio: {}, signed volume ratio: {}", features->ofi_ratio,
+                             features->volume_ratio);
+                if (features->ofi_ratio > kFlowEntryRatio && features->volume_ratio > kVolumeConfirmRatio) {
+                    should_enter = true;
+                    direction = "buy";
+                } else if (features->ofi_ratio < -kFlowEntryRatio &&
+                           features->volume_ratio < -kVolumeConfirmRatio) {
+                    should_enter = true;
+                    direction = "sell";
+                }
+                break;
+            }
+
+            case Strategy::BOOK_IMBALANCE: {
+                auto features = trader.market_board().features(current_instrument);
+                if (!features || !features->valid) {
+                    break;
+                }
+                // The microprice sits past the mid toward the thin side
+                spdlog::info("Microprice: {}, top imbalance: {}, depth imbalance: {}", features->microprice,
+                             features->top_imbalance, features->depth_imbalance);
+                if (features->top_imbalance > kImbalanceEntry && features->depth_imbalance > kDepthConfirm) {
+                    should_enter = true;
+                    direction = "buy";
+                } else if (features->top_imbalance < -kImbalanceEntry &&
+                           features->depth_imbalance < -kDepthConfirm) {
+                    should_enter = true;
+                    direction = "sell";
+                }
+                break;
+            }
         }
 
         // Check if we can enter a new position
-        if (should_enter && open_positions.empty()) {
+        if (should_enter) {
+            signals_counter.increment();
+        }
+
+        if (should_enter && open_positions.empty() && entries_in_flight == 0) {
             spdlog::info("Signal detected: {} signal for {}", direction, current_instrument);
             enterPosition(direction);
         }
@@ -315,114 +524,199 @@ void TradingAgent::enterPosition(const std::string& direction) {
             order_price = current_bid * 0.995;  // 0.5% below bid price
         }
 
-        // Create order request with more robust parameters
-        DeribitTrader::OrderRequest order{
-            .instrument_name = current_instrument,
-            .direction = direction,
-            .amount = std::max(1.0, position_size * 1000),  // Ensure minimum order size
-            .price = order_price,
-            .type = "limit",
-            .post_only = false,
-            .reduce_only = false
-        };
+        OrderIntent intent;
+        intent.kind = OrderKind::ENTRY;
+        intent.tick_time = last_tick_time;
+        auto& order = intent.request;
+        order.instrument_name = current_instrument;
+        order.direction = direction;
+        order.amount = std::max(1.0, position_size * 1000);  // Ensure minimum order size
+        // Stay a small part of what actually trades
+        if (trade_tape) {
+            auto tape_stats = trade_tape->stats();
+            if (tape_stats.window_volume > 0.0) {
+                order.amount = std::max(1.0, std::min(order.amount, kMaxVolumeShare * tape_stats.window_volume));
+            }
+        }
+        order.price = order_price;
+        order.type = "limit";
+        order.post_only = false;
+        order.reduce_only = false;
+        order.time_in_force = "good_til_cancelled";
         
+        if (portfolio_risk) {
+            auto breach = portfolio_risk->check_order(risk_slot, direction == "buy" ? order.amount : -order.amount);
+            if (breach != PortfolioRisk::Breach::NONE) {
+                spdlog::warn("Entry {} {} refused by the portfolio {} limit", direction, current_instrument,
+                             PortfolioRisk::breach_name(breach));
+                return;
+            }
+        }
+
         spdlog::info("Placing {} order: Amount = {}, Price = {}", 
                      direction, order.amount, order.price);
 
-        // Place order with multiple retry mechanism
-        std::string order_id;
-        int max_retries = 3;
-        for (int retry = 0; retry < max_retries; ++retry) {
-            try {
-                order_id = trader.place_order(order);
-                if (!order_id.empty()) {
-                    break;  // Successful order placement
-                }
-            } catch (const std::exception& e) {
-                spdlog::error("Order placement attempt {} failed: {}", retry + 1, e.what());
-                std::this_thread::sleep_for(std::chrono::seconds(1));  // Wait before retry
-            }
+        submitOrder(std::move(intent));
+    } catch (const std::exception& e) {
+        spdlog::error("Comprehensive position entry failed: {}", e.what());
+    }
+}
+
+void TradingAgent::exitPosition(const std::string& order_id) {
+    try {
+        // Find the position
+        auto it = std::find_if(open_positions.begin(), open_positions.end(),
+            [&](const Position& pos) { return pos.order_id == order_id; });
+            
+        if (it == open_positions.end()) {
+            return;
         }
-        
-        if (order_id.empty()) {
-            spdlog::error("Failed to place order after {} attempts", max_retries);
+
+        if (it->exit_pending) {
             return;
         }
-        
+
+        // Create exit order
+        OrderIntent intent;
+        intent.kind = OrderKind::EXIT;
+        intent.position_id = order_id;
+        intent.tick_time = last_tick_time;
+        auto& order = intent.request;
+        order.instrument_name = current_instrument;
+        order.direction = (it->direction == "buy") ? "sell" : "buy";
+        order.amount = it->amount;
+        order.price = (it->direction == "buy") ? current_bid : current_ask;
+        order.type = "market";
+        order.post_only = false;
+        order.reduce_only = true;
+        order.time_in_force = "good_til_cancelled";
+
+        submitOrder(std::move(intent));
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to exit position: {}", e.what());
+    }
+}
+
+// Hands the order to the sink, or places it inline when there is none
+bool TradingAgent::submitOrder(OrderIntent&& intent) {
+    setInFlight(intent, true);
+    if (!order_sink) {
+        onOrderAck(executeOrder(trader, std::move(intent)));
+        return true;
+    }
+    if (order_sink(intent)) {
+        return true;
+    }
+
+    setInFlight(intent, false);
+    spdlog::warn("Order queue full, dropping {} order for {}",
+                 intent.kind == OrderKind::ENTRY ? "entry" : "exit", intent.request.instrument_name);
+    return false;
+}
+
+void TradingAgent::setInFlight(const OrderIntent& intent, bool in_flight) {
+    if (intent.kind == OrderKind::ENTRY) {
+        entries_in_flight += in_flight ? 1 : -1;
+        return;
+    }
+    for (auto& position : open_positions) {
+        if (position.order_id == intent.position_id) {
+            position.exit_pending = in_flight;
+            return;
+        }
+    }
+}
+
+TradingAgent::OrderAck TradingAgent::executeOrder(DeribitTrader& trader, OrderIntent&& intent) {
+    OrderAck ack;
+    // Exits are not retried here; the next tick re-triggers a failed exit
+    int max_retries = intent.kind == OrderKind::ENTRY ? 3 : 1;
+    for (int retry = 0; retry < max_retries && ack.order_id.empty(); ++retry) {
+        try {
+            ack.order_id = trader.place_order(intent.request);
+        } catch (const std::exception& e) {
+            ack.error = e.what();
+            spdlog::error("Order placement attempt {} failed: {}", retry + 1, e.what());
+            if (retry + 1 < max_retries) {
+                std::this_thread::sleep_for(std::chrono::seconds(1));  // Wait before retry
+            }
+        }
+    }
+
+    if (!ack.order_id.empty() && intent.kind == OrderKind::ENTRY) {
+        trader.latency().record(LatencyStage::TICK_TO_ORDER, intent.tick_time, LatencyTracker::now());
+    }
+    ack.intent = std::move(intent);
+    return ack;
+}
+
+void TradingAgent::onOrderAck(const OrderAck& ack) {
+    const OrderIntent& intent = ack.intent;
+    setInFlight(intent, false);
+
+    if (ack.order_id.empty()) {
+        spdlog::error("{} order for {} failed: {}", intent.kind == OrderKind::ENTRY ? "Entry" : "Exit",
+                      intent.request.instrument_name, ack.error.empty() ? "no order id" : ack.error);
+        return;
+    }
+
+    if (intent.kind == OrderKind::ENTRY) {
         // Record position
         Position pos{
-            .order_id = order_id,
-            .direction = direction,
-            .entry_price = order_price,
-            .amount = order.amount,
+            .order_id = ack.order_id,
+            .direction = intent.request.direction,
+            .entry_price = intent.request.price,
+            .amount = intent.request.amount,
             .current_pnl = 0.0,
             .highest_pnl = 0.0,
             .lowest_pnl = 0.0,
             .entry_time = std::chrono::system_clock::now()
         };
-        
+
         open_positions.push_back(pos);
-        position_history[order_id] = pos;
+        position_history[ack.order_id] = pos;
         last_trade_time = std::chrono::system_clock::now();
-        
-        spdlog::info("Position entered - Order ID: {}, Direction: {}, Price: {}", 
-                    order_id, direction, pos.entry_price);
-    } catch (const std::exception& e) {
-        spdlog::error("Comprehensive position entry failed: {}", e.what());
-    }
-}
+        reportFill(pos.direction, pos.amount);
 
-void TradingAgent::exitPosition(const std::string& order_id) {
-    try {
-        // Find the position
+        spdlog::info("Position entered - Order ID: {}, Direction: {}, Price: {}", 
+                    ack.order_id, pos.direction, pos.entry_price);
+    } else {
         auto it = std::find_if(open_positions.begin(), open_positions.end(),
-            [&](const Position& pos) { return pos.order_id == order_id; });
-            
+            [&](const Position& pos) { return pos.order_id == intent.position_id; });
         if (it == open_positions.end()) {
             return;
         }
 
-        // Create exit order
-        DeribitTrader::OrderRequest order{
-            .instrument_name = current_instrument,
-            .direction = (it->direction == "buy") ? "sell" : "buy",
-            .amount = it->amount,
-            .price = (it->direction == "buy") ? current_bid : current_ask,
-            .type = "market",
-            .post_only = false,
-            .reduce_only = true
-        };
-        
-        std::string exit_order_id = trader.place_order(order);
-        
-        if (!exit_order_id.empty()) {
-            // Update metrics
-            double exit_price = (it->direction == "buy") ? current_bid : current_ask;
-            double pnl = it->current_pnl;
-            
-            total_profit += pnl;
-            daily_profit += pnl;
-            total_trades++;
-            
-            if (pnl > 0) {
-                winning_trades++;
-            }
-            
-            highest_profit = std::max(highest_profit, pnl);
-            biggest_loss = std::min(biggest_loss, pnl);
-            
-            // Log the trade
-            spdlog::info("Exited position {} with PnL: {}", order_id, pnl);
-            
-            // Remove from open positions
-            open_positions.erase(it);
+        reportFill(intent.request.direction, intent.request.amount);
+
+        // Update metrics
+        double pnl = it->current_pnl;
+
+        total_profit += pnl;
+        daily_profit += pnl;
+        total_trades++;
+        trades_counter.increment();
+
+        if (pnl > 0) {
+            winning_trades++;
         }
-    } catch (const std::exception& e) {
-        spdlog::error("Failed to exit position: {}", e.what());
+
+        highest_profit = std::max(highest_profit, pnl);
+        biggest_loss = std::min(biggest_loss, pnl);
+
+        // Log the trade
+        spdlog::info("Exited position {} with PnL: {}", intent.position_id, pnl);
+
+        // Remove from open positions
+        open_positions.erase(it);
     }
+    publishMetrics();
+    publishSnapshot(true);
 }
 
 void TradingAgent::updatePositionPnL() {
+    // Exits run after the loop; an inline exit removes the position
+    std::vector<std::string> exits;
     for (auto& position : open_positions) {
         // Calculate current P&L
         double current_market_price = (position.direction == "buy") ? current_bid : current_ask;
@@ -441,13 +735,18 @@ void TradingAgent::updatePositionPnL() {
         // Check stop loss and take profit
         double pnl_percentage = price_diff / position.entry_price;
         
-        if (pnl_percentage <= -params.stop_loss || 
-            pnl_percentage >= params.take_profit) {
+        if (!position.exit_pending &&
+            (pnl_percentage <= -params.stop_loss || 
+             pnl_percentage >= params.take_profit)) {
             spdlog::info("SL/TP triggered for order {}: P&L = {}%", 
                         position.order_id, pnl_percentage * 100);
-            exitPosition(position.order_id);
+            exits.push_back(position.order_id);
         }
     }
+
+    for (const auto& order_id : exits) {
+        exitPosition(order_id);
+    }
 }
 
 bool TradingAgent::checkMomentumSignal() {
@@ -576,6 +875,8 @@ bool TradingAgent::checkTradeTimeRestrictions() {
 }
 
 bool TradingAgent::checkRiskLimits() {
+    LatencyTracker::ScopedTimer risk_timer(trader.latency(), LatencyStage::RISK_CHECK);
+
     // Check daily loss limit
     if (daily_profit < -params.max_loss_daily) {
         spdlog::warn("Daily loss limit reached. Stopping trading.");
@@ -590,11 +891,17 @@ bool TradingAgent::checkRiskLimits() {
         return false;
     }
     
-    // Check maximum positions
-    if (open_positions.size() >= params.max_open_positions) {
+    // Check maximum positions, counting entries still waiting for an ack
+    if (open_positions.size() + entries_in_flight >= params.max_open_positions) {
         return false;
     }
     
+    // The whole book's exposure when a portfolio is attached; the order's
+    // own direction is checked again at entry
+    if (portfolio_risk) {
+        return portfolio_risk->within_limits();
+    }
+
     // Check maximum position size
     double total_position_size = 0.0;
     for (const auto& pos : open_positions) {
@@ -604,6 +911,13 @@ bool TradingAgent::checkRiskLimits() {
     return total_position_size < params.max_position_size;
 }
 
+// Orders are treated as filled once acknowledged, as for open_positions
+void TradingAgent::reportFill(const std::string& direction, double amount) {
+    if (portfolio_risk) {
+        portfolio_risk->on_fill(risk_slot, direction == "buy" ? amount : -amount);
+    }
+}
+
 void TradingAgent::resetDailyMetrics() {
     daily_profit = 0.0;
     daily_reset_time = std::chrono::system_clock::now();
@@ -624,22 +938,32 @@ double TradingAgent::getWinRate() const {
            (static_cast<double>(winning_trades) / total_trades) * 100.0 : 0.0;
 }
 
+double TradingAgent::AgentSnapshot::winRate() const {
+    return total_trades > 0 ?
+           (static_cast<double>(winning_trades) / total_trades) * 100.0 : 0.0;
+}
+
+// Owner thread only; readers on other threads use snapshot()
 std::string TradingAgent::getStrategyStatus() const {
+    return formatStatus(makeSnapshot());
+}
+
+std::string TradingAgent::formatStatus(const AgentSnapshot& snapshot) {
     std::stringstream ss;
     ss << "Trading Strategy Status:\n"
-       << "Strategy: " << static_cast<int>(current_strategy) << "\n"
-       << "Risk Level: " << static_cast<int>(risk_level) << "\n"
-       << "Total Profit: " << total_profit << "\n"
-       << "Daily Profit: " << daily_profit << "\n"
-       << "Win Rate: " << getWinRate() << "%\n"
-       << "Total Trades: " << total_trades << "\n"
-       << "Open Positions: " << open_positions.size() << "\n"
-       << "Highest Profit: " << highest_profit << "\n"
-       << "Biggest Loss: " << biggest_loss << "\n";
-
-    if (!open_positions.empty()) {
+       << "Strategy: " << static_cast<int>(snapshot.strategy) << "\n"
+       << "Risk Level: " << static_cast<int>(snapshot.risk_level) << "\n"
+       << "Total Profit: " << snapshot.total_profit << "\n"
+       << "Daily Profit: " << snapshot.daily_pnl << "\n"
+       << "Win Rate: " << snapshot.winRate() << "%\n"
+       << "Total Trades: " << snapshot.total_trades << "\n"
+       << "Open Positions: " << snapshot.positions.size() << "\n"
+       << "Highest Profit: " << snapshot.highest_profit << "\n"
+       << "Biggest Loss: " << snapshot.biggest_loss << "\n";
+
+    if (!snapshot.positions.empty()) {
         ss << "\nCurrent Positions:\n";
-        for (const auto& pos : open_positions) {
+        for (const auto& pos : snapshot.positions) {
             ss << "Order ID: " << pos.order_id << "\n"
                << "Direction: " << pos.direction << "\n"
                << "Entry Price: " << pos.entry_price << "\n"
@@ -652,8 +976,75 @@ std::string TradingAgent::getStrategyStatus() const {
     return ss.str();
 }
 
+void TradingAgent::registerMetrics(MetricsServer& server) {
+    // Labelled by instrument so agents sharing a server export distinct series
+    MetricsServer::Labels labels{{"instrument", current_instrument}};
+    server.add_gauge("agent_open_positions", "Open positions held by the agent",
+                     [this] { return open_positions_gauge.load(); }, labels);
+    server.add_gauge("agent_unrealized_pnl", "Unrealized PnL across open positions",
+                     [this] { return unrealized_pnl_gauge.load(); }, labels);
+    server.add_gauge("agent_daily_pnl", "Realized PnL since the last daily reset",
+                     [this] { return daily_pnl_gauge.load(); }, labels);
+    server.add_gauge("agent_total_profit", "Realized PnL since the agent started",
+                     [this] { return total_profit_gauge.load(); }, labels);
+    server.add_counter("agent_signals_total", "Entry signals produced by the strategy",
+                       [this] { return static_cast<double>(signals_counter.load()); }, labels);
+    server.add_counter("agent_trades_total", "Positions closed by the agent",
+                       [this] { return static_cast<double>(trades_counter.load()); }, labels);
+}
+
+void TradingAgent::publishMetrics() {
+    open_positions_gauge.set(static_cast<double>(open_positions.size()));
+    unrealized_pnl_gauge.set(getCurrentPnL());
+    daily_pnl_gauge.set(daily_profit);
+    total_profit_gauge.set(total_profit);
+    snapshot_dirty = true;
+}
+
+TradingAgent::AgentSnapshot TradingAgent::makeSnapshot() const {
+    AgentSnapshot snapshot;
+    snapshot.running = running;
+    snapshot.strategy = current_strategy;
+    snapshot.risk_level = risk_level;
+    snapshot.current_price = current_price;
+    snapshot.unrealized_pnl = getCurrentPnL();
+    snapshot.daily_pnl = daily_profit;
+    snapshot.total_profit = total_profit;
+    snapshot.total_trades = total_trades;
+    snapshot.winning_trades = winning_trades;
+    snapshot.highest_profit = highest_profit;
+    snapshot.biggest_loss = biggest_loss;
+    snapshot.entries_in_flight = entries_in_flight;
+    snapshot.positions = open_positions;
+    snapshot.sequence = published_snapshot ? published_snapshot->sequence + 1 : 1;
+    snapshot.published_at = std::chrono::system_clock::now();
+    return snapshot;
+}
+
+// Copies are made here, on the owner thread, at most once per interval;
+// readers only bump a reference count
+void TradingAgent::publishSnapshot(bool force) {
+    auto now = LatencyTracker::now();
+    if (!force && (!snapshot_dirty || now - last_snapshot_time < kSnapshotInterval)) {
+        return;
+    }
+    std::atomic_store(&published_snapshot,
+                      std::shared_ptr<const AgentSnapshot>(std::make_shared<AgentSnapshot>(makeSnapshot())));
+    snapshot_dirty = false;
+    last_snapshot_time = now;
+}
+
+void TradingAgent::setPortfolioRisk(PortfolioRisk* risk) {
+    if (risk) {
+        auto spec = trader.instrument_spec(current_instrument);
+        risk_slot = risk->add_instrument(current_instrument, spec.value_or(InstrumentSpec{}));
+    }
+    portfolio_risk = risk;
+}
+
 void TradingAgent::setTradingParams(const TradingParams& new_params) {
     params = new_params;
+    publishSnapshot(true);
     spdlog::info("Updated trading parameters");
 }
 
@@ -676,12 +1067,14 @@ double TradingAgent::getDailyPnL() const {
 void TradingAgent::setRiskLevel(RiskLevel risk) {
     risk_level = risk;
     params = risk_params.at(risk_level);
+    publishSnapshot(true);
     spdlog::info("Risk level updated to: {}", static_cast<int>(risk));
 }
 
 void TradingAgent::setStrategy(Strategy strategy) {
     current_strategy = strategy;
     price_history.clear();  // Reset price history for new strategy
+    publishSnapshot(true);
     spdlog::info("Trading strategy updated to: {}", static_cast<int>(strategy));
 }
 
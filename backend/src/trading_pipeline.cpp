@@ -0,0 +1,248 @@
+#include "trading_pipeline.hpp"
+#include <spdlog/spdlog.h>
+
+namespace {
+
+constexpr size_t kMaxTicksPerPass = 64;
+constexpr unsigned kSpinPolls = 64;
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// BACKOFF spins briefly after the last piece of work, then backs off to
+// short sleeps so an idle pipeline does not burn a core. SPIN never gives
+// the core up, trading it for wake-up latency; pair it with pinning.
+void idle_wait(WaitMode mode, unsigned& idle_polls) {
+    if (mode == WaitMode::SPIN) {
+        cpu_relax();
+    } else if (++idle_polls < kSpinPolls) {
+        std::this_thread::yield();
+    } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+}
+
+}  // namespace
+
+TradingPipeline::TradingPipeline(DeribitTrader& trader, TradingAgent& agent, size_t queue_capacity)
+    : trader_(trader), agent_(agent),
+      ring_pages_(HugePageResource::kHugePageSize),
+      ticks_(queue_capacity, &ring_pages_), control_(64, &ring_pages_),
+      orders_(queue_capacity, &ring_pages_), acks_(queue_capacity, &ring_pages_),
+      wait_mode_(ThreadLayout::process().wait_mode()) {}
+
+TradingPipeline::~TradingPipeline() {
+    stop();
+}
+
+void TradingPipeline::start() {
+    if (strategy_thread_.joinable()) {
+        return;
+    }
+    stopping_.store(false);
+    strategy_done_.store(false);
+    agent_.setOrderSink([this](TradingAgent::OrderIntent& intent) {
+        return orders_.try_push(std::move(intent));
+    });
+    gateway_thread_ = std::thread(&TradingPipeline::run_gateway, this);
+    strategy_thread_ = std::thread(&TradingPipeline::run_strategy, this);
+}
+
+void TradingPipeline::stop() {
+    if (!strategy_thread_.joinable()) {
+        return;
+    }
+    stopping_.store(true);
+    strategy_thread_.join();
+    gateway_thread_.join();
+
+    // Both threads are gone, so this thread owns the agent again
+    agent_.setOrderSink(nullptr);
+    TradingAgent::OrderAck ack;
+    while (acks_.try_pop(ack)) {
+        agent_.onOrderAck(ack);
+    }
+}
+
+bool TradingPipeline::publish_tick(double bid, double ask) {
+    return ticks_.try_push(MarketTick{bid, ask, LatencyTracker::now()});
+}
+
+bool TradingPipeline::start_trading() {
+    ControlCommand command;
+    command.type = ControlCommand::Type::START;
+    return send_control(std::move(command));
+}
+
+bool TradingPipeline::stop_trading() {
+    ControlCommand command;
+    command.type = ControlCommand::Type::STOP;
+    return send_control(std::move(command));
+}
+
+bool TradingPipeline::set_strategy(TradingAgent::Strategy strategy) {
+    ControlCommand command;
+    command.type = ControlCommand::Type::SET_STRATEGY;
+    command.strategy = strategy;
+    return send_control(std::move(command));
+}
+
+bool TradingPipeline::set_risk_level(TradingAgent::RiskLevel risk) {
+    ControlCommand command;
+    command.type = ControlCommand::Type::SET_RISK_LEVEL;
+    command.risk = risk;
+    return send_control(std::move(command));
+}
+
+bool TradingPipeline::set_trading_params(const TradingAgent::TradingParams& params) {
+    ControlCommand command;
+    command.type = ControlCommand::Type::SET_PARAMS;
+    command.params = params;
+    return send_control(std::move(command));
+}
+
+bool TradingPipeline::send_control(ControlCommand&& command) {
+    if (!control_.try_push(std::move(command))) {
+        spdlog::warn("Control queue full, command dropped");
+        return false;
+    }
+    return true;
+}
+
+void TradingPipeline::apply_control(ControlCommand& command) {
+    switch (command.type) {
+        case ControlCommand::Type::START:
+            if (!agent_.isRunning()) {
+                agent_.start();
+            }
+            break;
+        case ControlCommand::Type::STOP:
+            if (agent_.isRunning()) {
+                agent_.stop();
+            }
+            break;
+        case ControlCommand::Type::SET_STRATEGY:
+            agent_.setStrategy(command.strategy);
+            break;
+        case ControlCommand::Type::SET_RISK_LEVEL:
+            agent_.setRiskLevel(command.risk);
+            break;
+        case ControlCommand::Type::SET_PARAMS:
+            agent_.setTradingParams(command.params);
+            break;
+    }
+}
+
+// Owns the agent: applies control commands and order acks first so they are
+// never starved by a busy feed, then a bounded batch of ticks
+void TradingPipeline::run_strategy() {
+    ThreadLayout::process().apply("strategy");
+    unsigned idle_polls = 0;
+    ControlCommand command;
+    TradingAgent::OrderAck ack;
+    MarketTick tick;
+
+    while (!stopping_.load(std::memory_order_relaxed)) {
+        bool worked = false;
+
+        while (control_.try_pop(command)) {
+            try {
+                apply_control(command);
+            } catch (const std::exception& e) {
+                spdlog::error("Control command failed: {}", e.what());
+            }
+            worked = true;
+        }
+
+        while (acks_.try_pop(ack)) {
+            agent_.onOrderAck(ack);
+            worked = true;
+        }
+
+        for (size_t i = 0; i < kMaxTicksPerPass && ticks_.try_pop(tick); ++i) {
+            trader_.latency().record(LatencyStage::TICK_QUEUE, tick.received, LatencyTracker::now());
+            if (agent_.isRunning()) {
+                agent_.updatePrice((tick.bid + tick.ask) / 2, tick.bid, tick.ask);
+            }
+            worked = true;
+        }
+
+        if (worked) {
+            idle_polls = 0;
+        } else {
+            // Flush a snapshot the rate limit held back on the last tick
+            agent_.publishSnapshot();
+            idle_wait(wait_mode_, idle_polls);
+        }
+    }
+    strategy_done_.store(true);
+}
+
+// The only stage that blocks on the exchange. It outlives the strategy
+// thread so orders queued at shutdown are still sent and their acks can be
+// applied by stop().
+void TradingPipeline::run_gateway() {
+    ThreadLayout::process().apply("gateway");
+    unsigned idle_polls = 0;
+    TradingAgent::OrderIntent intent;
+
+    while (!strategy_done_.load() || !orders_.empty()) {
+        if (!orders_.try_pop(intent)) {
+            idle_wait(wait_mode_, idle_polls);
+            continue;
+        }
+        idle_polls = 0;
+
+        TradingAgent::OrderAck ack = TradingAgent::executeOrder(trader_, std::move(intent));
+        while (!acks_.try_push(std::move(ack))) {
+            if (strategy_done_.load()) {
+                // Nobody left to drain the ring before stop() does
+                acks_dropped_.increment();
+                spdlog::error("Ack queue full at shutdown, dropping ack for order {}", ack.order_id);
+                break;
+            }
+            std::this_thread::yield();
+        }
+    }
+}
+
+void TradingPipeline::register_metrics(MetricsServer& server) {
+    server.add_counter("pipeline_acks_dropped_total", "Order acks lost at shutdown",
+                       [this] { return static_cast<double>(acks_dropped_.load()); });
+
+    server.add_collector([this](std::ostream& out) {
+        struct QueueInfo {
+            const char* name;
+            size_t depth;
+            size_t capacity;
+            uint64_t rejected;
+        };
+        const QueueInfo queues[] = {
+            {"ticks", ticks_.size(), ticks_.capacity(), ticks_.rejected()},
+            {"control", control_.size(), control_.capacity(), control_.rejected()},
+            {"orders", orders_.size(), orders_.capacity(), orders_.rejected()},
+            {"acks", acks_.size(), acks_.capacity(), acks_.rejected()},
+        };
+
+        out << "# HELP pipeline_queue_depth Items waiting in each pipeline ring\n"
+            << "# TYPE pipeline_queue_depth gauge\n";
+        for (const auto& queue : queues) {
+            out << "pipeline_queue_depth{queue=\"" << queue.name << "\"} " << queue.depth << "\n";
+        }
+        out << "# HELP pipeline_queue_capacity Slots in each pipeline ring\n"
+            << "# TYPE pipeline_queue_capacity gauge\n";
+        for (const auto& queue : queues) {
+            out << "pipeline_queue_capacity{queue=\"" << queue.name << "\"} " << queue.capacity << "\n";
+        }
+        out << "# HELP pipeline_queue_rejected_total Pushes refused because the ring was full\n"
+            << "# TYPE pipeline_queue_rejected_total counter\n";
+        for (const auto& queue : queues) {
+            out << "pipeline_queue_rejected_total{queue=\"" << queue.name << "\"} " << queue.rejected << "\n";
+        }
+    });
+}
@@ -0,0 +1,323 @@
+#include "ws_session.hpp"
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include <openssl/err.h>
+#include <spdlog/spdlog.h>
+#include "thread_layout.hpp"
+
+WsSession::WsSession(std::string name, std::string host, int port, std::string path, Callbacks callbacks)
+    : name_(std::move(name)), host_(std::move(host)), port_(port), path_(std::move(path)),
+      callbacks_(std::move(callbacks)) {}
+
+WsSession::~WsSession() {
+    stop();
+}
+
+std::optional<std::string_view> MessageAssembler::add(std::string_view piece, bool last) {
+    if (complete_) {
+        pending_.clear();
+        complete_ = false;
+    }
+    if (pending_.empty() && !oversized_ && last) {
+        return piece;
+    }
+    if (!oversized_ && pending_.size() + piece.size() > max_message_) {
+        spdlog::warn("Dropping a WebSocket message over {} bytes", max_message_);
+        oversized_ = true;
+        pending_.clear();
+    }
+    if (!oversized_) {
+        pending_.append(piece);
+    }
+    if (!last) {
+        return std::nullopt;
+    }
+    if (oversized_) {
+        oversized_ = false;
+        return std::nullopt;
+    }
+    complete_ = true;
+    return std::string_view(pending_);
+}
+
+void MessageAssembler::reset() {
+    pending_.clear();
+    oversized_ = false;
+    complete_ = false;
+}
+
+struct lws_protocols* WsSession::protocols() {
+    static struct lws_protocols protocols[] = {
+        {
+            "deribit-protocol",
+            WsSession::callback,
+            0,
+            4096,
+        },
+        { nullptr, nullptr, 0, 0 }
+    };
+    return protocols;
+}
+
+void WsSession::start() {
+    struct lws_context_creation_info info;
+    memset(&info, 0, sizeof(info));
+
+    info.options = LWS_SERVER_OPTION_VALIDATE_UTF8 | LWS_SERVER_OPTION_DO_SSL_GLOBAL_INIT;
+    info.port = CONTEXT_PORT_NO_LISTEN;
+    info.protocols = protocols();
+    info.gid = -1;
+    info.uid = -1;
+    info.user = this;
+    info.ssl_cert_filepath = nullptr;
+    info.ssl_private_key_filepath = nullptr;
+
+    lws_set_log_level(LLL_ERR | LLL_WARN, nullptr);
+
+    context_ = lws_create_context(&info);
+    if (!context_) {
+        throw std::runtime_error("Failed to create WebSocket context with SSL");
+    }
+
+    try {
+        connect();
+    } catch (const std::exception& e) {
+        spdlog::error("[{}] WebSocket connection failed: {}", name_, e.what());
+        lws_context_destroy(context_);
+        context_ = nullptr;
+        throw;
+    }
+
+    stopping_.store(false);
+    thread_ = std::thread(&WsSession::run, this);
+}
+
+void WsSession::stop() {
+    stopping_.store(true);
+    if (context_) {
+        lws_cancel_service(context_);
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    if (context_) {
+        lws_context_destroy(context_);
+        context_ = nullptr;
+    }
+    connection_ = nullptr;
+    state_.store(State::DISCONNECTED);
+}
+
+void WsSession::connect() {
+    struct lws_client_connect_info i;
+    memset(&i, 0, sizeof(i));
+
+    i.context = context_;
+    i.port = port_;
+    i.address = host_.c_str();
+    i.path = path_.c_str();
+    i.host = i.address;
+    i.origin = i.address;
+    i.protocol = protocols()[0].name;
+    i.pwsi = &connection_;
+    i.userdata = this;
+
+    i.ssl_connection =
+        LCCSCF_USE_SSL |
+        LCCSCF_ALLOW_SELFSIGNED |
+        LCCSCF_SKIP_SERVER_CERT_HOSTNAME_CHECK;
+
+    spdlog::info("[{}] Attempting WebSocket connection to {}:{}{}", name_, i.address, i.port, i.path);
+
+    state_.store(State::CONNECTING);
+    connection_ = lws_client_connect_via_info(&i);
+
+    if (!connection_) {
+        state_.store(State::DISCONNECTED);
+        char errbuf[256];
+        ERR_error_string_n(ERR_get_error(), errbuf, sizeof(errbuf));
+        throw std::runtime_error("Failed to establish WebSocket connection. SSL Error: " + std::string(errbuf));
+    }
+}
+
+// Services the socket and supervises reconnects. Apart from
+// lws_cancel_service, every lws call happens on this thread.
+//
+// lws 3.2 and later ignore a non-negative service timeout and wait for the
+// next socket event or lws timer, which can be half a minute away on a
+// quiet or disconnected session. The tick timer bounds that wait, so the
+// reconnect schedule and on_service run on time without traffic.
+void WsSession::run() {
+    const ThreadLayout& layout = ThreadLayout::process();
+    layout.apply(name_);
+    // -1 polls the socket without waiting, so a spinning session picks a
+    // frame up as soon as it lands; 0 waits for the next event or tick
+    const int service_timeout_ms = layout.wait_mode() == WaitMode::SPIN ? -1 : 0;
+    tick_.session = this;
+    arm_tick();
+    while (!stopping_.load()) {
+        if (state_.load() == State::DISCONNECTED &&
+            std::chrono::steady_clock::now() >= reconnect_at_) {
+            reconnects_.increment();
+            try {
+                connect();
+            } catch (const std::exception& e) {
+                spdlog::error("[{}] {}", name_, e.what());
+                schedule_reconnect();
+            }
+        }
+
+        if (lws_service(context_, service_timeout_ms) < 0) {
+            spdlog::error("[{}] WebSocket service failed", name_);
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+
+        if (state_.load() == State::CONNECTED && callbacks_.on_service) {
+            callbacks_.on_service();
+        }
+    }
+    lws_sul_cancel(&tick_.sul);
+}
+
+void WsSession::arm_tick() {
+    lws_sul_schedule(context_, 0, &tick_.sul, &WsSession::on_tick,
+                     std::chrono::duration_cast<std::chrono::microseconds>(kSupervisionTick).count());
+}
+
+// Firing is what matters: it ends the service wait so run() loops again
+void WsSession::on_tick(lws_sorted_usec_list_t* sul) {
+    reinterpret_cast<Tick*>(sul)->session->arm_tick();
+}
+
+// Exponential backoff from 500 ms to 30 s with jitter so a fleet of
+// clients does not reconnect in lockstep after an exchange outage
+void WsSession::schedule_reconnect() {
+    thread_local std::mt19937 rng(std::random_device{}());
+    std::uniform_real_distribution<double> jitter(0.5, 1.0);
+
+    auto delay = std::chrono::duration_cast<std::chrono::milliseconds>(backoff_ * jitter(rng));
+    reconnect_at_ = std::chrono::steady_clock::now() + delay;
+    backoff_ = std::min(backoff_ * 2, std::chrono::milliseconds(30000));
+    spdlog::warn("[{}] Reconnecting WebSocket in {} ms", name_, delay.count());
+}
+
+void WsSession::reset_backoff() {
+    backoff_ = std::chrono::milliseconds(500);
+}
+
+size_t WsSession::queued() const {
+    std::lock_guard<std::mutex> lock(outbox_mutex_);
+    return outbox_.size();
+}
+
+void WsSession::send(std::string message) {
+    if (state_.load() != State::CONNECTED) return;
+
+    {
+        std::lock_guard<std::mutex> lock(outbox_mutex_);
+        outbox_.push_back(std::move(message));
+    }
+    lws_cancel_service(context_);
+}
+
+// One frame per writeable callback, as lws requires
+void WsSession::write_next() {
+    std::string message;
+    bool more;
+    {
+        std::lock_guard<std::mutex> lock(outbox_mutex_);
+        if (outbox_.empty()) return;
+        message = std::move(outbox_.front());
+        outbox_.pop_front();
+        more = !outbox_.empty();
+    }
+
+    thread_local std::vector<uint8_t> buf;
+    buf.resize(LWS_PRE + message.length());
+    memcpy(buf.data() + LWS_PRE, message.data(), message.length());
+
+    if (lws_write(connection_, buf.data() + LWS_PRE, message.length(), LWS_WRITE_TEXT) < 0) {
+        spdlog::error("[{}] WebSocket write failed", name_);
+        return;
+    }
+    if (more) {
+        lws_callback_on_writable(connection_);
+    }
+}
+
+void WsSession::handle_closed() {
+    connection_ = nullptr;
+    inbox_.reset();
+    state_.store(State::DISCONNECTED);
+    if (stopping_.load()) {
+        return;
+    }
+
+    if (callbacks_.on_disconnect) {
+        callbacks_.on_disconnect();
+    }
+    schedule_reconnect();
+}
+
+int WsSession::callback(struct lws* wsi, enum lws_callback_reasons reason,
+                        void* user, void* in, size_t len) {
+    if (!wsi) return -1;
+    WsSession* session = static_cast<WsSession*>(lws_context_user(lws_get_context(wsi)));
+    if (!session) return -1;
+
+    switch (reason) {
+        case LWS_CALLBACK_CLIENT_ESTABLISHED:
+            spdlog::info("[{}] WebSocket connected", session->name_);
+            {
+                std::lock_guard<std::mutex> lock(session->outbox_mutex_);
+                session->outbox_.clear();
+            }
+            session->state_.store(State::CONNECTED);
+            if (session->callbacks_.on_connect) {
+                session->callbacks_.on_connect();
+            }
+            break;
+
+        case LWS_CALLBACK_CLIENT_RECEIVE: {
+            // One callback per rx buffer's worth; dispatch whole messages only
+            bool last = lws_is_final_fragment(wsi) && lws_remaining_packet_payload(wsi) == 0;
+            auto message = session->inbox_.add(std::string_view(static_cast<char*>(in), len), last);
+            if (message && session->callbacks_.on_message) {
+                session->callbacks_.on_message(*message);
+            }
+            break;
+        }
+
+        case LWS_CALLBACK_CLIENT_WRITEABLE:
+            session->write_next();
+            break;
+
+        case LWS_CALLBACK_EVENT_WAIT_CANCELLED: {
+            // Woken by send() from another thread
+            std::lock_guard<std::mutex> lock(session->outbox_mutex_);
+            if (session->connection_ && !session->outbox_.empty()) {
+                lws_callback_on_writable(session->connection_);
+            }
+            break;
+        }
+
+        case LWS_CALLBACK_CLIENT_CONNECTION_ERROR:
+            spdlog::error("[{}] WebSocket connection error: {}", session->name_,
+                          in ? std::string(static_cast<char*>(in), len) : "unknown error");
+            session->handle_closed();
+            break;
+
+        case LWS_CALLBACK_CLIENT_CLOSED:
+            spdlog::info("[{}] WebSocket connection closed", session->name_);
+            session->disconnects_.increment();
+            session->handle_closed();
+            break;
+
+        default:
+            break;
+    }
+
+    return 0;
+}
@@ -50,6 +50,8 @@ export default function AIAgentPage() {
                   <SelectItem value="momentum">Momentum Trading</SelectItem>
                   <SelectItem value="mean-reversion">Mean Reversion</SelectItem>
                   <SelectItem value="breakout">Breakout Trading</SelectItem>
+                  <SelectItem value="order-flow">Order Flow</SelectItem>
+                  <SelectItem value="book-imbalance">Book Imbalance</SelectItem>
                 </SelectContent>
               </Select>
             </div>
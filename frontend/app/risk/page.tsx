@@ -1,5 +1,6 @@
 'use client'
 
+import { useEffect, useState } from "react"
 import { Card, CardContent, CardHeader, CardTitle } from "@/components/ui/card"
 import { Tabs, TabsContent, TabsList, TabsTrigger } from "@/components/ui/tabs"
 import { Progress } from "@/components/ui/progress"
@@ -18,7 +19,51 @@ const positionLimitsData = [
   { asset: 'SOL', current: 15000, limit: 25000 },
 ]
 
+// Served by the backend's metrics port
+const RISK_URL = process.env.NEXT_PUBLIC_RISK_URL ?? "http://127.0.0.1:9188/risk"
+
+type LiveRisk = {
+  delta_usd: number
+  gross_notional_usd: number
+  limits: { max_delta_usd: number | null; max_notional_usd: number | null; max_var_usd: number | null }
+  var: { valid: boolean; var_usd?: number; expected_shortfall_usd?: number } | null
+}
+
+function useLiveRisk() {
+  const [risk, setRisk] = useState<LiveRisk | null>(null)
+  useEffect(() => {
+    let cancelled = false
+    const load = () =>
+      fetch(RISK_URL)
+        .then((response) => (response.ok ? response.json() : null))
+        .then((data) => { if (!cancelled && data) setRisk(data) })
+        .catch(() => {})
+    load()
+    const timer = setInterval(load, 5000)
+    return () => { cancelled = true; clearInterval(timer) }
+  }, [])
+  return risk
+}
+
 export default function RiskPage() {
+  const live = useLiveRisk()
+  const liveVar = live?.var?.valid ? live.var : null
+  // The static figures stand in until the backend answers
+  const metrics = liveVar
+    ? [
+        { name: 'VaR', value: Math.round(liveVar.var_usd ?? 0) },
+        { name: 'Expected Shortfall', value: Math.round(liveVar.expected_shortfall_usd ?? 0) },
+        ...riskMetricsData.slice(1),
+      ]
+    : riskMetricsData
+  const limits = live
+    ? [
+        { asset: 'Delta', current: Math.round(Math.abs(live.delta_usd)), limit: live.limits.max_delta_usd },
+        { asset: 'Gross notional', current: Math.round(live.gross_notional_usd), limit: live.limits.max_notional_usd },
+        ...(liveVar ? [{ asset: 'VaR', current: Math.round(liveVar.var_usd ?? 0), limit: live.limits.max_var_usd }] : []),
+      ].filter((row): row is { asset: string; current: number; limit: number } => row.limit !== null)
+    : positionLimitsData
+
   return (
     <div className="grid gap-6">
       <div className="flex items-center justify-between">
@@ -38,7 +83,7 @@ export default function RiskPage() {
               <CardTitle className="text-gray-700 dark:text-gray-200">Portfolio Risk Analysis</CardTitle>
             </CardHeader>
             <CardContent className="grid gap-4 md:grid-cols-2 lg:grid-cols-4">
-              {riskMetricsData.map((metric) => (
+              {metrics.map((metric) => (
                 <div key={metric.name} className="space-y-2">
                   <div className="text-sm font-medium text-muted-foreground">{metric.name}</div>
                   <div className="text-2xl font-bold">{metric.value}</div>
@@ -52,7 +97,7 @@ export default function RiskPage() {
             </CardHeader>
             <CardContent>
               <ResponsiveContainer width="100%" height={300}>
-                <BarChart data={riskMetricsData}>
+                <BarChart data={metrics}>
                   <CartesianGrid strokeDasharray="3 3" stroke="#e5e7eb" opacity={0.3} />
                   <XAxis 
                     dataKey="name" 
@@ -93,7 +138,7 @@ export default function RiskPage() {
               <CardTitle className="text-gray-700 dark:text-gray-200">Position Limits</CardTitle>
             </CardHeader>
             <CardContent className="space-y-6">
-              {positionLimitsData.map((position) => (
+              {limits.map((position) => (
                 <div key={position.asset} className="space-y-2">
                   <div className="flex justify-between">
                     <span className="text-sm font-medium text-muted-foreground">{position.asset}</span>